@@ -0,0 +1,229 @@
+// Instance BVH against linear scans: a grid of wall boxes like a large maze with a camera in the
+// middle of it. Measures the build, refitting after some of the boxes moved, and frustum,
+// sphere and ray queries against testing every box, and checks that both agree.
+// usage: bvh_bench [instances ...]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/camera.h"
+#include "frustum_culler.h"
+#include "instance_bvh.h"
+
+namespace {
+
+    // every measurement repeats the work for at least this long
+    constexpr double minMeasureMs = 200.0;
+
+    // queries per measurement, spread over the scene
+    constexpr size_t queryCount = 64;
+
+    // share of the boxes moved before a refit
+    constexpr double movedRatio = 0.01;
+
+    // cells of one unit, every third one is a wall, 1.8 units high like the maze boxes
+    std::vector<BoundingBox> createScene(size_t count) {
+        std::vector<BoundingBox> boxes;
+        const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count * 3))));
+        for (size_t cell = 0; boxes.size() < count; ++cell) {
+            const size_t x = cell % side;
+            const size_t z = cell / side;
+            if ((x * 7 + z * 13) % 3 != 0) {
+                continue;
+            }
+            BoundingBox box;
+            box.min = glm::vec3(float(x) - 0.5f * side, 0.0f, float(z) - 0.5f * side);
+            box.max = box.min + glm::vec3(0.9f, 1.8f, 0.9f);
+            boxes.push_back(box);
+        }
+        return boxes;
+    }
+
+    // microseconds per call of fn
+    double measureUs(const std::function<void()>& fn) {
+        size_t calls = 0;
+        const auto begin = std::chrono::high_resolution_clock::now();
+        double elapsedMs = 0.0;
+        do {
+            fn();
+            ++calls;
+            elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+        } while (elapsedMs < minMeasureMs);
+        return elapsedMs * 1000.0 / static_cast<double>(calls);
+    }
+
+    void printRow(const std::string& name, double linearUs, double bvhUs) {
+        std::cout << "  " << std::left << std::setw(18) << name << std::right << std::setw(12) << linearUs
+                  << std::setw(12) << bvhUs << std::setw(9) << linearUs / bvhUs << "x\n";
+    }
+
+    float getSquaredDistance(const BoundingBox& box, const glm::vec3& point) {
+        const glm::vec3 offset = glm::clamp(point, box.min, box.max) - point;
+        return glm::dot(offset, offset);
+    }
+
+    // entry distance of the ray, infinity if it misses
+    float intersectRay(const BoundingBox& box, const glm::vec3& origin, const glm::vec3& direction, float maxDistance) {
+        const glm::vec3 inverse = 1.0f / direction;
+        const glm::vec3 t0 = (box.min - origin) * inverse;
+        const glm::vec3 t1 = (box.max - origin) * inverse;
+        const glm::vec3 tNear = glm::min(t0, t1);
+        const glm::vec3 tFar = glm::max(t0, t1);
+        const float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+        const float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+        return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i) {
+        counts.push_back(static_cast<size_t>(std::max(1, std::atoi(argv[i]))));
+    }
+    if (counts.empty()) {
+        counts = { 100, 1000, 10000, 100000 };
+    }
+
+    PerspectiveCamera camera(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    camera.transform.position = glm::vec3(0.0f, 1.7f, 0.0f);
+    camera.transform.lookAt(glm::vec3(10.0f, 1.0f, -10.0f));
+    const Frustum frustum = camera.getFrustum();
+
+    std::cout << std::fixed << std::setprecision(2);
+    bool mismatch = false;
+    for (size_t count : counts) {
+        std::vector<BoundingBox> boxes = createScene(count);
+        const float halfSide = 0.5f * std::sqrt(static_cast<float>(count * 3));
+
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> position(-halfSide, halfSide);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::vector<glm::vec3> points(queryCount);
+        std::vector<glm::vec3> directions(queryCount);
+        for (size_t i = 0; i < queryCount; ++i) {
+            points[i] = glm::vec3(position(random), 0.9f, position(random));
+            directions[i] = glm::normalize(glm::vec3(unit(random), 0.05f * unit(random), unit(random)));
+        }
+
+        InstanceBvh bvh;
+        const double buildUs = measureUs([&]() { bvh.build(boxes, 1); });
+        const double parallelBuildUs = measureUs([&]() { bvh.build(boxes); });
+        std::cout << count << " instances, " << bvh.getNodes().size() << " nodes, build " << buildUs / 1000.0
+                  << " ms on 1 thread, " << parallelBuildUs / 1000.0 << " ms on the pool\n";
+        std::cout << "  " << std::left << std::setw(18) << "" << std::right << std::setw(12) << "linear us"
+                  << std::setw(12) << "bvh us" << std::setw(10) << "speedup\n";
+
+        // moving boxes: rebuilding is the linear alternative of a refit
+        const size_t moved = std::max<size_t>(1, static_cast<size_t>(static_cast<double>(count) * movedRatio));
+        float step = 0.01f;
+        const double refitUs = measureUs([&]() {
+            for (size_t i = 0; i < moved; ++i) {
+                const uint32_t index = static_cast<uint32_t>((i * 7919) % boxes.size());
+                boxes[index].min.x += step;
+                boxes[index].max.x += step;
+                bvh.update(index, boxes[index]);
+            }
+            bvh.refit();
+            step = -step;
+            });
+        printRow("refit " + std::to_string(moved) + " moved", buildUs, refitUs);
+
+        // frustum
+        InstanceBounds bounds;
+        for (const BoundingBox& box : boxes) {
+            bounds.add(box);
+        }
+        std::vector<uint32_t> linear;
+        const double frustumLinearUs = measureUs([&]() {
+            linear.clear();
+            for (size_t i = 0; i < boxes.size(); ++i) {
+                if (frustum.intersect(boxes[i])) {
+                    linear.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            });
+        std::vector<uint32_t> simd;
+        const double frustumSimdUs = measureUs([&]() { cullInstances(frustum, bounds, simd); });
+        std::vector<uint32_t> tree;
+        const double frustumBvhUs = measureUs([&]() {
+            tree.clear();
+            bvh.queryFrustum(frustum, tree);
+            });
+        std::sort(tree.begin(), tree.end());
+        printRow("frustum", frustumLinearUs, frustumBvhUs);
+        printRow(std::string("frustum vs ") + getCullingKernelName(getBestCullingKernel()), frustumSimdUs, frustumBvhUs);
+        if (tree != linear || simd != linear) {
+            std::cerr << "frustum query does not match the linear scan" << std::endl;
+            mismatch = true;
+        }
+
+        // spheres of the player's size
+        const float radius = 0.3f;
+        size_t linearHits = 0;
+        const double sphereLinearUs = measureUs([&]() {
+            linearHits = 0;
+            for (const glm::vec3& point : points) {
+                for (const BoundingBox& box : boxes) {
+                    linearHits += getSquaredDistance(box, point) < radius * radius ? 1 : 0;
+                }
+            }
+            }) / queryCount;
+        size_t treeHits = 0;
+        const double sphereBvhUs = measureUs([&]() {
+            treeHits = 0;
+            for (const glm::vec3& point : points) {
+                tree.clear();
+                bvh.querySphere(point, radius, tree);
+                treeHits += tree.size();
+            }
+            }) / queryCount;
+        printRow("sphere", sphereLinearUs, sphereBvhUs);
+        if (linearHits != treeHits) {
+            std::cerr << "sphere query does not match the linear scan" << std::endl;
+            mismatch = true;
+        }
+
+        // rays along the floor of the maze
+        const float maxDistance = 2.0f * halfSide;
+        std::vector<BvhRayHit> linearRays(queryCount);
+        const double rayLinearUs = measureUs([&]() {
+            for (size_t q = 0; q < queryCount; ++q) {
+                BvhRayHit& hit = linearRays[q];
+                hit.index = ~0u;
+                hit.distance = maxDistance;
+                for (size_t i = 0; i < boxes.size(); ++i) {
+                    const float distance = intersectRay(boxes[i], points[q], directions[q], hit.distance);
+                    if (distance < hit.distance || (distance == hit.distance && hit.index == ~0u)) {
+                        hit.index = static_cast<uint32_t>(i);
+                        hit.distance = distance;
+                    }
+                }
+            }
+            }) / queryCount;
+        std::vector<BvhRayHit> treeRays(queryCount);
+        const double rayBvhUs = measureUs([&]() {
+            for (size_t q = 0; q < queryCount; ++q) {
+                if (!bvh.raycast(points[q], directions[q], maxDistance, treeRays[q])) {
+                    treeRays[q].index = ~0u;
+                }
+            }
+            }) / queryCount;
+        printRow("ray", rayLinearUs, rayBvhUs);
+        for (size_t q = 0; q < queryCount; ++q) {
+            if (linearRays[q].index != treeRays[q].index
+                && (treeRays[q].index == ~0u || linearRays[q].distance != treeRays[q].distance)) {
+                std::cerr << "ray " << q << " does not match the linear scan" << std::endl;
+                mismatch = true;
+            }
+        }
+    }
+    return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+}
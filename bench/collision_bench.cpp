@@ -0,0 +1,289 @@
+// Player collision broadphase: the wall boxes of growing mazes are tested against spheres of
+// the player's size, once by scanning all walls like the app did and once through the
+// CollisionGrid. The grid query should cost the same for every maze size. Also measures the
+// build and moving walls around, and checks that both find the same hits.
+// Then the narrowphase: sphere box tests per second of findDeepestContact against a scalar
+// loop, and whole frames of CollisionSolver::move for growing numbers of movers, checking
+// that no mover ends up inside of a wall.
+// usage: collision_bench [maze side ...]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
+#include "collision_grid.h"
+#include "collision_solver.h"
+
+namespace {
+
+    // every measurement repeats the work for at least this long
+    constexpr double minMeasureMs = 200.0;
+
+    constexpr size_t queryCount = 256;
+
+    // as in the app
+    constexpr float cellSize = 1.5f;
+    constexpr float wallY = -2.0f;
+    constexpr float wallHalfSize = 0.9f;
+    constexpr float playerRadius = 0.2f;
+
+    glm::vec2 getOrigin(int side) {
+        return glm::vec2(-0.5f * cellSize * static_cast<float>(side - 1));
+    }
+
+    // solid border, about a third of the inner cells are walls
+    std::vector<BoundingBox> createWalls(int side) {
+        std::vector<BoundingBox> walls;
+        const glm::vec2 origin = getOrigin(side);
+        std::mt19937 random(7);
+        for (int row = 0; row < side; ++row) {
+            for (int col = 0; col < side; ++col) {
+                const bool border = row == 0 || col == 0 || row == side - 1 || col == side - 1;
+                if (!border && random() % 3 != 0) {
+                    continue;
+                }
+                const glm::vec3 center(origin.x + col * cellSize, wallY, origin.y + row * cellSize);
+                BoundingBox box;
+                box.min = center - glm::vec3(wallHalfSize);
+                box.max = center + glm::vec3(wallHalfSize);
+                walls.push_back(box);
+            }
+        }
+        return walls;
+    }
+
+    // microseconds per call of fn
+    double measureUs(const std::function<void()>& fn) {
+        size_t calls = 0;
+        const auto begin = std::chrono::high_resolution_clock::now();
+        double elapsedMs = 0.0;
+        do {
+            fn();
+            ++calls;
+            elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+        } while (elapsedMs < minMeasureMs);
+        return elapsedMs * 1000.0 / static_cast<double>(calls);
+    }
+
+    bool touches(const BoundingBox& box, const glm::vec3& center, float radius = playerRadius) {
+        const glm::vec3 offset = glm::clamp(center, box.min, box.max) - center;
+        return glm::dot(offset, offset) < radius * radius;
+    }
+
+    // nearest box the sphere touches like findDeepestContact, but one box at a time and with
+    // the distance of glm::length
+    int findDeepestScalar(const std::vector<BoundingBox>& boxes, const glm::vec3& center, float radius) {
+        int best = -1;
+        float bestDistance = radius;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            const float distance = glm::length(glm::clamp(center, boxes[i].min, boxes[i].max) - center);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = static_cast<int>(i);
+            }
+        }
+        return best;
+    }
+
+    // false if the batched test disagrees with the scalar one
+    bool measureNarrowphase() {
+        // the candidates of a player standing in a corner of the maze
+        std::vector<BoundingBox> boxes = createWalls(5);
+        CollisionBoxBatch batch;
+        for (const BoundingBox& box : boxes) {
+            batch.add(box);
+        }
+        batch.finish();
+
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+        std::vector<glm::vec3> centers(queryCount);
+        for (glm::vec3& center : centers) {
+            center = glm::vec3(position(random), wallY + 0.5f * position(random), position(random));
+        }
+
+        size_t scalarHits = 0, simdHits = 0;
+        const double scalarUs = measureUs([&]() {
+            scalarHits = 0;
+            for (const glm::vec3& center : centers) {
+                scalarHits += findDeepestScalar(boxes, center, playerRadius) >= 0 ? 1 : 0;
+            }
+            });
+        const double simdUs = measureUs([&]() {
+            simdHits = 0;
+            for (const glm::vec3& center : centers) {
+                simdHits += findDeepestContact(batch, center, playerRadius) >= 0 ? 1 : 0;
+            }
+            });
+        const double tests = static_cast<double>(queryCount * boxes.size());
+        std::cout << "narrowphase, " << boxes.size() << " boxes per sphere: scalar " << tests / scalarUs
+                  << " tests/us, batched " << tests / simdUs << " tests/us, " << scalarUs / simdUs << "x\n";
+        if (scalarHits != simdHits) {
+            std::cerr << "batched test finds " << simdHits << " contacts, the scalar one " << scalarHits << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // false if a mover ended up deeper than half its radius in a wall
+    bool measureMovers(int side) {
+        const std::vector<BoundingBox> walls = createWalls(side);
+        CollisionGrid grid;
+        grid.build(getOrigin(side), cellSize, side, side, walls);
+
+        const float halfSide = 0.5f * cellSize * static_cast<float>(side - 2);
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> position(-halfSide, halfSide);
+        std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+        // from walking speed to a frame hitch of several cells
+        std::uniform_real_distribution<float> speed(0.03f, 6.0f);
+        std::vector<CollisionMover> start;
+        std::vector<uint32_t> ids;
+        while (start.size() < 16384) {
+            CollisionMover mover;
+            mover.position = glm::vec3(position(random), wallY + 0.3f, position(random));
+            ids.clear();
+            grid.querySphere(mover.position, mover.radius, ids);
+            const auto touchesMover = [&](uint32_t id) { return touches(grid.getBox(id), mover.position); };
+            if (std::any_of(ids.begin(), ids.end(), touchesMover)) {
+                continue;
+            }
+            const float a = angle(random);
+            mover.displacement = glm::vec3(std::cos(a), 0.0f, std::sin(a)) * speed(random);
+            start.push_back(mover);
+        }
+
+        bool valid = true;
+        CollisionSolver solver;
+        std::cout << std::setw(8) << "movers" << std::setw(9) << "threads" << std::setw(11) << "frame ms"
+                  << std::setw(11) << "substeps" << std::setw(12) << "candidates" << std::setw(11) << "contacts"
+                  << std::setw(12) << "tests/us" << "\n";
+        for (size_t count : { size_t(1), size_t(64), size_t(1024), size_t(16384) }) {
+            for (size_t threads : { size_t(1), size_t(0) }) {
+                std::vector<CollisionMover> movers(start.begin(), start.begin() + count);
+                const double frameUs = measureUs([&]() {
+                    std::copy(start.begin(), start.begin() + count, movers.begin());
+                    solver.move(grid, movers, threads);
+                    });
+                const CollisionStats& stats = solver.getStats();
+                std::cout << std::setw(8) << count << std::setw(9)
+                          << (threads == 0 ? std::string("all") : std::to_string(threads))
+                          << std::setw(11) << frameUs / 1000.0 << std::setw(11) << stats.substeps << std::setw(12)
+                          << stats.candidates << std::setw(11) << stats.contacts << std::setw(12)
+                          << static_cast<double>(stats.tests) / frameUs << "\n";
+
+                for (const CollisionMover& mover : movers) {
+                    ids.clear();
+                    grid.querySphere(mover.position, mover.radius, ids);
+                    for (uint32_t id : ids) {
+                        if (touches(grid.getBox(id), mover.position, 0.5f * mover.radius)) {
+                            valid = false;
+                        }
+                    }
+                }
+            }
+        }
+        if (!valid) {
+            std::cerr << "a mover passed into a wall" << std::endl;
+        }
+        return valid;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<int> sides;
+    for (int i = 1; i < argc; ++i) {
+        sides.push_back(std::max(3, std::atoi(argv[i])));
+    }
+    if (sides.empty()) {
+        sides = { 15, 64, 256, 1024 };
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(6) << "side" << std::setw(10) << "walls" << std::setw(11) << "build ms"
+              << std::setw(10) << "KiB" << std::setw(14) << "linear us" << std::setw(11) << "grid us"
+              << std::setw(12) << "candidates" << std::setw(11) << "edit us" << "\n";
+    bool mismatch = false;
+    for (int side : sides) {
+        std::vector<BoundingBox> walls = createWalls(side);
+        const glm::vec2 origin = getOrigin(side);
+
+        // near walls, where the player bumps into them
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> offset(-1.2f, 1.2f);
+        std::vector<glm::vec3> points(queryCount);
+        for (glm::vec3& point : points) {
+            const glm::vec3 wall = walls[random() % walls.size()].getCenter();
+            point = glm::vec3(wall.x + offset(random), wallY + 0.3f, wall.z + offset(random));
+        }
+
+        CollisionGrid grid;
+        const double buildUs = measureUs([&]() { grid.build(origin, cellSize, side, side, walls); });
+
+        size_t linearHits = 0;
+        const double linearUs = measureUs([&]() {
+            linearHits = 0;
+            for (const glm::vec3& point : points) {
+                for (const BoundingBox& wall : walls) {
+                    linearHits += touches(wall, point) ? 1 : 0;
+                }
+            }
+            }) / queryCount;
+
+        size_t gridHits = 0;
+        size_t candidates = 0;
+        std::vector<uint32_t> ids;
+        const double gridUs = measureUs([&]() {
+            gridHits = 0;
+            candidates = 0;
+            for (const glm::vec3& point : points) {
+                ids.clear();
+                grid.querySphere(point, playerRadius, ids);
+                candidates += ids.size();
+                for (uint32_t id : ids) {
+                    gridHits += touches(grid.getBox(id), point) ? 1 : 0;
+                }
+            }
+            }) / queryCount;
+        if (linearHits != gridHits) {
+            std::cerr << "grid finds " << gridHits << " hits, the scan " << linearHits << std::endl;
+            mismatch = true;
+        }
+
+        // a wall sliding back and forth over the cell border, then removed and added again
+        float step = 0.5f * cellSize;
+        const double editUs = measureUs([&]() {
+            const uint32_t id = static_cast<uint32_t>(random() % walls.size());
+            BoundingBox box = grid.getBox(id);
+            box.min.x += step;
+            box.max.x += step;
+            grid.update(id, box);
+            box.min.x -= step;
+            box.max.x -= step;
+            grid.update(id, box);
+            grid.remove(id);
+            if (grid.insert(box) != id) {
+                mismatch = true;
+            }
+            step = -step;
+            }) / 4.0;
+
+        std::cout << std::setw(6) << side << std::setw(10) << walls.size() << std::setw(11) << buildUs / 1000.0
+                  << std::setw(10) << grid.getByteSize() / 1024 << std::setw(14) << linearUs << std::setw(11)
+                  << gridUs << std::setw(12) << static_cast<double>(candidates) / queryCount << std::setw(11)
+                  << editUs << "\n";
+    }
+
+    if (!measureNarrowphase() || !measureMovers(256)) {
+        mismatch = true;
+    }
+    return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+// Frustum culling throughput: a grid of wall boxes like a large maze, culled by a camera in the
+// middle of it. Compares Frustum::intersect called per box on an array of BoundingBox against
+// the structure of arrays kernels of cullInstances, and checks that all of them agree.
+// usage: culling_bench [instances ...]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/camera.h"
+#include "frustum_culler.h"
+
+namespace {
+
+    // every measurement repeats the cull for at least this long
+    constexpr double minMeasureMs = 200.0;
+
+    struct Scene {
+        std::vector<BoundingBox> boxes;
+        InstanceBounds bounds;
+    };
+
+    // cells of one unit, every third one is a wall, 1.8 units high like the maze boxes
+    Scene createScene(size_t count) {
+        Scene scene;
+        const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count * 3))));
+        for (size_t cell = 0; scene.boxes.size() < count; ++cell) {
+            const size_t x = cell % side;
+            const size_t z = cell / side;
+            if ((x * 7 + z * 13) % 3 != 0) {
+                continue;
+            }
+            BoundingBox box;
+            box.min = glm::vec3(float(x) - 0.5f * side, 0.0f, float(z) - 0.5f * side);
+            box.max = box.min + glm::vec3(0.9f, 1.8f, 0.9f);
+            scene.boxes.push_back(box);
+        }
+        scene.bounds.reserve(scene.boxes.size());
+        for (const BoundingBox& box : scene.boxes) {
+            scene.bounds.add(box);
+        }
+        return scene;
+    }
+
+    // microseconds per call of fn
+    double measureUs(const std::function<void()>& fn) {
+        size_t calls = 0;
+        const auto begin = std::chrono::high_resolution_clock::now();
+        double elapsedMs = 0.0;
+        do {
+            fn();
+            ++calls;
+            elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+        } while (elapsedMs < minMeasureMs);
+        return elapsedMs * 1000.0 / static_cast<double>(calls);
+    }
+
+    void printRow(const std::string& name, size_t instances, double us, double baselineUs) {
+        std::cout << "  " << std::left << std::setw(22) << name << std::right << std::setw(10) << us << " us "
+                  << std::setw(10) << static_cast<double>(instances) / us << " instances/us " << std::setw(6)
+                  << baselineUs / us << "x\n";
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i) {
+        counts.push_back(static_cast<size_t>(std::max(1, std::atoi(argv[i]))));
+    }
+    if (counts.empty()) {
+        counts = { 1000, 10000, 100000 };
+    }
+
+    PerspectiveCamera camera(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    camera.transform.position = glm::vec3(0.0f, 1.7f, 0.0f);
+    camera.transform.lookAt(glm::vec3(10.0f, 1.0f, -10.0f));
+    const Frustum frustum = camera.getFrustum();
+
+    std::cout << std::fixed << std::setprecision(2) << "best kernel: "
+              << getCullingKernelName(getBestCullingKernel()) << "\n";
+    bool mismatch = false;
+    for (size_t count : counts) {
+        const Scene scene = createScene(count);
+
+        std::vector<uint32_t> reference;
+        const double baselineUs = measureUs([&]() {
+            reference.clear();
+            for (size_t i = 0; i < scene.boxes.size(); ++i) {
+                if (frustum.intersect(scene.boxes[i])) {
+                    reference.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            });
+
+        std::cout << count << " instances, " << reference.size() << " visible\n";
+        printRow("Frustum::intersect", count, baselineUs, baselineUs);
+
+        for (CullingKernel kernel : { CullingKernel::Scalar, CullingKernel::SSE, CullingKernel::AVX }) {
+            if (kernel > getBestCullingKernel()) {
+                std::cout << "  " << getCullingKernelName(kernel) << ": not supported\n";
+                continue;
+            }
+            std::vector<uint32_t> visible;
+            const double us = measureUs([&]() { cullInstances(frustum, scene.bounds, visible, kernel); });
+            printRow(std::string("soa ") + getCullingKernelName(kernel), count, us, baselineUs);
+            if (visible != reference) {
+                std::cerr << getCullingKernelName(kernel) << " does not match Frustum::intersect" << std::endl;
+                mismatch = true;
+            }
+        }
+    }
+    return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+// Compares loading a gltf asset (json + mapped buffers, uploaded as they are) against loading
+// the same geometry from an obj file (text parsing + vertex deduplication). The obj is written
+// from the gltf first. The gl upload is replaced by a copy of the bytes that would be uploaded.
+// usage: gltf_load_bench [repeat] [scene.gltf]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gltf_loader.h"
+
+namespace {
+
+    double medianMs(int repeat, const std::function<void()>& fn) {
+        std::vector<double> samples;
+        for (int i = 0; i < repeat; ++i) {
+            const auto begin = std::chrono::high_resolution_clock::now();
+            fn();
+            const auto end = std::chrono::high_resolution_clock::now();
+            samples.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    template <typename T>
+    T readElement(const GltfScene& scene, const GltfAccessor& accessor, size_t index, size_t component) {
+        const size_t stride = accessor.byteStride != 0 ? accessor.byteStride : sizeof(T) * accessor.componentCount;
+        T value;
+        std::memcpy(
+            &value, scene.ranges[accessor.range].data + accessor.byteOffset + stride * index
+                        + sizeof(T) * component,
+            sizeof(T));
+        return value;
+    }
+
+    uint32_t readIndex(const GltfScene& scene, const GltfAccessor& accessor, size_t i) {
+        switch (accessor.componentType) {
+        case GL_UNSIGNED_BYTE: return readElement<uint8_t>(scene, accessor, i, 0);
+        case GL_UNSIGNED_SHORT: return readElement<uint16_t>(scene, accessor, i, 0);
+        default: return readElement<uint32_t>(scene, accessor, i, 0);
+        }
+    }
+
+    // scene space positions / normals, one obj group per primitive, every vertex is a v/vt/vn
+    // triple with equal indices so that the obj loader ends up with the same vertex count
+    void writeEquivalentObj(const GltfScene& scene, const std::string& objPath) {
+        std::ofstream out(objPath);
+        out << std::setprecision(9);
+        size_t base = 1;
+        for (size_t p = 0; p < scene.primitives.size(); ++p) {
+            const GltfPrimitive& primitive = scene.primitives[p];
+            const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(primitive.worldMatrix)));
+            const size_t count = primitive.positions.count;
+            for (size_t i = 0; i < count; ++i) {
+                glm::vec3 position, normal;
+                for (int c = 0; c < 3; ++c) {
+                    position[c] = readElement<float>(scene, primitive.positions, i, c);
+                    normal[c] = readElement<float>(scene, primitive.normals, i, c);
+                }
+                position = glm::vec3(primitive.worldMatrix * glm::vec4(position, 1.0f));
+                normal = glm::normalize(normalMatrix * normal);
+                out << "v " << position.x << ' ' << position.y << ' ' << position.z << '\n';
+                out << "vn " << normal.x << ' ' << normal.y << ' ' << normal.z << '\n';
+                if (primitive.texCoords.componentType == GL_FLOAT && primitive.texCoords.componentCount == 2) {
+                    out << "vt " << readElement<float>(scene, primitive.texCoords, i, 0) << ' '
+                        << 1.0f - readElement<float>(scene, primitive.texCoords, i, 1) << '\n';
+                }
+                else {
+                    out << "vt 0 0\n";
+                }
+            }
+
+            out << "usemtl primitive" << p << '\n';
+            for (size_t i = 0; i + 2 < primitive.indices.count; i += 3) {
+                out << 'f';
+                for (size_t k = 0; k < 3; ++k) {
+                    const size_t v = base + readIndex(scene, primitive.indices, i + k);
+                    out << ' ' << v << '/' << v << '/' << v;
+                }
+                out << '\n';
+            }
+            base += count;
+        }
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int repeat = 5;
+    std::string gltfPath = "media/gltf/grey_knight/scene.gltf";
+    if (argc > 1) {
+        repeat = std::max(1, std::atoi(argv[1]));
+    }
+    if (argc > 2) {
+        gltfPath = argv[2];
+    }
+
+    try {
+        const std::string objPath = gltfPath + ".bench.obj";
+        size_t gltfVertices = 0;
+        size_t gltfTriangles = 0;
+        {
+            const GltfScene scene = loadGltfScene(gltfPath);
+            writeEquivalentObj(scene, objPath);
+            for (const GltfPrimitive& primitive : scene.primitives) {
+                gltfVertices += primitive.positions.count;
+                gltfTriangles += primitive.indices.count / 3;
+            }
+        }
+
+        std::vector<char> staging;
+        size_t gltfBytes = 0;
+        const double gltfMs = medianMs(repeat, [&]() {
+            const GltfScene scene = loadGltfScene(gltfPath);
+            gltfBytes = 0;
+            for (const GltfBufferRange& range : scene.ranges) {
+                staging.assign(range.data, range.data + range.byteLength);
+                gltfBytes += range.byteLength;
+            }
+            });
+
+        // the plain obj path without mesh cache or any of the post processing
+        ModelLoadOptions options;
+        options.useMeshCache = false;
+        options.optimizeMeshes = false;
+        options.maxLodLevels = 1;
+        options.buildMeshlets = false;
+
+        size_t objBytes = 0;
+        size_t objVertices = 0;
+        std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+        const double objMs = medianMs(repeat, [&]() {
+            const ModelData data = buildModelData(objPath, false, options);
+            objBytes = 0;
+            objVertices = 0;
+            for (const MeshData& mesh : data.meshes) {
+                const char* vertices = reinterpret_cast<const char*>(mesh.vertices.data());
+                const char* indices = reinterpret_cast<const char*>(mesh.indices.data());
+                staging.assign(vertices, vertices + mesh.vertices.size() * sizeof(Vertex));
+                staging.assign(indices, indices + mesh.indices.size() * sizeof(uint32_t));
+                objBytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(uint32_t);
+                objVertices += mesh.vertices.size();
+            }
+            });
+        std::cout.rdbuf(coutBuffer);
+        std::remove(objPath.c_str());
+
+        std::cout << gltfPath << ": " << gltfVertices << " vertices, " << gltfTriangles << " triangles\n"
+                  << std::fixed << std::setprecision(2)
+                  << "gltf: " << std::setw(9) << gltfMs << " ms, " << gltfBytes / 1024 << " KiB uploaded\n"
+                  << "obj:  " << std::setw(9) << objMs << " ms, " << objBytes / 1024 << " KiB uploaded, "
+                  << objVertices << " vertices after dedup\n"
+                  << "speedup: " << objMs / gltfMs << "x (median of " << repeat << ")\n";
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+// Compares the memory mapped obj parser against the std::istringstream reference parser
+// and shows how the chunked parser scales with the number of threads.
+// usage: obj_parse_bench [repeat] [file.obj ...]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "obj_parser.h"
+
+namespace {
+
+    bool sameFaceVertex(const FaceVertex& a, const FaceVertex& b) {
+        return a.positionIndex == b.positionIndex && a.texcoordIndex == b.texcoordIndex
+            && a.normalIndex == b.normalIndex;
+    }
+
+    bool sameResult(const ParsedObj& a, const ParsedObj& b) {
+        if (a.positions != b.positions || a.normals != b.normals || a.texcoords != b.texcoords) {
+            return false;
+        }
+        if (a.faceStreams.size() != b.faceStreams.size() || a.materials.size() != b.materials.size()) {
+            return false;
+        }
+        for (const FaceStream& sa : a.faceStreams) {
+            auto it = std::find_if(b.faceStreams.begin(), b.faceStreams.end(),
+                [&](const FaceStream& sb) { return sb.materialName == sa.materialName; });
+            if (it == b.faceStreams.end() || it->vertices.size() != sa.vertices.size()) {
+                return false;
+            }
+            if (!std::equal(sa.vertices.begin(), sa.vertices.end(), it->vertices.begin(), sameFaceVertex)) {
+                return false;
+            }
+        }
+        for (const auto& material : a.materials) {
+            auto it = b.materials.find(material.first);
+            if (it == b.materials.end() || it->second.diffuseColor != material.second.diffuseColor
+                || it->second.diffuseTexture != material.second.diffuseTexture) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    double medianMs(int repeat, const std::function<void()>& fn) {
+        std::vector<double> samples;
+        for (int i = 0; i < repeat; ++i) {
+            const auto begin = std::chrono::high_resolution_clock::now();
+            fn();
+            const auto end = std::chrono::high_resolution_clock::now();
+            samples.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int repeat = 5;
+    std::vector<std::string> files;
+    if (argc > 1) {
+        repeat = std::max(1, std::atoi(argv[1]));
+    }
+    for (int i = 2; i < argc; ++i) {
+        files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        files = { "media/obj/Monster.obj", "media/obj/judy_3d.obj", "media/obj/nike.obj",
+                  "media/obj/snow_box.obj" };
+    }
+
+    std::vector<int> threadCounts = { 1 };
+    const int hardwareThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int t = 2; t < hardwareThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    if (hardwareThreads > 1) {
+        threadCounts.push_back(hardwareThreads);
+    }
+
+    bool allMatch = true;
+    double totalStream = 0.0;
+    std::vector<double> totalMapped(threadCounts.size(), 0.0);
+
+    std::cout << std::left << std::setw(28) << "file" << std::right << std::setw(10) << "faces"
+              << std::setw(12) << "stream";
+    for (int t : threadCounts) {
+        std::cout << std::setw(11) << t << "T";
+    }
+    std::cout << "  result (median ms)\n";
+
+    for (const auto& file : files) {
+        try {
+            const ParsedObj reference = parseObjFileStream(file, true);
+            bool match = true;
+            for (int t : threadCounts) {
+                match = match && sameResult(reference, parseObjFile(file, true, t));
+            }
+            allMatch = allMatch && match;
+
+            const double streamMs = medianMs(repeat, [&]() { parseObjFileStream(file, false); });
+            totalStream += streamMs;
+
+            size_t faceCount = 0;
+            for (const auto& stream : reference.faceStreams) {
+                faceCount += stream.vertices.size() / 3;
+            }
+
+            std::cout << std::left << std::setw(28) << file << std::right << std::setw(10)
+                      << faceCount << std::fixed << std::setprecision(2)
+                      << std::setw(12) << streamMs;
+            for (size_t i = 0; i < threadCounts.size(); ++i) {
+                const int t = threadCounts[i];
+                const double mappedMs = medianMs(repeat, [&]() { parseObjFile(file, false, t); });
+                totalMapped[i] += mappedMs;
+                std::cout << std::setw(12) << mappedMs;
+            }
+            std::cout << "  " << (match ? "identical" : "MISMATCH") << "\n";
+        }
+        catch (const std::exception& e) {
+            std::cerr << file << ": " << e.what() << std::endl;
+            allMatch = false;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << "total: stream " << totalStream << " ms";
+    for (size_t i = 0; i < threadCounts.size(); ++i) {
+        if (totalMapped[i] > 0.0) {
+            std::cout << ", " << threadCounts[i] << "T " << totalMapped[i] << " ms ("
+                      << totalStream / totalMapped[i] << "x)";
+        }
+    }
+    std::cout << "\n";
+
+    return allMatch ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,137 @@
+// Software occlusion culling cost: a grid of wall boxes like a large maze, seen from a camera
+// in the middle of it turning around in 16 steps. The nearest walls in view are rasterized
+// into an OcclusionBuffer and every wall in view is tested against it, for a few resolutions,
+// occluder counts and thread counts.
+// usage: occlusion_bench [walls per side]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/camera.h"
+#include "base/thread_pool.h"
+#include "occlusion_buffer.h"
+
+namespace {
+
+    constexpr int viewCount = 16;
+
+    // every view is rendered and tested this often
+    constexpr int repeats = 20;
+
+    // cells of 1.5 units like the maze, about every third one a wall box of 1.8 units
+    std::vector<BoundingBox> createWalls(int side) {
+        std::vector<BoundingBox> walls;
+        for (int z = -side / 2; z <= side / 2; ++z) {
+            for (int x = -side / 2; x <= side / 2; ++x) {
+                if ((std::abs(x) <= 1 && std::abs(z) <= 1) || (x * 7 + z * 13 + 100 * side) % 3 != 0) {
+                    continue;
+                }
+                const glm::vec3 center(float(x) * 1.5f, -2.0f, float(z) * 1.5f);
+                BoundingBox box;
+                box.min = center - glm::vec3(0.9f);
+                box.max = center + glm::vec3(0.9f);
+                walls.push_back(box);
+            }
+        }
+        return walls;
+    }
+
+    struct View {
+        glm::mat4 viewProjection;
+        // walls in the frustum, nearest first
+        std::vector<uint32_t> walls;
+    };
+
+    std::vector<View> createViews(const std::vector<BoundingBox>& walls) {
+        std::vector<View> views;
+        for (int i = 0; i < viewCount; ++i) {
+            PerspectiveCamera camera(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+            camera.transform.position = glm::vec3(0.0f, -1.7f, 0.0f);
+            const float angle = glm::two_pi<float>() * static_cast<float>(i) / viewCount;
+            camera.transform.lookAt(glm::vec3(std::cos(angle) * 10.0f, -1.9f, std::sin(angle) * 10.0f));
+            const Frustum frustum = camera.getFrustum();
+
+            std::vector<std::pair<float, uint32_t>> inView;
+            for (size_t w = 0; w < walls.size(); ++w) {
+                if (frustum.intersect(walls[w])) {
+                    inView.emplace_back(
+                        glm::length(walls[w].getCenter() - camera.transform.position), static_cast<uint32_t>(w));
+                }
+            }
+            std::sort(inView.begin(), inView.end());
+
+            View view;
+            view.viewProjection = camera.getProjectionMatrix() * camera.getViewMatrix();
+            for (const auto& wall : inView) {
+                view.walls.push_back(wall.second);
+            }
+            views.push_back(std::move(view));
+        }
+        return views;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int side = argc > 1 ? std::max(8, std::atoi(argv[1])) : 128;
+    const std::vector<BoundingBox> walls = createWalls(side);
+    const std::vector<View> views = createViews(walls);
+    size_t tested = 0;
+    for (const View& view : views) {
+        tested += view.walls.size();
+    }
+
+    std::cout << std::fixed << std::setprecision(3) << walls.size() << " walls, " << tested / viewCount
+              << " in view on average, " << ThreadPool::getGlobal().getThreadCount() << " pool threads\n";
+    std::cout << std::setw(10) << "buffer" << std::setw(11) << "occluders" << std::setw(9) << "threads"
+              << std::setw(12) << "raster ms" << std::setw(10) << "test ms" << std::setw(12) << "tests/us"
+              << std::setw(11) << "hidden %" << "\n";
+
+    const std::pair<int, int> sizes[] = { { 128, 64 }, { 256, 128 }, { 512, 256 } };
+    const size_t occluderCounts[] = { 8, 32, 128 };
+    const size_t threadCounts[] = { 1, 0 };
+    for (const auto& size : sizes) {
+        OcclusionBuffer buffer(size.first, size.second);
+        for (size_t occluderCount : occluderCounts) {
+            for (size_t threads : threadCounts) {
+                double rasterMs = 0.0, testMs = 0.0;
+                size_t hidden = 0;
+                for (int repeat = 0; repeat < repeats; ++repeat) {
+                    for (const View& view : views) {
+                        // occluders are an inner box of the walls, as in the app
+                        std::vector<BoundingBox> occluders;
+                        for (size_t i = 0; i < view.walls.size() && i < occluderCount; ++i) {
+                            const BoundingBox& wall = walls[view.walls[i]];
+                            BoundingBox occluder;
+                            occluder.min = wall.getCenter() - wall.getExtent() * 0.85f;
+                            occluder.max = wall.getCenter() + wall.getExtent() * 0.85f;
+                            occluders.push_back(occluder);
+                        }
+                        buffer.render(occluders, view.viewProjection, threads);
+
+                        std::vector<uint32_t> visible = view.walls;
+                        buffer.cullOccluded(visible, [&walls](uint32_t index) { return walls[index]; });
+                        rasterMs += buffer.getStats().rasterMs;
+                        testMs += buffer.getStats().testMs;
+                        hidden += buffer.getStats().occluded;
+                    }
+                }
+
+                const double frames = static_cast<double>(repeats * viewCount);
+                std::cout << std::setw(10) << (std::to_string(size.first) + "x" + std::to_string(size.second))
+                          << std::setw(11) << occluderCount << std::setw(9)
+                          << (threads == 0 ? std::string("all") : std::to_string(threads)) << std::setw(12)
+                          << rasterMs / frames << std::setw(10) << testMs / frames << std::setw(12)
+                          << static_cast<double>(tested * repeats) / (testMs * 1000.0) << std::setw(10)
+                          << 100.0 * static_cast<double>(hidden) / static_cast<double>(tested * repeats) << "%\n";
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+// Maze PVS precomputation: build time, memory and the share of walls left to draw per frame
+// for generated mazes from the size of the app's maze up to 512 x 512 cells.
+// The mazes are perfect mazes with some walls knocked out, which opens loops and longer
+// sight lines than the corridors alone.
+// The sets have to be conservative: up to 64 x 64 cells the sets of some of the open cells are
+// also compared to a brute force reference with a denser grid of rays, any cell the reference
+// sees but the set is missing fails the bench.
+// usage: pvs_bench [threads] [size ...], sizes as COLSxROWS, threads 0 uses all of them
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "maze_pvs.h"
+
+namespace {
+
+    // share of the remaining inner walls removed after carving
+    constexpr double braidRatio = 0.1;
+
+    // reference rays start and end on a grid of this many points per side of a cell, placed
+    // differently from the 3 x 3 samples of the pvs
+    constexpr int referenceSamples = 6;
+
+    // largest maze compared to the reference and the number of open cells whose sets are
+    // compared, spread evenly over the maze. every cell the set rejects costs all rays
+    constexpr int maxReferenceCells = 64 * 64;
+    constexpr size_t referenceSources = 32;
+
+    std::vector<std::string> generateMaze(int cols, int rows, unsigned seed) {
+        std::vector<std::string> maze(rows, std::string(cols, '#'));
+        std::mt19937 random(seed);
+        // rooms sit on odd coordinates, the last row / column stays solid for even sizes
+        const int roomCols = (cols - 1) / 2;
+        const int roomRows = (rows - 1) / 2;
+        if (roomCols <= 0 || roomRows <= 0) {
+            return maze;
+        }
+
+        std::vector<uint8_t> visited(static_cast<size_t>(roomCols) * roomRows, 0);
+        std::vector<int> stack = { 0 };
+        visited[0] = 1;
+        maze[1][1] = ' ';
+        while (!stack.empty()) {
+            const int room = stack.back();
+            const int x = room % roomCols;
+            const int y = room / roomCols;
+            int candidates[4];
+            int candidateCount = 0;
+            const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+            for (int i = 0; i < 4; ++i) {
+                const int nx = x + offsets[i][0];
+                const int ny = y + offsets[i][1];
+                if (nx >= 0 && nx < roomCols && ny >= 0 && ny < roomRows && !visited[ny * roomCols + nx]) {
+                    candidates[candidateCount++] = i;
+                }
+            }
+            if (candidateCount == 0) {
+                stack.pop_back();
+                continue;
+            }
+            const int i = candidates[random() % candidateCount];
+            const int nx = x + offsets[i][0];
+            const int ny = y + offsets[i][1];
+            visited[ny * roomCols + nx] = 1;
+            maze[2 * y + 1 + offsets[i][1]][2 * x + 1 + offsets[i][0]] = ' ';
+            maze[2 * ny + 1][2 * nx + 1] = ' ';
+            stack.push_back(ny * roomCols + nx);
+        }
+
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        for (int r = 1; r + 1 < rows; ++r) {
+            for (int c = 1; c + 1 < cols; ++c) {
+                if (maze[r][c] == '#' && (r + c) % 2 == 1 && chance(random) < braidRatio) {
+                    maze[r][c] = ' ';
+                }
+            }
+        }
+        return maze;
+    }
+
+    // true if the segment from a to b, in cell units, crosses no wall before the cell of b
+    bool isClear(const std::vector<std::string>& maze, double ax, double ay, double bx, double by) {
+        int col = static_cast<int>(std::floor(ax));
+        int row = static_cast<int>(std::floor(ay));
+        const int endCol = static_cast<int>(std::floor(bx));
+        const int endRow = static_cast<int>(std::floor(by));
+        const double dx = bx - ax;
+        const double dy = by - ay;
+        const int stepCol = dx > 0.0 ? 1 : -1;
+        const int stepRow = dy > 0.0 ? 1 : -1;
+        const double inf = std::numeric_limits<double>::infinity();
+        const double deltaX = dx != 0.0 ? std::abs(1.0 / dx) : inf;
+        const double deltaY = dy != 0.0 ? std::abs(1.0 / dy) : inf;
+        double nextX = dx != 0.0 ? ((dx > 0.0 ? col + 1 : col) - ax) / dx : inf;
+        double nextY = dy != 0.0 ? ((dy > 0.0 ? row + 1 : row) - ay) / dy : inf;
+        while (col != endCol || row != endRow) {
+            if (nextX < nextY) {
+                col += stepCol;
+                nextX += deltaX;
+            }
+            else {
+                row += stepRow;
+                nextY += deltaY;
+            }
+            if ((col != endCol || row != endRow) && maze[row][col] == '#') {
+                return false;
+            }
+            if (nextX > 1.0 && nextY > 1.0) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool isVisibleReference(const std::vector<std::string>& maze, int fromCol, int fromRow, int col, int row) {
+        for (int i = 0; i < referenceSamples * referenceSamples; ++i) {
+            const double ax = fromCol + (i % referenceSamples + 0.5) / referenceSamples;
+            const double ay = fromRow + (i / referenceSamples + 0.5) / referenceSamples;
+            for (int j = 0; j < referenceSamples * referenceSamples; ++j) {
+                const double bx = col + (j % referenceSamples + 0.5) / referenceSamples;
+                const double by = row + (j / referenceSamples + 0.5) / referenceSamples;
+                if (isClear(maze, ax, ay, bx, by)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    struct Misses {
+        // pairs of an open cell and a cell the reference or the set sees from it
+        size_t visible = 0;
+        size_t missed = 0;
+        size_t visibleWalls = 0;
+        size_t missedWalls = 0;
+    };
+
+    // only the pairs the pvs rejects are cast, pairs it accepts are conservative either way
+    Misses compareToReference(const std::vector<std::string>& maze, const MazePvs& pvs) {
+        std::vector<std::pair<int, int>> sources;
+        for (int row = 0; row < pvs.getRowCount(); ++row) {
+            for (int col = 0; col < pvs.getColumnCount(); ++col) {
+                if (pvs.hasSet(col, row)) {
+                    sources.emplace_back(col, row);
+                }
+            }
+        }
+        const size_t stride = std::max<size_t>(1, sources.size() / referenceSources);
+
+        Misses misses;
+        for (size_t source = 0; source < sources.size(); source += stride) {
+            const int fromCol = sources[source].first;
+            const int fromRow = sources[source].second;
+            for (int row = 0; row < pvs.getRowCount(); ++row) {
+                for (int col = 0; col < pvs.getColumnCount(); ++col) {
+                    const bool wall = pvs.isWall(col, row);
+                    const bool inSet = pvs.isVisible(fromCol, fromRow, col, row);
+                    if (!inSet && !isVisibleReference(maze, fromCol, fromRow, col, row)) {
+                        continue;
+                    }
+                    ++misses.visible;
+                    misses.visibleWalls += wall ? 1 : 0;
+                    if (!inSet) {
+                        ++misses.missed;
+                        misses.missedWalls += wall ? 1 : 0;
+                    }
+                }
+            }
+        }
+        return misses;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t threads = 0;
+    std::vector<std::pair<int, int>> sizes;
+    if (argc > 1) {
+        threads = static_cast<size_t>(std::max(0, std::atoi(argv[1])));
+    }
+    for (int i = 2; i < argc; ++i) {
+        int cols = 0, rows = 0;
+        if (std::sscanf(argv[i], "%dx%d", &cols, &rows) == 2 && cols > 0 && rows > 0) {
+            sizes.emplace_back(cols, rows);
+        }
+    }
+    if (sizes.empty()) {
+        sizes = { { 15, 11 }, { 31, 31 }, { 64, 64 }, { 128, 128 }, { 256, 256 }, { 512, 512 } };
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(9) << "maze" << std::setw(12) << "build ms" << std::setw(12) << "KiB" << std::setw(12)
+              << "bytes/cell" << std::setw(12) << "vis cells" << std::setw(12) << "vis walls" << std::setw(10)
+              << "walls" << std::setw(11) << "drawn %" << "\n";
+    for (const auto& size : sizes) {
+        const std::vector<std::string> maze = generateMaze(size.first, size.second, 1234u);
+        MazePvs pvs;
+        pvs.build(maze, threads);
+        const MazePvs::Stats& stats = pvs.getStats();
+        const size_t cells = static_cast<size_t>(size.first) * size.second;
+
+        std::cout << std::setw(9) << (std::to_string(size.first) + "x" + std::to_string(size.second))
+                  << std::setw(12) << stats.buildMs << std::setw(12) << pvs.getByteSize() / 1024.0 << std::setw(12)
+                  << static_cast<double>(pvs.getByteSize()) / static_cast<double>(cells) << std::setw(12)
+                  << stats.visibleCells << std::setw(12) << stats.visibleWalls << std::setw(10) << stats.wallCells
+                  << std::setw(10) << 100.0 * stats.visibleWalls / static_cast<double>(std::max<size_t>(stats.wallCells, 1))
+                  << "%\n";
+    }
+
+    std::cout << "\ncompared to " << referenceSamples << " x " << referenceSamples << " ray ends per cell, "
+              << referenceSources << " source cells per maze\n";
+    std::cout << std::setw(9) << "maze" << std::setw(14) << "visible" << std::setw(10) << "missed" << std::setw(10)
+              << "missed %" << std::setw(15) << "visible walls" << std::setw(14) << "missed walls" << "\n";
+    bool missed = false;
+    for (const auto& size : sizes) {
+        if (size.first * size.second > maxReferenceCells) {
+            continue;
+        }
+        const std::vector<std::string> maze = generateMaze(size.first, size.second, 1234u);
+        MazePvs pvs;
+        pvs.build(maze, threads);
+        const Misses misses = compareToReference(maze, pvs);
+        std::cout << std::setw(9) << (std::to_string(size.first) + "x" + std::to_string(size.second))
+                  << std::setw(14) << misses.visible << std::setw(10) << misses.missed << std::setw(9)
+                  << 100.0 * static_cast<double>(misses.missed) / static_cast<double>(std::max<size_t>(misses.visible, 1))
+                  << "%" << std::setw(15) << misses.visibleWalls << std::setw(14) << misses.missedWalls << "\n";
+        missed = missed || misses.missed != 0;
+    }
+    if (missed) {
+        std::cerr << "the pvs misses cells the reference sees" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+// Time to first frame of the maze: creates MazeApp in a hidden window, records the startup
+// phases (window, shaders, frame buffers, scene setup, first presented frame, asset streaming)
+// and tears it down again, N times per cache mode. cold unmounts the asset pack and evicts the
+// asset files from the os page cache before every run (posix only), warm runs once untimed to
+// fill it. Both modes keep the derived caches (.meshcache, .btex) valid, so cold measures the
+// disk reads of an os-cold start but not the parsing and decoding they save, the report says
+// so per mode. The medians and variances go to a json report.
+// usage: startup_bench [runs] [report.json] [cold|warm|both]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "base/asset_pack.h"
+#include "maze_app.h"
+
+namespace {
+
+    // streaming usually finishes within a few hundred frames, this only guards against hangs
+    constexpr int maxFrames = 20000;
+
+    struct PhaseStats {
+        std::vector<double> samples;
+    };
+
+    // phase name -> samples, in the order the phases first appeared
+    struct ModeResult {
+        std::vector<std::string> order;
+        std::map<std::string, PhaseStats> phases;
+        std::string description;
+        int failedRuns = 0;
+
+        void add(const std::string& name, double ms) {
+            if (phases.find(name) == phases.end()) {
+                order.push_back(name);
+            }
+            phases[name].samples.push_back(ms);
+        }
+    };
+
+    Options getBenchOptions(const std::string& assetRootDir) {
+        Options options;
+        options.assetRootDir = assetRootDir;
+        options.windowTitle = "startup_bench";
+        options.windowWidth = 1280;
+        options.windowHeight = 720;
+        options.windowResizable = false;
+        options.vSync = false;
+        options.msaa = true;
+        options.glVersion = { 3, 3 };
+        options.backgroundColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        options.windowVisible = false;
+        return options;
+    }
+
+    // drops the clean pages of every asset file, returns false where that is not possible. pages
+    // of a mapped file stay resident, so the pack has to be unmounted first
+    bool evictPageCache(const std::string& directory) {
+#ifdef _WIN32
+        (void)directory;
+        return false;
+#else
+        std::error_code ec;
+        for (const auto& item : std::filesystem::recursive_directory_iterator(directory, ec)) {
+            if (!item.is_regular_file()) {
+                continue;
+            }
+            const int fd = ::open(item.path().c_str(), O_RDONLY);
+            if (fd >= 0) {
+                ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                ::close(fd);
+            }
+        }
+        return !ec;
+#endif
+    }
+
+    bool runOnce(const Options& options, std::vector<StartupPhase>& phases) {
+        try {
+            MazeApp app(options);
+            int frames = 0;
+            do {
+                app.step();
+            } while (!app.isStreamingComplete() && ++frames < maxFrames);
+            // one more frame so that the streaming phase is closed by renderFrame
+            app.step();
+            phases = app.getStartupPhases();
+            return app.isStreamingComplete();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "run failed: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    double getMedian(std::vector<double> samples) {
+        std::sort(samples.begin(), samples.end());
+        const size_t n = samples.size();
+        return n % 2 == 1 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    }
+
+    // sample variance
+    double getVariance(const std::vector<double>& samples) {
+        if (samples.size() < 2) {
+            return 0.0;
+        }
+        double mean = 0.0;
+        for (double sample : samples) {
+            mean += sample;
+        }
+        mean /= static_cast<double>(samples.size());
+        double sum = 0.0;
+        for (double sample : samples) {
+            sum += (sample - mean) * (sample - mean);
+        }
+        return sum / static_cast<double>(samples.size() - 1);
+    }
+
+    ModeResult runMode(const std::string& mode, int runs, const Options& options, const std::string& packPath) {
+        ModeResult result;
+        const bool cold = mode == "cold";
+        bool evicted = false;
+        if (cold) {
+            AssetPack::unmount();
+            evicted = evictPageCache(options.assetRootDir);
+            if (!evicted) {
+                std::cerr << "Warning: cannot evict the page cache here, cold runs are warm" << std::endl;
+            }
+        }
+        else {
+            std::vector<StartupPhase> ignored;
+            runOnce(options, ignored);
+        }
+        if (evicted) {
+            result.description = "os page cache dropped before every run, asset caches (.meshcache, .btex) warm";
+        }
+        else {
+            result.description = "os page cache warm, asset caches (.meshcache, .btex) warm";
+        }
+
+        for (int run = 0; run < runs; ++run) {
+            if (cold) {
+                // the mapping of the pack would keep its pages resident
+                AssetPack::unmount();
+                evictPageCache(options.assetRootDir);
+                AssetPack::mount(packPath, options.assetRootDir);
+            }
+            std::vector<StartupPhase> phases;
+            if (!runOnce(options, phases)) {
+                ++result.failedRuns;
+                continue;
+            }
+
+            double firstFrameMs = 0.0;
+            double totalMs = 0.0;
+            bool firstFrameSeen = false;
+            for (const StartupPhase& phase : phases) {
+                result.add(phase.name, phase.ms);
+                totalMs += phase.ms;
+                if (!firstFrameSeen) {
+                    firstFrameMs += phase.ms;
+                    firstFrameSeen = phase.name == "first frame";
+                }
+            }
+            result.add("time to first frame", firstFrameMs);
+            result.add("time to all assets", totalMs);
+            std::cerr << mode << " run " << run + 1 << "/" << runs << ": first frame after " << firstFrameMs
+                      << " ms, all assets after " << totalMs << " ms" << std::endl;
+        }
+        return result;
+    }
+
+    void writeReport(std::ostream& out, int runs, const std::map<std::string, ModeResult>& results) {
+        out << std::fixed << std::setprecision(3);
+        out << "{\n  \"runs\": " << runs << ",\n  \"modes\": {";
+        bool firstMode = true;
+        for (const auto& [mode, result] : results) {
+            out << (firstMode ? "" : ",") << "\n    \"" << mode << "\": {\n      \"description\": \""
+                << result.description << "\",\n      \"failed_runs\": " << result.failedRuns
+                << ",\n      \"phases\": [";
+            bool firstPhase = true;
+            for (const std::string& name : result.order) {
+                const std::vector<double>& samples = result.phases.at(name).samples;
+                out << (firstPhase ? "" : ",") << "\n        { \"name\": \"" << name
+                    << "\", \"median_ms\": " << getMedian(samples) << ", \"variance_ms2\": " << getVariance(samples)
+                    << ", \"min_ms\": " << *std::min_element(samples.begin(), samples.end())
+                    << ", \"max_ms\": " << *std::max_element(samples.begin(), samples.end()) << ", \"samples\": [";
+                for (size_t i = 0; i < samples.size(); ++i) {
+                    out << (i == 0 ? "" : ", ") << samples[i];
+                }
+                out << "] }";
+                firstPhase = false;
+            }
+            out << "\n      ]\n    }";
+            firstMode = false;
+        }
+        out << "\n  }\n}\n";
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int runs = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+    const std::string reportPath = argc > 2 ? argv[2] : "startup_report.json";
+    const std::string modeArg = argc > 3 ? argv[3] : "both";
+
+    std::vector<std::string> modes;
+    if (modeArg == "cold" || modeArg == "both") {
+        modes.push_back("cold");
+    }
+    if (modeArg == "warm" || modeArg == "both") {
+        modes.push_back("warm");
+    }
+    if (modes.empty()) {
+        std::cerr << "unknown mode: " << modeArg << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string assetRootDir = "media/";
+    const std::string packPath = assetRootDir + "assets.pack";
+    // same setup as main(), cold runs mount the pack again for every run
+    AssetPack::mount(packPath, assetRootDir);
+
+    // the app logs every asset, only the bench output is of interest
+    std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+    std::map<std::string, ModeResult> results;
+    for (const std::string& mode : modes) {
+        results[mode] = runMode(mode, runs, getBenchOptions(assetRootDir), packPath);
+    }
+    std::cout.rdbuf(coutBuffer);
+
+    std::ofstream report(reportPath);
+    writeReport(report, runs, results);
+    writeReport(std::cout, runs, results);
+    if (!report) {
+        std::cerr << "failed to write " << reportPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    for (const auto& [mode, result] : results) {
+        if (result.failedRuns == runs) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
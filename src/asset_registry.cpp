@@ -0,0 +1,201 @@
+#include "asset_registry.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#include "gltf_loader.h"
+#include "mesh_cache.h"
+
+namespace {
+
+    // the same file reached through different relative paths must share one entry
+    std::string getCanonicalPath(const std::string& path) {
+        std::error_code ec;
+        const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+        return ec ? path : canonical.generic_string();
+    }
+
+} // namespace
+
+AssetRegistry& AssetRegistry::getGlobal() {
+    static AssetRegistry registry;
+    return registry;
+}
+
+std::string AssetRegistry::getTextureKey(const std::string& path) {
+    return "texture:" + getCanonicalPath(path);
+}
+
+std::string AssetRegistry::getModelKey(const std::string& path, bool loadMtl, const ModelLoadOptions& options) {
+    std::ostringstream key;
+    key << "model:" << getCanonicalPath(path) << "?flags=" << std::hex << MeshCache::getFlags(loadMtl, options)
+        << "&format=" << static_cast<int>(options.vertexFormat);
+    return key.str();
+}
+
+std::string AssetRegistry::getGltfModelKey(const std::string& path) {
+    return "gltf:" + getCanonicalPath(path);
+}
+
+std::shared_ptr<ImageTexture2D> AssetRegistry::getTexture(const std::string& path) {
+    const std::string key = getTextureKey(path);
+    if (auto texture = findTexture(key)) {
+        return texture;
+    }
+
+    auto texture = loadTexture(path);
+    addTexture(key, texture);
+    return texture;
+}
+
+std::shared_ptr<Model> AssetRegistry::getModel(const std::string& path, bool loadMtl, const ModelLoadOptions& options) {
+    const std::string key = getModelKey(path, loadMtl, options);
+    if (auto model = findModel(key)) {
+        return model;
+    }
+
+    auto model = std::make_shared<Model>(loadModelFromFile(path, loadMtl, options));
+    addModel(key, model);
+    return model;
+}
+
+std::shared_ptr<Model> AssetRegistry::getGltfModel(const std::string& path) {
+    const std::string key = getGltfModelKey(path);
+    if (auto model = findModel(key)) {
+        return model;
+    }
+
+    auto model = std::make_shared<Model>(loadModelFromGltf(path));
+    addModel(key, model);
+    return model;
+}
+
+std::shared_ptr<ImageTexture2D> AssetRegistry::findTexture(const std::string& key) {
+    return std::static_pointer_cast<ImageTexture2D>(find(key));
+}
+
+std::shared_ptr<Model> AssetRegistry::findModel(const std::string& key) {
+    return std::static_pointer_cast<Model>(find(key));
+}
+
+void AssetRegistry::addTexture(const std::string& key, const std::shared_ptr<ImageTexture2D>& texture) {
+    if (texture != nullptr) {
+        add(key, texture, texture->getByteSize());
+    }
+}
+
+void AssetRegistry::addModel(const std::string& key, const std::shared_ptr<Model>& model) {
+    if (model != nullptr) {
+        add(key, model, model->getByteSize());
+    }
+}
+
+void AssetRegistry::setMemoryBudget(size_t bytes) {
+    _memoryBudget = bytes;
+    collect();
+}
+
+size_t AssetRegistry::getMemoryBudget() const {
+    return _memoryBudget;
+}
+
+size_t AssetRegistry::getResidentBytes() const {
+    size_t bytes = 0;
+    for (const auto& [key, entry] : _entries) {
+        if (!entry.asset.expired()) {
+            bytes += entry.bytes;
+        }
+    }
+    return bytes;
+}
+
+size_t AssetRegistry::getResidentBytes(const std::string& key) const {
+    auto it = _entries.find(key);
+    return (it != _entries.end() && !it->second.asset.expired()) ? it->second.bytes : 0;
+}
+
+std::vector<AssetRegistry::AssetInfo> AssetRegistry::getAssets() const {
+    std::vector<AssetInfo> assets;
+    for (const auto& [key, entry] : _entries) {
+        const long useCount = entry.asset.use_count();
+        if (useCount == 0) {
+            continue;
+        }
+        AssetInfo info;
+        info.key = key;
+        info.bytes = entry.bytes;
+        info.retained = entry.retained != nullptr;
+        info.useCount = info.retained ? useCount - 1 : useCount;
+        assets.push_back(std::move(info));
+    }
+    std::sort(assets.begin(), assets.end(), [](const AssetInfo& lhs, const AssetInfo& rhs) {
+        return lhs.bytes > rhs.bytes;
+        });
+    return assets;
+}
+
+void AssetRegistry::collect() {
+    size_t residentBytes = 0;
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        if (it->second.asset.expired()) {
+            it = _entries.erase(it);
+        }
+        else {
+            residentBytes += it->second.bytes;
+            ++it;
+        }
+    }
+
+    // releasing a model can free its textures as well, so the candidates are recounted each time
+    while (residentBytes > _memoryBudget) {
+        Entry* victim = nullptr;
+        for (auto& [key, entry] : _entries) {
+            if (entry.retained != nullptr && entry.retained.use_count() == 1
+                && (victim == nullptr || entry.lastUse < victim->lastUse)) {
+                victim = &entry;
+            }
+        }
+        if (victim == nullptr) {
+            // everything left is in use
+            break;
+        }
+
+        victim->retained.reset();
+        residentBytes = getResidentBytes();
+    }
+}
+
+void AssetRegistry::clear() {
+    for (auto& [key, entry] : _entries) {
+        entry.retained.reset();
+    }
+    _entries.clear();
+}
+
+std::shared_ptr<void> AssetRegistry::find(const std::string& key) {
+    auto it = _entries.find(key);
+    if (it == _entries.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<void> asset = it->second.asset.lock();
+    if (asset == nullptr) {
+        _entries.erase(it);
+        return nullptr;
+    }
+    // a hit makes an evicted asset which is still in use eligible for retention again
+    it->second.retained = asset;
+    it->second.lastUse = ++_useClock;
+    return asset;
+}
+
+void AssetRegistry::add(const std::string& key, const std::shared_ptr<void>& asset, size_t bytes) {
+    Entry& entry = _entries[key];
+    entry.asset = asset;
+    entry.retained = asset;
+    entry.bytes = bytes;
+    entry.lastUse = ++_useClock;
+    collect();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "model.h"
+
+// Process wide cache of loaded models and textures. Assets are keyed by canonical path, models
+// also by the load parameters which change the uploaded data, and handed out as shared handles:
+// asking twice for the same asset returns the resident instance. Besides the handles held by
+// the users the registry keeps a strong reference to every asset so that it survives a scene
+// switch; once the resident bytes exceed the memory budget the least recently used assets which
+// nobody else holds are released. Assets in use are never evicted. gl thread only.
+class AssetRegistry {
+public:
+    struct AssetInfo {
+        std::string key;
+        size_t bytes = 0;
+        // handles held outside of the registry
+        long useCount = 0;
+        // false once evicted while still in use, the registry then only tracks it weakly
+        bool retained = false;
+    };
+
+    static AssetRegistry& getGlobal();
+
+    AssetRegistry() = default;
+
+    AssetRegistry(const AssetRegistry&) = delete;
+
+    AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+    static std::string getTextureKey(const std::string& path);
+
+    static std::string getModelKey(const std::string& path, bool loadMtl, const ModelLoadOptions& options);
+
+    static std::string getGltfModelKey(const std::string& path);
+
+    // loads (baked if possible) and registers the texture unless it is resident, throws on failure
+    std::shared_ptr<ImageTexture2D> getTexture(const std::string& path);
+
+    std::shared_ptr<Model> getModel(const std::string& path, bool loadMtl, const ModelLoadOptions& options = {});
+
+    std::shared_ptr<Model> getGltfModel(const std::string& path);
+
+    // null if the asset is not resident
+    std::shared_ptr<ImageTexture2D> findTexture(const std::string& key);
+
+    std::shared_ptr<Model> findModel(const std::string& key);
+
+    // registers assets loaded elsewhere (e.g. by the AssetStreamer)
+    void addTexture(const std::string& key, const std::shared_ptr<ImageTexture2D>& texture);
+
+    void addModel(const std::string& key, const std::shared_ptr<Model>& model);
+
+    void setMemoryBudget(size_t bytes);
+
+    size_t getMemoryBudget() const;
+
+    // gpu bytes of all live assets, whether retained or only held by users
+    size_t getResidentBytes() const;
+
+    // 0 if the asset is not resident
+    size_t getResidentBytes(const std::string& key) const;
+
+    std::vector<AssetInfo> getAssets() const;
+
+    // drops the retained references of unused assets beyond the budget and forgets dead ones,
+    // runs after every insertion
+    void collect();
+
+    // releases every retained reference, call before the gl context goes away
+    void clear();
+
+private:
+    struct Entry {
+        std::weak_ptr<void> asset;
+        // null once evicted
+        std::shared_ptr<void> retained;
+        size_t bytes = 0;
+        uint64_t lastUse = 0;
+    };
+
+    std::unordered_map<std::string, Entry> _entries;
+    // shared by all scenes of the maze with room to spare
+    size_t _memoryBudget = size_t(256) << 20;
+    uint64_t _useClock = 0;
+
+    // keys carry the asset type as prefix, so the cast back is safe
+    std::shared_ptr<void> find(const std::string& key);
+
+    void add(const std::string& key, const std::shared_ptr<void>& asset, size_t bytes);
+};
@@ -0,0 +1,442 @@
+#include "asset_streamer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "asset_registry.h"
+#include "gltf_loader.h"
+#include "mesh_cache.h"
+
+namespace {
+
+    // bytes copied into a pixel buffer object per map, small enough to check the budget often
+    constexpr size_t pixelChunkBytes = 1 << 20;
+
+    struct PendingImage {
+        std::string path;
+        // mapped instead of decoded when a valid bake exists
+        bool hasBake = false;
+        BakedTexture bake;
+        DecodedImage decoded;
+    };
+
+    GLenum getPixelFormat(int channels) {
+        switch (channels) {
+        case 1: return GL_RED;
+        case 3: return GL_RGB;
+        case 4: return GL_RGBA;
+        default: return GL_NONE;
+        }
+    }
+
+    // maps the bakes and decodes the remaining images of a model in parallel
+    std::vector<PendingImage> loadImages(const std::vector<std::string>& paths) {
+        std::vector<PendingImage> images(paths.size());
+        std::vector<std::string> decodePaths;
+        std::vector<size_t> decodeSlots;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            images[i].path = paths[i];
+            images[i].hasBake = images[i].bake.open(paths[i]);
+            if (!images[i].hasBake) {
+                decodePaths.push_back(paths[i]);
+                decodeSlots.push_back(i);
+            }
+        }
+
+        std::vector<DecodedImage> decoded = decodeImages(decodePaths);
+        for (size_t k = 0; k < decoded.size(); ++k) {
+            DecodedImage& image = decoded[k];
+            if (image.pixels != nullptr && getPixelFormat(image.channels) == GL_NONE) {
+                std::cerr << "  -> ERROR: Unsupported texture format: " << image.path << std::endl;
+                image.pixels.reset();
+            }
+            images[decodeSlots[k]].decoded = std::move(image);
+        }
+        return images;
+    }
+
+    std::string getDirectory(const std::string& path) {
+        const auto lastSlash = path.find_last_of("/\\");
+        return (lastSlash == std::string::npos) ? "" : path.substr(0, lastSlash + 1);
+    }
+
+} // namespace
+
+struct AssetStreamer::Payload {
+    std::shared_ptr<StreamedModel> target;
+    // AssetRegistry key
+    std::string key;
+    bool loadMtl = false;
+    ModelLoadOptions options;
+    bool gltf = false;
+    Clock::time_point requestTime;
+    float decodeMs = 0.0f;
+    std::string error;
+
+    std::string directory;
+    // obj: either the mapped cache or the freshly built model data
+    bool fromCache = false;
+    MeshCache cache;
+    std::vector<MeshData> cacheMeshInfos;
+    ModelData data;
+    // per mesh, encoded on the worker so that the upload only copies them
+    std::vector<EncodedVertices> vertices;
+    // gltf
+    std::unique_ptr<GltfScene> scene;
+
+    std::vector<PendingImage> images;
+};
+
+struct AssetStreamer::UploadJob {
+    std::shared_ptr<Payload> payload;
+    TextureCache textures;
+    size_t nextImage = 0;
+    GLuint pixelBuffer = 0;
+    size_t pixelOffset = 0;
+    std::vector<Mesh> meshes;
+    float uploadMs = 0.0f;
+    int frames = 0;
+};
+
+AssetStreamer::AssetStreamer(size_t workerCount) : _workers(workerCount) {}
+
+AssetStreamer::~AssetStreamer() {
+    _cancelled = true;
+    for (const auto& job : _uploads) {
+        if (job->pixelBuffer != 0) {
+            glDeleteBuffers(1, &job->pixelBuffer);
+        }
+    }
+}
+
+std::shared_ptr<StreamedModel> AssetStreamer::requestModel(
+    const std::string& path, bool loadMtl, const ModelLoadOptions& options) {
+    const std::string key = AssetRegistry::getModelKey(path, loadMtl, options);
+    if (auto request = findRequest(key, path)) {
+        return request;
+    }
+
+    auto payload = std::make_shared<Payload>();
+    payload->target = std::make_shared<StreamedModel>();
+    payload->target->path = path;
+    payload->key = key;
+    payload->loadMtl = loadMtl;
+    payload->options = options;
+    submit(payload);
+    return payload->target;
+}
+
+std::shared_ptr<StreamedModel> AssetStreamer::requestGltfModel(const std::string& path) {
+    const std::string key = AssetRegistry::getGltfModelKey(path);
+    if (auto request = findRequest(key, path)) {
+        return request;
+    }
+
+    auto payload = std::make_shared<Payload>();
+    payload->target = std::make_shared<StreamedModel>();
+    payload->target->path = path;
+    payload->key = key;
+    payload->gltf = true;
+    submit(payload);
+    return payload->target;
+}
+
+std::shared_ptr<StreamedModel> AssetStreamer::findRequest(const std::string& key, const std::string& path) {
+    // resident models are handed out ready to draw
+    if (auto model = AssetRegistry::getGlobal().findModel(key)) {
+        auto request = std::make_shared<StreamedModel>();
+        request->path = path;
+        request->model = model;
+        return request;
+    }
+
+    // the same model requested twice while in flight shares one load
+    auto it = _requests.find(key);
+    if (it != _requests.end()) {
+        if (auto request = it->second.lock()) {
+            return request;
+        }
+    }
+    return nullptr;
+}
+
+void AssetStreamer::submit(const std::shared_ptr<Payload>& payload) {
+    payload->requestTime = Clock::now();
+    _requests[payload->key] = payload->target;
+    ++_pendingCount;
+
+    _workers.submit([this, payload]() {
+        if (_cancelled) {
+            return;
+        }
+
+        Payload& p = *payload;
+        const std::string& path = p.target->path;
+        p.directory = getDirectory(path);
+        std::vector<std::string> texturePaths;
+        const auto addTexture = [&](const std::string& relativePath) {
+            const std::string texturePath = p.directory + relativePath;
+            if (!relativePath.empty()
+                && std::find(texturePaths.begin(), texturePaths.end(), texturePath) == texturePaths.end()) {
+                texturePaths.push_back(texturePath);
+            }
+            };
+
+        const auto begin = Clock::now();
+        try {
+            if (p.gltf) {
+                p.scene = std::make_unique<GltfScene>(loadGltfScene(path));
+                for (const GltfPrimitive& primitive : p.scene->primitives) {
+                    addTexture(primitive.texturePath);
+                }
+            }
+            else {
+                const uint32_t cacheFlags = MeshCache::getFlags(p.loadMtl, p.options);
+                p.fromCache = p.options.useMeshCache && p.cache.open(path, cacheFlags);
+                if (p.fromCache) {
+                    for (size_t i = 0; i < p.cache.getMeshCount(); ++i) {
+                        p.cacheMeshInfos.push_back(p.cache.getMeshInfo(i));
+                    }
+                }
+                else {
+                    p.data = buildModelData(path, p.loadMtl, p.options);
+                    if (p.options.useMeshCache) {
+                        MeshCache::write(path, cacheFlags, p.data);
+                    }
+                }
+                if (p.fromCache) {
+                    for (size_t i = 0; i < p.cache.getMeshCount(); ++i) {
+                        p.vertices.push_back(encodeVertices(
+                            p.cache.getVertices(i), p.cache.getVertexCount(i), p.options.vertexFormat));
+                    }
+                }
+                else {
+                    for (const MeshData& meshData : p.data.meshes) {
+                        p.vertices.push_back(encodeVertices(
+                            meshData.vertices.data(), meshData.vertices.size(), p.options.vertexFormat));
+                    }
+                }
+                for (const MeshData& meshData : p.fromCache ? p.cacheMeshInfos : p.data.meshes) {
+                    addTexture(meshData.texturePath);
+                }
+            }
+
+            p.images = loadImages(texturePaths);
+        }
+        catch (const std::exception& e) {
+            p.error = e.what();
+        }
+        p.decodeMs = std::chrono::duration<float, std::milli>(Clock::now() - begin).count();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _completed.push_back(payload);
+        });
+}
+
+void AssetStreamer::update(float budgetMs) {
+    const auto begin = Clock::now();
+    const auto deadline = begin + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float, std::milli>(budgetMs));
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        while (!_completed.empty()) {
+            auto job = std::make_unique<UploadJob>();
+            job->payload = std::move(_completed.front());
+            _completed.pop_front();
+            _uploads.push_back(std::move(job));
+        }
+    }
+    if (_uploads.empty()) {
+        return;
+    }
+
+    UploadJob* counted = nullptr;
+    while (!_uploads.empty() && Clock::now() < deadline) {
+        UploadJob& job = *_uploads.front();
+        Payload& payload = *job.payload;
+        if (counted != &job) {
+            ++job.frames;
+            counted = &job;
+        }
+        const auto stepBegin = Clock::now();
+
+        if (!payload.error.empty()) {
+            std::cerr << "Failed to stream " << payload.target->path << ": " << payload.error << std::endl;
+            payload.target->failed = true;
+            _requests.erase(payload.key);
+            --_pendingCount;
+            _uploads.pop_front();
+            continue;
+        }
+
+        bool done = false;
+        if (job.nextImage < payload.images.size()) {
+            if (uploadImage(job, deadline)) {
+                ++job.nextImage;
+            }
+        }
+        else if (payload.gltf) {
+            payload.target->model = std::make_shared<Model>(createModel(*payload.scene, job.textures));
+            done = true;
+        }
+        else {
+            // one mesh per step
+            const size_t i = job.meshes.size();
+            if (payload.fromCache) {
+                job.meshes.push_back(createMesh(
+                    payload.cacheMeshInfos[i], payload.vertices[i], payload.cache.getIndices(i),
+                    payload.cache.getIndexCount(i), payload.directory, job.textures));
+            }
+            else {
+                const MeshData& meshData = payload.data.meshes[i];
+                job.meshes.push_back(createMesh(
+                    meshData, payload.vertices[i], meshData.indices.data(), meshData.indices.size(),
+                    payload.directory, job.textures));
+            }
+            const size_t meshCount = payload.fromCache ? payload.cacheMeshInfos.size() : payload.data.meshes.size();
+            if (job.meshes.size() == meshCount) {
+                payload.target->model = std::make_shared<Model>(std::move(job.meshes));
+                done = true;
+            }
+        }
+
+        job.uploadMs += std::chrono::duration<float, std::milli>(Clock::now() - stepBegin).count();
+        if (done) {
+            finish(job);
+            _uploads.pop_front();
+        }
+    }
+
+    _maxUpdateMs = std::max(_maxUpdateMs, std::chrono::duration<float, std::milli>(Clock::now() - begin).count());
+}
+
+bool AssetStreamer::uploadImage(UploadJob& job, Clock::time_point deadline) {
+    AssetRegistry& registry = AssetRegistry::getGlobal();
+    const PendingImage& pending = job.payload->images[job.nextImage];
+    const std::string textureKey = AssetRegistry::getTextureKey(pending.path);
+    if (auto texture = registry.findTexture(textureKey)) {
+        // already uploaded for another model, the decoded copy is dropped
+        job.textures[pending.path] = texture;
+        return true;
+    }
+    if (pending.hasBake) {
+        // compressed levels are small, they go up in one step straight from the mapping
+        try {
+            job.textures[pending.path] = std::make_shared<ImageTexture2D>(pending.bake, pending.path);
+            registry.addTexture(textureKey, job.textures[pending.path]);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << std::endl;
+            job.textures[pending.path] = nullptr;
+        }
+        return true;
+    }
+
+    const DecodedImage& image = pending.decoded;
+    if (image.pixels == nullptr) {
+        // remembered as missing so that createMesh does not try to load it synchronously
+        job.textures[pending.path] = nullptr;
+        return true;
+    }
+
+    const size_t size = static_cast<size_t>(image.width) * image.height * image.channels;
+    if (job.pixelBuffer == 0) {
+        glGenBuffers(1, &job.pixelBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+        job.pixelOffset = 0;
+    }
+    else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.pixelBuffer);
+    }
+
+    // the buffer is fresh, the gpu cannot be reading the ranges written here
+    while (job.pixelOffset < size && Clock::now() < deadline) {
+        const size_t chunk = std::min(pixelChunkBytes, size - job.pixelOffset);
+        void* dst = glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(job.pixelOffset), static_cast<GLsizeiptr>(chunk),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (dst == nullptr) {
+            break;
+        }
+        std::memcpy(dst, image.pixels.get() + job.pixelOffset, chunk);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        job.pixelOffset += chunk;
+    }
+
+    bool complete = false;
+    if (job.pixelOffset == size) {
+        // with a pixel unpack buffer bound the data pointer is an offset into it
+        const GLenum format = getPixelFormat(image.channels);
+        try {
+            job.textures[image.path] = std::make_shared<ImageTexture2D>(
+                nullptr, image.width, image.height, image.channels, static_cast<GLint>(format), format,
+                GL_UNSIGNED_BYTE, image.path);
+            registry.addTexture(textureKey, job.textures[image.path]);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "  -> ERROR: Failed to upload texture: " << e.what() << std::endl;
+            job.textures[image.path] = nullptr;
+        }
+        glDeleteBuffers(1, &job.pixelBuffer);
+        job.pixelBuffer = 0;
+        complete = true;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return complete;
+}
+
+void AssetStreamer::finish(UploadJob& job) {
+    const Payload& payload = *job.payload;
+    AssetRegistry::getGlobal().addModel(payload.key, payload.target->model);
+    _requests.erase(payload.key);
+    --_pendingCount;
+    std::cout << "Streamed " << payload.target->path << ": ready after "
+              << std::chrono::duration<float, std::milli>(Clock::now() - payload.requestTime).count()
+              << " ms (worker " << payload.decodeMs << " ms, upload " << job.uploadMs << " ms over "
+              << job.frames << " frames, " << payload.images.size() << " textures)" << std::endl;
+}
+
+size_t AssetStreamer::getPendingCount() const {
+    return _pendingCount;
+}
+
+float AssetStreamer::getMaxUpdateMs() const {
+    return _maxUpdateMs;
+}
+
+Model createPlaceholderModel() {
+    MeshData meshData;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (float sign : { -1.0f, 1.0f }) {
+            glm::vec3 normal(0.0f);
+            normal[axis] = sign;
+            const glm::vec3 u = glm::vec3(normal.y, normal.z, normal.x);
+            const glm::vec3 v = glm::cross(normal, u);
+            const uint32_t base = static_cast<uint32_t>(meshData.vertices.size());
+            for (int corner = 0; corner < 4; ++corner) {
+                const float a = (corner == 1 || corner == 2) ? 0.5f : -0.5f;
+                const float b = (corner >= 2) ? 0.5f : -0.5f;
+                Vertex vertex{};
+                vertex.position = 0.5f * normal + a * u + b * v;
+                vertex.normal = normal;
+                vertex.texCoord = glm::vec2(a + 0.5f, b + 0.5f);
+                meshData.vertices.push_back(vertex);
+            }
+            for (uint32_t index : { 0u, 1u, 2u, 0u, 2u, 3u }) {
+                meshData.indices.push_back(base + index);
+            }
+        }
+    }
+
+    TextureCache textureCache;
+    std::vector<Mesh> meshes;
+    meshes.push_back(createMesh(
+        meshData, encodeVertices(meshData.vertices.data(), meshData.vertices.size(), VertexFormat::Float),
+        meshData.indices.data(), meshData.indices.size(), "", textureCache));
+    return Model(std::move(meshes));
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "base/thread_pool.h"
+#include "model.h"
+
+// handle of a model requested from the AssetStreamer, only touched on the gl thread
+struct StreamedModel {
+    std::string path;
+    // null until the upload finished
+    std::shared_ptr<Model> model;
+    bool failed = false;
+};
+
+// Loads models in the background: worker threads parse / deduplicate the geometry (or map
+// the mesh cache / gltf buffers) and decode the textures, the gl thread uploads the results
+// in update() under a time budget per frame. Textures go through pixel buffer objects which
+// are filled in chunks, so a large image is spread over several frames. Images with a valid
+// bake (see BakedTexture) are mapped instead of decoded and uploaded in one step.
+class AssetStreamer {
+public:
+    explicit AssetStreamer(size_t workerCount = 2);
+
+    AssetStreamer(const AssetStreamer&) = delete;
+
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    ~AssetStreamer();
+
+    // models resident in the AssetRegistry are returned ready, models already in flight are
+    // shared with the earlier request
+    std::shared_ptr<StreamedModel> requestModel(
+        const std::string& path, bool loadMtl, const ModelLoadOptions& options = {});
+
+    std::shared_ptr<StreamedModel> requestGltfModel(const std::string& path);
+
+    // uploads finished payloads until budgetMs is used up, call once per frame on the gl thread
+    void update(float budgetMs);
+
+    // requested models which are not ready (or failed) yet
+    size_t getPendingCount() const;
+
+    // longest update() so far, a single mesh upload cannot be split and may exceed the budget
+    float getMaxUpdateMs() const;
+
+private:
+    struct Payload;
+    struct UploadJob;
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    // in flight by AssetRegistry key, only touched on the gl thread
+    std::unordered_map<std::string, std::weak_ptr<StreamedModel>> _requests;
+
+    std::mutex _mutex;
+    // decoded on a worker, waiting for the gl thread
+    std::deque<std::shared_ptr<Payload>> _completed;
+    // owned by the gl thread
+    std::deque<std::unique_ptr<UploadJob>> _uploads;
+    size_t _pendingCount = 0;
+    float _maxUpdateMs = 0.0f;
+    // skips the requests still queued on shutdown
+    std::atomic<bool> _cancelled{ false };
+
+    // declared last so that the workers are joined before the queues are destroyed
+    ThreadPool _workers;
+
+    std::shared_ptr<StreamedModel> findRequest(const std::string& key, const std::string& path);
+
+    void submit(const std::shared_ptr<Payload>& payload);
+
+    // returns true when the current image of the job is complete
+    bool uploadImage(UploadJob& job, Clock::time_point deadline);
+
+    void finish(UploadJob& job);
+};
+
+// unit cube (like the normalized models) drawn while the real model is streamed in
+Model createPlaceholderModel();
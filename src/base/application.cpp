@@ -19,6 +19,7 @@ Application::Application(const Options& options)
 
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RESIZABLE, options.windowResizable);
+    glfwWindowHint(GLFW_VISIBLE, options.windowVisible ? GLFW_TRUE : GLFW_FALSE);
 
     if (options.msaa) {
         glfwWindowHint(GLFW_SAMPLES, 4);
@@ -72,6 +73,7 @@ Application::Application(const Options& options)
 
     // record time
     _lastTimeStamp = std::chrono::high_resolution_clock::now();
+    markStartupPhase("window");
 }
 
 Application::~Application() {
@@ -85,13 +87,33 @@ Application::~Application() {
 
 void Application::run() {
     while (!glfwWindowShouldClose(_window)) {
-        updateTime();
-        handleInput();
-        renderFrame();
+        step();
+    }
+}
 
-        glfwSwapBuffers(_window);
-        glfwPollEvents();
+void Application::step() {
+    updateTime();
+    handleInput();
+    renderFrame();
+
+    glfwSwapBuffers(_window);
+    if (!_firstFramePresented) {
+        // the swap only queues the frame
+        glFinish();
+        markStartupPhase("first frame");
+        _firstFramePresented = true;
     }
+    glfwPollEvents();
+}
+
+const std::vector<StartupPhase>& Application::getStartupPhases() const {
+    return _startupPhases;
+}
+
+void Application::markStartupPhase(const std::string& name) {
+    const auto now = std::chrono::high_resolution_clock::now();
+    _startupPhases.push_back({ name, std::chrono::duration<double, std::milli>(now - _phaseBegin).count() });
+    _phaseBegin = now;
 }
 
 std::string Application::getAssetFullPath(const std::string& resourceRelPath) const {
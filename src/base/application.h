@@ -4,6 +4,7 @@
 #include <functional>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -23,6 +24,13 @@ struct Options {
     bool msaa;
     std::pair<int, int> glVersion;
     glm::vec4 backgroundColor;
+    // hidden windows still get a full context, used by the benchmarks
+    bool windowVisible = true;
+};
+
+struct StartupPhase {
+    std::string name;
+    double ms = 0.0;
 };
 
 class Application {
@@ -37,6 +45,13 @@ public:
 
     void run();
 
+    // renders and presents a single frame, run() is a loop of these
+    void step();
+
+    // in the order the phases ended, each one starts where the previous one ended. the first
+    // phase starts at the top of the Application constructor
+    const std::vector<StartupPhase>& getStartupPhases() const;
+
 protected:
     /* _assetPath */
     std::string _assetRootDir;
@@ -53,6 +68,11 @@ protected:
     float _deltaTime = 0.0f;
     FrameRateIndicator _fpsIndicator{64};
 
+    /* startup profile */
+    std::vector<StartupPhase> _startupPhases;
+    std::chrono::time_point<std::chrono::high_resolution_clock> _phaseBegin = std::chrono::high_resolution_clock::now();
+    bool _firstFramePresented = false;
+
     /* input handler */
     Input _input;
 
@@ -63,6 +83,8 @@ protected:
 
     void updateTime();
 
+    void markStartupPhase(const std::string& name);
+
     /* derived class can override this function to handle input */
     virtual void handleInput() = 0;
 
@@ -0,0 +1,317 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+    constexpr char packMagic[8] = { 'A', 'S', 'S', 'E', 'T', 'P', 'C', 'K' };
+    constexpr uint32_t packVersion = 1;
+    // covers the alignment the mesh cache and baked texture formats rely on
+    constexpr uint64_t dataAlignment = 64;
+
+    struct PackHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t entryCount;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+
+    struct PackEntry {
+        uint64_t hash;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint32_t pathOffset;
+        uint32_t pathLength;
+    };
+
+    static_assert(sizeof(PackHeader) == 32, "PackHeader layout changed");
+    static_assert(sizeof(PackEntry) == 48, "PackEntry layout changed");
+
+    // fnv-1a
+    uint64_t hashPath(const char* path, size_t length) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(path[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    bool getFileStamp(const std::string& path, uint64_t& size, int64_t& time) {
+        std::error_code ec;
+        size = static_cast<uint64_t>(std::filesystem::file_size(path, ec));
+        if (ec) {
+            return false;
+        }
+        const auto writeTime = std::filesystem::last_write_time(path, ec);
+        if (ec) {
+            return false;
+        }
+        time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+        return true;
+    }
+
+    std::string normalizePath(const std::string& path) {
+        std::error_code ec;
+        std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+        if (ec) {
+            absolute = path;
+        }
+        return absolute.lexically_normal().generic_string();
+    }
+
+    struct MountedPack {
+        AssetPack pack;
+        // normalized, ends with a slash
+        std::string mountPoint;
+        bool mounted = false;
+    };
+
+    MountedPack& getMountedPack() {
+        static MountedPack mounted;
+        return mounted;
+    }
+
+    const PackEntry* getEntries(const MappedFile& file) {
+        return reinterpret_cast<const PackEntry*>(file.data() + sizeof(PackHeader));
+    }
+
+} // namespace
+
+bool AssetPack::open(const std::string& path) {
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return false;
+    }
+
+    try {
+        _file = MappedFile(path);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl;
+        return false;
+    }
+
+    const uint64_t fileSize = _file.size();
+    if (fileSize < sizeof(PackHeader)) {
+        _file = MappedFile();
+        return false;
+    }
+
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(_file.data());
+    const uint64_t entriesEnd = sizeof(PackHeader) + uint64_t(header->entryCount) * sizeof(PackEntry);
+    bool valid = std::memcmp(header->magic, packMagic, sizeof(packMagic)) == 0 && header->version == packVersion
+                 && entriesEnd <= fileSize && header->stringsOffset >= entriesEnd
+                 && header->stringsOffset + header->stringsSize <= fileSize;
+    const PackEntry* entries = getEntries(_file);
+    for (uint32_t i = 0; valid && i < header->entryCount; ++i) {
+        const PackEntry& entry = entries[i];
+        valid = uint64_t(entry.pathOffset) + entry.pathLength <= header->stringsSize
+                && entry.offset % dataAlignment == 0 && entry.offset + entry.size <= fileSize
+                && (i == 0 || entries[i - 1].hash <= entry.hash);
+    }
+    if (!valid) {
+        std::cerr << "Warning: damaged asset pack: " << path << std::endl;
+        _file = MappedFile();
+        return false;
+    }
+
+    _entryCount = header->entryCount;
+    return true;
+}
+
+size_t AssetPack::getEntryCount() const {
+    return _entryCount;
+}
+
+bool AssetPack::find(const std::string& relativePath, AssetSpan& span) const {
+    if (_entryCount == 0) {
+        return false;
+    }
+
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(_file.data());
+    const char* strings = _file.data() + header->stringsOffset;
+    const PackEntry* begin = getEntries(_file);
+    const PackEntry* end = begin + _entryCount;
+    const uint64_t hash = hashPath(relativePath.data(), relativePath.size());
+    auto it = std::lower_bound(begin, end, hash, [](const PackEntry& entry, uint64_t value) {
+        return entry.hash < value;
+        });
+    // equal hashes are adjacent, the path decides
+    for (; it != end && it->hash == hash; ++it) {
+        if (it->pathLength == relativePath.size()
+            && std::memcmp(strings + it->pathOffset, relativePath.data(), relativePath.size()) == 0) {
+            span.data = _file.data() + it->offset;
+            span.size = static_cast<size_t>(it->size);
+            span.sourceSize = it->sourceSize;
+            span.sourceTime = it->sourceTime;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AssetPack::write(const std::string& packPath, const std::vector<AssetPackInput>& inputs) {
+    struct Pending {
+        PackEntry entry{};
+        const AssetPackInput* input = nullptr;
+    };
+
+    std::vector<Pending> pending;
+    std::string strings;
+    for (const AssetPackInput& input : inputs) {
+        Pending p;
+        p.input = &input;
+        if (!getFileStamp(input.sourcePath, p.entry.sourceSize, p.entry.sourceTime)) {
+            std::cerr << "Warning: failed to pack " << input.sourcePath << std::endl;
+            return false;
+        }
+        p.entry.size = p.entry.sourceSize;
+        p.entry.hash = hashPath(input.relativePath.data(), input.relativePath.size());
+        p.entry.pathOffset = static_cast<uint32_t>(strings.size());
+        p.entry.pathLength = static_cast<uint32_t>(input.relativePath.size());
+        strings += input.relativePath;
+        pending.push_back(p);
+    }
+    std::sort(pending.begin(), pending.end(), [](const Pending& lhs, const Pending& rhs) {
+        return lhs.entry.hash < rhs.entry.hash;
+        });
+
+    PackHeader header{};
+    std::memcpy(header.magic, packMagic, sizeof(packMagic));
+    header.version = packVersion;
+    header.entryCount = static_cast<uint32_t>(pending.size());
+    header.stringsOffset = sizeof(PackHeader) + pending.size() * sizeof(PackEntry);
+    header.stringsSize = strings.size();
+
+    // contents in input order, which keeps files loaded together next to each other
+    std::vector<Pending*> byInput;
+    for (Pending& p : pending) {
+        byInput.push_back(&p);
+    }
+    std::sort(byInput.begin(), byInput.end(), [](const Pending* lhs, const Pending* rhs) {
+        return lhs->input < rhs->input;
+        });
+    uint64_t offset = header.stringsOffset + header.stringsSize;
+    for (Pending* p : byInput) {
+        offset = alignUp(offset, dataAlignment);
+        p->entry.offset = offset;
+        offset += p->entry.size;
+    }
+
+    const std::string tempPath = packPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Warning: failed to write asset pack: " << packPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const Pending& p : pending) {
+            out.write(reinterpret_cast<const char*>(&p.entry), sizeof(p.entry));
+        }
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+        uint64_t written = header.stringsOffset + header.stringsSize;
+        const char padding[dataAlignment] = {};
+        for (const Pending* p : byInput) {
+            out.write(padding, static_cast<std::streamsize>(p->entry.offset - written));
+            try {
+                const MappedFile file(p->input->sourcePath);
+                if (file.size() != p->entry.size) {
+                    throw std::runtime_error("file changed while packing: " + p->input->sourcePath);
+                }
+                out.write(file.data(), static_cast<std::streamsize>(file.size()));
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Warning: " << e.what() << std::endl;
+                out.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+            written = p->entry.offset + p->entry.size;
+        }
+        if (!out) {
+            std::cerr << "Warning: failed to write asset pack: " << packPath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, packPath, ec);
+    if (ec) {
+        std::cerr << "Warning: failed to write asset pack: " << packPath << " (" << ec.message() << ")" << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool AssetPack::mount(const std::string& packPath, const std::string& mountPoint) {
+    MountedPack& mounted = getMountedPack();
+    mounted.mounted = false;
+    if (!mounted.pack.open(packPath)) {
+        return false;
+    }
+
+    mounted.mountPoint = normalizePath(mountPoint);
+    if (mounted.mountPoint.empty() || mounted.mountPoint.back() != '/') {
+        mounted.mountPoint += '/';
+    }
+    mounted.mounted = true;
+    std::cout << "Mounted asset pack: " << packPath << " (" << mounted.pack.getEntryCount() << " files)" << std::endl;
+    return true;
+}
+
+void AssetPack::unmount() {
+    MountedPack& mounted = getMountedPack();
+    mounted.mounted = false;
+    mounted.pack = AssetPack();
+}
+
+bool AssetPack::findMounted(const std::string& path, AssetSpan& span) {
+    const MountedPack& mounted = getMountedPack();
+    if (!mounted.mounted) {
+        return false;
+    }
+
+    const std::string normalized = normalizePath(path);
+    if (normalized.compare(0, mounted.mountPoint.size(), mounted.mountPoint) != 0) {
+        return false;
+    }
+    return mounted.pack.find(normalized.substr(mounted.mountPoint.size()), span);
+}
+
+bool assetExists(const std::string& path) {
+    AssetSpan span;
+    if (AssetPack::findMounted(path, span)) {
+        return true;
+    }
+    std::error_code ec;
+    return std::filesystem::exists(path, ec);
+}
+
+bool getAssetStamp(const std::string& path, uint64_t& size, int64_t& time) {
+    AssetSpan span;
+    if (AssetPack::findMounted(path, span)) {
+        size = span.sourceSize;
+        time = span.sourceTime;
+        return true;
+    }
+    return getFileStamp(path, size, time);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// a packed file, points into the mapping of the pack
+struct AssetSpan {
+    const char* data = nullptr;
+    size_t size = 0;
+    // size / modification time of the loose file when it was packed, so that the stamps of mesh
+    // caches and baked textures still match without the sources on disk
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+};
+
+struct AssetPackInput {
+    // key of the entry, relative to the packed directory with forward slashes
+    std::string relativePath;
+    std::string sourcePath;
+};
+
+// All assets in one file written by tools/asset_packer: a header, an index sorted by the hash of
+// the relative path, the path strings and the file contents aligned for direct use. The pack
+// is mapped once and lookups return spans into the mapping, so a cold start reads one file
+// sequentially instead of opening every asset.
+//
+// A mounted pack serves the files below its mount point to MappedFile and the helpers below,
+// anything not packed is read from the loose files as before. Mount before any loader runs,
+// lookups are not synchronized with mount().
+class AssetPack {
+public:
+    // returns false if the pack is missing or damaged
+    bool open(const std::string& path);
+
+    size_t getEntryCount() const;
+
+    // relativePath uses forward slashes, returns false if it is not packed
+    bool find(const std::string& relativePath, AssetSpan& span) const;
+
+    // writes the pack atomically, failures are reported and ignored
+    static bool write(const std::string& packPath, const std::vector<AssetPackInput>& inputs);
+
+    // mountPoint is the directory which was packed, usually the asset root
+    static bool mount(const std::string& packPath, const std::string& mountPoint);
+
+    static void unmount();
+
+    // looks an absolute or relative file path up in the mounted pack
+    static bool findMounted(const std::string& path, AssetSpan& span);
+
+private:
+    MappedFile _file;
+    size_t _entryCount = 0;
+};
+
+// loose file or packed entry, either way
+bool assetExists(const std::string& path);
+
+// size and modification time of the loose file, or the ones recorded in the pack
+bool getAssetStamp(const std::string& path, uint64_t& size, int64_t& time);
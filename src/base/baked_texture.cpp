@@ -0,0 +1,371 @@
+#include "baked_texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include "asset_pack.h"
+
+namespace {
+
+    constexpr char bakedMagic[8] = { 'B', 'A', 'K', 'E', 'D', 'T', 'E', 'X' };
+    // bump whenever the layout below or the filtering / compression changes
+    constexpr uint32_t bakedVersion = 1;
+
+    struct BakedHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t format;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t reserved;
+    };
+
+    struct BakedLevelEntry {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    bool isCompressedFormat(BakedTextureFormat format) {
+        return format == BakedTextureFormat::BC1 || format == BakedTextureFormat::BC3;
+    }
+
+    size_t getLevelByteSize(BakedTextureFormat format, int width, int height) {
+        const size_t w = static_cast<size_t>(width);
+        const size_t h = static_cast<size_t>(height);
+        switch (format) {
+        case BakedTextureFormat::R8: return w * h;
+        case BakedTextureFormat::RGB8: return w * h * 3;
+        case BakedTextureFormat::RGBA8: return w * h * 4;
+        case BakedTextureFormat::BC1: return ((w + 3) / 4) * ((h + 3) / 4) * 8;
+        case BakedTextureFormat::BC3: return ((w + 3) / 4) * ((h + 3) / 4) * 16;
+        default: return 0;
+        }
+    }
+
+    const BakedHeader* getHeader(const MappedFile& file) {
+        return reinterpret_cast<const BakedHeader*>(file.data());
+    }
+
+    const BakedLevelEntry& getLevelEntry(const MappedFile& file, size_t level) {
+        return reinterpret_cast<const BakedLevelEntry*>(file.data() + sizeof(BakedHeader))[level];
+    }
+
+    float srgbToLinear(float c) {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float c) {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    // one mip level in float, color channels in linear light
+    struct FloatImage {
+        int width = 0;
+        int height = 0;
+        std::vector<float> pixels;
+    };
+
+    FloatImage downsample(const FloatImage& src, int channels) {
+        FloatImage dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = std::max(1, src.height / 2);
+        dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * channels);
+        for (int y = 0; y < dst.height; ++y) {
+            // odd sizes drop the last row / column into the clamp
+            const int y0 = std::min(2 * y, src.height - 1);
+            const int y1 = std::min(2 * y + 1, src.height - 1);
+            for (int x = 0; x < dst.width; ++x) {
+                const int x0 = std::min(2 * x, src.width - 1);
+                const int x1 = std::min(2 * x + 1, src.width - 1);
+                for (int c = 0; c < channels; ++c) {
+                    const auto at = [&](int sx, int sy) {
+                        return src.pixels[(static_cast<size_t>(sy) * src.width + sx) * channels + c];
+                        };
+                    dst.pixels[(static_cast<size_t>(y) * dst.width + x) * channels + c] =
+                        0.25f * (at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1));
+                }
+            }
+        }
+        return dst;
+    }
+
+    std::vector<unsigned char> toBytes(const FloatImage& image, int channels) {
+        const int colorChannels = channels >= 3 ? 3 : 0;
+        std::vector<unsigned char> bytes(image.pixels.size());
+        for (size_t i = 0; i < image.pixels.size(); ++i) {
+            float value = image.pixels[i];
+            if (static_cast<int>(i % channels) < colorChannels) {
+                value = linearToSrgb(value);
+            }
+            bytes[i] = static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+        return bytes;
+    }
+
+    std::vector<unsigned char> compressLevel(
+        const std::vector<unsigned char>& pixels, int width, int height, int channels, bool alpha) {
+        const int blocksX = (width + 3) / 4;
+        const int blocksY = (height + 3) / 4;
+        const size_t blockBytes = alpha ? 16 : 8;
+        std::vector<unsigned char> blocks(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+        unsigned char rgba[16 * 4];
+        for (int by = 0; by < blocksY; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                // levels smaller than a block repeat their edge pixels
+                for (int i = 0; i < 16; ++i) {
+                    const int x = std::min(bx * 4 + i % 4, width - 1);
+                    const int y = std::min(by * 4 + i / 4, height - 1);
+                    const unsigned char* p = &pixels[(static_cast<size_t>(y) * width + x) * channels];
+                    rgba[i * 4 + 0] = p[0];
+                    rgba[i * 4 + 1] = p[1];
+                    rgba[i * 4 + 2] = p[2];
+                    rgba[i * 4 + 3] = channels == 4 ? p[3] : 255;
+                }
+                stb_compress_dxt_block(
+                    &blocks[(static_cast<size_t>(by) * blocksX + bx) * blockBytes], rgba, alpha ? 1 : 0,
+                    STB_DXT_HIGHQUAL);
+            }
+        }
+        return blocks;
+    }
+
+} // namespace
+
+std::string BakedTexture::getBakedPath(const std::string& sourcePath) {
+    return sourcePath + ".btex";
+}
+
+bool BakedTexture::open(const std::string& sourcePath) {
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    if (!getAssetStamp(sourcePath, sourceSize, sourceTime)) {
+        return false;
+    }
+
+    const std::string bakedPath = getBakedPath(sourcePath);
+    if (!assetExists(bakedPath)) {
+        return false;
+    }
+
+    try {
+        _file = MappedFile(bakedPath);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl;
+        return false;
+    }
+
+    const uint64_t fileSize = _file.size();
+    if (fileSize < sizeof(BakedHeader)) {
+        _file = MappedFile();
+        return false;
+    }
+
+    const BakedHeader* header = getHeader(_file);
+    if (std::memcmp(header->magic, bakedMagic, sizeof(bakedMagic)) != 0 || header->version != bakedVersion
+        || header->sourceSize != sourceSize || header->sourceTime != sourceTime) {
+        std::cout << "Baked texture is stale: " << bakedPath << std::endl;
+        _file = MappedFile();
+        return false;
+    }
+
+    const BakedTextureFormat format = static_cast<BakedTextureFormat>(header->format);
+    const uint64_t entriesEnd = sizeof(BakedHeader) + uint64_t(header->levelCount) * sizeof(BakedLevelEntry);
+    bool valid = header->format <= static_cast<uint32_t>(BakedTextureFormat::BC3) && header->levelCount != 0
+                 && header->width != 0 && header->height != 0 && entriesEnd <= fileSize;
+    for (uint32_t i = 0; valid && i < header->levelCount; ++i) {
+        const BakedLevelEntry& entry = getLevelEntry(_file, i);
+        valid = entry.width == std::max(1u, header->width >> i) && entry.height == std::max(1u, header->height >> i)
+                && entry.size == getLevelByteSize(format, entry.width, entry.height)
+                && entry.offset + entry.size <= fileSize;
+    }
+    if (!valid) {
+        std::cerr << "Warning: damaged baked texture: " << bakedPath << std::endl;
+        _file = MappedFile();
+        return false;
+    }
+
+    _levelCount = header->levelCount;
+    return true;
+}
+
+BakedTextureFormat BakedTexture::getFormat() const {
+    return static_cast<BakedTextureFormat>(getHeader(_file)->format);
+}
+
+bool BakedTexture::isCompressed() const {
+    return isCompressedFormat(getFormat());
+}
+
+int BakedTexture::getWidth() const {
+    return static_cast<int>(getHeader(_file)->width);
+}
+
+int BakedTexture::getHeight() const {
+    return static_cast<int>(getHeader(_file)->height);
+}
+
+size_t BakedTexture::getLevelCount() const {
+    return _levelCount;
+}
+
+int BakedTexture::getLevelWidth(size_t level) const {
+    return static_cast<int>(getLevelEntry(_file, level).width);
+}
+
+int BakedTexture::getLevelHeight(size_t level) const {
+    return static_cast<int>(getLevelEntry(_file, level).height);
+}
+
+const unsigned char* BakedTexture::getLevelData(size_t level) const {
+    return reinterpret_cast<const unsigned char*>(_file.data() + getLevelEntry(_file, level).offset);
+}
+
+size_t BakedTexture::getLevelSize(size_t level) const {
+    return static_cast<size_t>(getLevelEntry(_file, level).size);
+}
+
+size_t BakedTexture::getTotalSize() const {
+    size_t size = 0;
+    for (size_t i = 0; i < _levelCount; ++i) {
+        size += getLevelSize(i);
+    }
+    return size;
+}
+
+BakedTextureData BakedTexture::bake(
+    const unsigned char* pixels, int width, int height, int channels, bool compress) {
+    if (width <= 0 || height <= 0 || (channels != 1 && channels != 3 && channels != 4)) {
+        throw std::runtime_error("cannot bake a texture with " + std::to_string(channels) + " channels");
+    }
+
+    BakedTextureData data;
+    if (channels == 1) {
+        data.format = BakedTextureFormat::R8;
+    }
+    else if (compress) {
+        data.format = channels == 4 ? BakedTextureFormat::BC3 : BakedTextureFormat::BC1;
+    }
+    else {
+        data.format = channels == 4 ? BakedTextureFormat::RGBA8 : BakedTextureFormat::RGB8;
+    }
+
+    float srgbTable[256];
+    for (int i = 0; i < 256; ++i) {
+        srgbTable[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+    }
+
+    FloatImage level;
+    level.width = width;
+    level.height = height;
+    level.pixels.resize(static_cast<size_t>(width) * height * channels);
+    const int colorChannels = channels >= 3 ? 3 : 0;
+    for (size_t i = 0; i < level.pixels.size(); ++i) {
+        level.pixels[i] = static_cast<int>(i % channels) < colorChannels
+                              ? srgbTable[pixels[i]]
+                              : static_cast<float>(pixels[i]) / 255.0f;
+    }
+
+    for (;;) {
+        BakedTextureLevel baked;
+        baked.width = level.width;
+        baked.height = level.height;
+        if (level.width == width && level.height == height) {
+            // level 0 keeps the source bytes, no round trip through float
+            baked.data.assign(pixels, pixels + level.pixels.size());
+        }
+        else {
+            baked.data = toBytes(level, channels);
+        }
+        if (isCompressedFormat(data.format)) {
+            baked.data = compressLevel(baked.data, baked.width, baked.height, channels, channels == 4);
+        }
+        data.levels.push_back(std::move(baked));
+
+        if (level.width == 1 && level.height == 1) {
+            break;
+        }
+        level = downsample(level, channels);
+    }
+    return data;
+}
+
+bool BakedTexture::write(const std::string& sourcePath, const BakedTextureData& data) {
+    BakedHeader header{};
+    std::memcpy(header.magic, bakedMagic, sizeof(bakedMagic));
+    header.version = bakedVersion;
+    header.format = static_cast<uint32_t>(data.format);
+    if (data.levels.empty() || !getAssetStamp(sourcePath, header.sourceSize, header.sourceTime)) {
+        return false;
+    }
+    header.width = static_cast<uint32_t>(data.levels[0].width);
+    header.height = static_cast<uint32_t>(data.levels[0].height);
+    header.levelCount = static_cast<uint32_t>(data.levels.size());
+
+    // layout: header, level entries, then the 16 byte aligned levels
+    std::vector<BakedLevelEntry> entries(data.levels.size());
+    uint64_t offset = sizeof(BakedHeader) + entries.size() * sizeof(BakedLevelEntry);
+    for (size_t i = 0; i < data.levels.size(); ++i) {
+        offset = (offset + 15) / 16 * 16;
+        entries[i].offset = offset;
+        entries[i].size = data.levels[i].data.size();
+        entries[i].width = static_cast<uint32_t>(data.levels[i].width);
+        entries[i].height = static_cast<uint32_t>(data.levels[i].height);
+        offset += entries[i].size;
+    }
+
+    const std::string bakedPath = getBakedPath(sourcePath);
+    const std::string tempPath = bakedPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Warning: cannot write baked texture: " << bakedPath << std::endl;
+            return false;
+        }
+
+        uint64_t written = 0;
+        const auto put = [&](const void* bytes, uint64_t size) {
+            out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+            written += size;
+        };
+
+        put(&header, sizeof(header));
+        put(entries.data(), entries.size() * sizeof(BakedLevelEntry));
+        for (size_t i = 0; i < data.levels.size(); ++i) {
+            static const char zeros[16] = {};
+            put(zeros, entries[i].offset - written);
+            put(data.levels[i].data.data(), entries[i].size);
+        }
+
+        if (!out) {
+            std::cerr << "Warning: cannot write baked texture: " << bakedPath << std::endl;
+            out.close();
+            std::filesystem::remove(tempPath);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, bakedPath, ec);
+    if (ec) {
+        std::cerr << "Warning: cannot write baked texture: " << bakedPath << " (" << ec.message() << ")"
+                  << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
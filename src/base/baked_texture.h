@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+enum class BakedTextureFormat : uint32_t {
+    R8 = 0,
+    RGB8 = 1,
+    RGBA8 = 2,
+    // s3tc / dxt, 4x4 blocks of 8 bytes (rgb) or 16 bytes (rgba)
+    BC1 = 3,
+    BC3 = 4,
+};
+
+struct BakedTextureLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> data;
+};
+
+// result of the bake, level 0 first down to 1x1
+struct BakedTextureData {
+    BakedTextureFormat format = BakedTextureFormat::RGBA8;
+    std::vector<BakedTextureLevel> levels;
+};
+
+// Texture baked offline by tools/texture_baker into <image>.btex next to the source image:
+// the full mip chain, filtered in linear light and block compressed, laid out so that every
+// level goes to glCompressedTexImage2D straight from the mapping. Rows are bottom up like
+// ImageTexture2D loads images. A bake is stale when the size or the modification time of
+// the source image changed.
+class BakedTexture {
+public:
+    static std::string getBakedPath(const std::string& sourcePath);
+
+    // returns false if the bake is missing, stale or damaged
+    bool open(const std::string& sourcePath);
+
+    BakedTextureFormat getFormat() const;
+
+    bool isCompressed() const;
+
+    int getWidth() const;
+
+    int getHeight() const;
+
+    size_t getLevelCount() const;
+
+    int getLevelWidth(size_t level) const;
+
+    int getLevelHeight(size_t level) const;
+
+    const unsigned char* getLevelData(size_t level) const;
+
+    size_t getLevelSize(size_t level) const;
+
+    // bytes of all levels, which is what the texture takes on the gpu
+    size_t getTotalSize() const;
+
+    // box filters the mip chain (color channels in linear light) and compresses rgb images to
+    // BC1, rgba images to BC3, single channel images stay R8. pixels are tightly packed rows
+    static BakedTextureData bake(
+        const unsigned char* pixels, int width, int height, int channels, bool compress);
+
+    // writes the bake atomically, failures are reported and ignored
+    static bool write(const std::string& sourcePath, const BakedTextureData& data);
+
+private:
+    MappedFile _file;
+    size_t _levelCount = 0;
+};
@@ -13,4 +13,40 @@ struct BoundingBox {
 
         return *this;
     }
-};
\ No newline at end of file
+
+    BoundingBox& operator+=(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+
+        return *this;
+    }
+
+    bool isEmpty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    glm::vec3 getCenter() const {
+        return 0.5f * (max + min);
+    }
+
+    glm::vec3 getExtent() const {
+        return 0.5f * (max - min);
+    }
+};
+
+// box around the transformed box: the new half extents are the old ones through |matrix|, so
+// no corner has to be transformed (Arvo, Graphics Gems)
+inline BoundingBox transformBoundingBox(const BoundingBox& box, const glm::mat4& matrix) {
+    if (box.isEmpty()) {
+        return box;
+    }
+
+    const glm::vec3 center = glm::vec3(matrix * glm::vec4(box.getCenter(), 1.0f));
+    const glm::mat3 absMatrix(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+    const glm::vec3 extent = absMatrix * box.getExtent();
+
+    BoundingBox result;
+    result.min = center - extent;
+    result.max = center + extent;
+    return result;
+}
\ No newline at end of file
@@ -1,13 +1,13 @@
 #include "camera.h"
 
-// תyaw ȫתpitch ֲת
+// 鼠标旋转（yaw 全局旋转，pitch 相机局部旋转）
 void Camera::rotate(float yawDeg, float pitchDeg) {
     glm::quat qYaw = glm::angleAxis(glm::radians(yawDeg), Transform::getDefaultUp());
     glm::quat qPitch = glm::angleAxis(glm::radians(pitchDeg), transform.getRight());
     transform.rotation = glm::normalize(qYaw * transform.rotation * qPitch);
 }
 
-// ƶ
+// 键盘移动
 //void Camera::move(const glm::vec3& delta) {
 //    transform.position += delta;
 //}
@@ -32,7 +32,7 @@ Frustum PerspectiveCamera::getFrustum() const {
     // ----------------------------------------------------------------------
     const float halfVSide = zfar * tanf(fovy * 0.5f);
     const float halfHSide = halfVSide * aspect;
-    const glm::vec3 frontMultFar = zfar * transform.getFront();//Զü
+    const glm::vec3 frontMultFar = zfar * transform.getFront();//朝向向量按远裁剪距离缩放
 
     const glm::vec3 camPos = transform.position;
     const glm::vec3 fv = glm::normalize(transform.getFront());
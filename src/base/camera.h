@@ -21,7 +21,7 @@ public:
 
     virtual Frustum getFrustum() const = 0;
 
-    //  class Camera  public 
+    // 在 class Camera 内 public 区域加
     
 };
 
@@ -21,38 +21,23 @@ public:
         // Note: this is for Bonus project 'Frustum Culling'
         // write your code here
         // ------------------------------------------------------------
-        glm::vec3 corners[8] = {
-            {aabb.min.x, aabb.min.y, aabb.min.z},
-            {aabb.max.x, aabb.min.y, aabb.min.z},
-            {aabb.min.x, aabb.max.y, aabb.min.z},
-            {aabb.max.x, aabb.max.y, aabb.min.z},
-            {aabb.min.x, aabb.min.y, aabb.max.z},
-            {aabb.max.x, aabb.min.y, aabb.max.z},
-            {aabb.min.x, aabb.max.y, aabb.max.z},
-            {aabb.max.x, aabb.max.y, aabb.max.z}
-        };
-
-        // ռ
-        glm::vec3 worldCorners[8];
-        for (int i = 0; i < 8; ++i) {
-            glm::vec4 wc = modelMatrix * glm::vec4(corners[i], 1.0f);
-            worldCorners[i] = glm::vec3(wc);
-        }
+        return intersect(transformBoundingBox(aabb, modelMatrix));
+        // ------------------------------------------------------------
+    }
 
-        // ÿƽвԣе㶼ƽ࣬޳
-        for (int p = 0; p < 6; ++p) {
-            const Plane& plane = planes[p];
-            int outsideCount = 0;
-            for (int i = 0; i < 8; ++i) {
-                float distance = glm::dot(plane.normal, worldCorners[i]) + plane.signedDistance;
-                if (distance < 0.0f) ++outsideCount;
-            }
-            if (outsideCount == 8) {
+    // world space box, conservative: boxes near an edge of the frustum may pass although they
+    // are outside of it. The box is outside of a plane if its center is further away than the
+    // box reaches along the plane normal
+    bool intersect(const BoundingBox& aabb) const {
+        const glm::vec3 center = aabb.getCenter();
+        const glm::vec3 extent = aabb.getExtent();
+        for (const Plane& plane : planes) {
+            const float radius = glm::dot(glm::abs(plane.normal), extent);
+            if (plane.getSignedDistanceToPoint(center) < -radius) {
                 return false;
             }
         }
         return true;
-        // ------------------------------------------------------------
     }
 };
 
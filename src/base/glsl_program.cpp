@@ -7,6 +7,7 @@
 #include <glm/ext.hpp>
 
 #include "glsl_program.h"
+#include "mapped_file.h"
 
 GLSLProgram::GLSLProgram() {
     _handle = glCreateProgram();
@@ -253,16 +254,11 @@ void GLSLProgram::setUniformBlockBinding(const std::string& name, uint32_t bindi
 }
 
 std::string GLSLProgram::readFile(const std::string& filePath) {
-    std::ifstream is;
-    is.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
     try {
-        is.open(filePath);
-        std::stringstream ss;
-        ss << is.rdbuf();
-
-        return ss.str();
-    } catch (std::ifstream::failure& e) {
+        // served from the asset pack when one is mounted
+        const MappedFile file(filePath);
+        return std::string(file.data(), file.size());
+    } catch (const std::exception& e) {
         throw std::runtime_error(std::string("read ") + filePath + " error: " + e.what());
     }
 }
@@ -0,0 +1,48 @@
+#include "image_decoder.h"
+
+#include <iostream>
+
+#include <stb_image.h>
+
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+void DecodedImage::PixelDeleter::operator()(unsigned char* pixels) const {
+    stbi_image_free(pixels);
+}
+
+DecodedImage decodeImage(const std::string& path) {
+    DecodedImage image;
+    image.path = path;
+    // stbi_set_flip_vertically_on_load is process wide and would race with other decoders
+    stbi_set_flip_vertically_on_load_thread(1);
+    try {
+        // the pack or the loose file, decoded straight from the mapping
+        const MappedFile file(path);
+        image.pixels.reset(stbi_load_from_memory(
+            reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()), &image.width,
+            &image.height, &image.channels, 0));
+    }
+    catch (const std::exception& e) {
+        std::cerr << "  -> ERROR: Failed to read image: " << path << " (" << e.what() << ")" << std::endl;
+        return image;
+    }
+    if (image.pixels == nullptr) {
+        // the reason is null if stb recorded none
+        const char* reason = stbi_failure_reason();
+        std::cerr << "  -> ERROR: Failed to decode image: " << path;
+        if (reason != nullptr) {
+            std::cerr << " (" << reason << ")";
+        }
+        std::cerr << std::endl;
+    }
+    return image;
+}
+
+std::vector<DecodedImage> decodeImages(const std::vector<std::string>& paths) {
+    std::vector<DecodedImage> images(paths.size());
+    ThreadPool::getGlobal().parallelFor(paths.size(), [&paths, &images](size_t i) {
+        images[i] = decodeImage(paths[i]);
+        });
+    return images;
+}
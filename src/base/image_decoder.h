@@ -0,0 +1,26 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// pixels of an image decoded with stb_image, rows bottom up like ImageTexture2D expects them
+struct DecodedImage {
+    struct PixelDeleter {
+        void operator()(unsigned char* pixels) const;
+    };
+
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    // null if decoding failed, the error has been reported already
+    std::unique_ptr<unsigned char, PixelDeleter> pixels;
+};
+
+// safe to call from any thread, the vertical flip is set per thread
+DecodedImage decodeImage(const std::string& path);
+
+// decodes a load batch in parallel on ThreadPool::getGlobal(), the result is in the order of
+// paths. the calling thread takes part, so this may be called from a worker as well
+std::vector<DecodedImage> decodeImages(const std::vector<std::string>& paths);
@@ -0,0 +1,334 @@
+#include "json.h"
+
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : _begin(begin), _p(begin), _end(end) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue(0);
+        skipWhitespace();
+        if (_p != _end) {
+            fail("unexpected trailing characters");
+        }
+        return value;
+    }
+
+private:
+    // deeper documents are almost certainly broken and would overflow the stack
+    static constexpr int maxDepth = 256;
+
+    const char* _begin;
+    const char* _p;
+    const char* _end;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(
+            std::string("json parse error at offset ") + std::to_string(_p - _begin) + ": " + what);
+    }
+
+    void skipWhitespace() {
+        while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r')) {
+            ++_p;
+        }
+    }
+
+    void expectLiteral(const char* literal) {
+        for (; *literal != '\0'; ++literal, ++_p) {
+            if (_p == _end || *_p != *literal) {
+                fail("invalid literal");
+            }
+        }
+    }
+
+    JsonValue parseValue(int depth) {
+        if (depth > maxDepth) {
+            fail("nesting too deep");
+        }
+
+        skipWhitespace();
+        if (_p == _end) {
+            fail("unexpected end of input");
+        }
+
+        JsonValue value;
+        switch (*_p) {
+        case '{':
+            parseObject(value, depth);
+            break;
+        case '[':
+            parseArray(value, depth);
+            break;
+        case '"':
+            value._type = JsonValue::Type::String;
+            value._string = parseString();
+            break;
+        case 't':
+            expectLiteral("true");
+            value._type = JsonValue::Type::Bool;
+            value._bool = true;
+            break;
+        case 'f':
+            expectLiteral("false");
+            value._type = JsonValue::Type::Bool;
+            break;
+        case 'n':
+            expectLiteral("null");
+            break;
+        default:
+            value._type = JsonValue::Type::Number;
+            value._number = parseNumber();
+            break;
+        }
+        return value;
+    }
+
+    void parseObject(JsonValue& value, int depth) {
+        value._type = JsonValue::Type::Object;
+        ++_p;
+        skipWhitespace();
+        if (_p < _end && *_p == '}') {
+            ++_p;
+            return;
+        }
+
+        for (;;) {
+            skipWhitespace();
+            if (_p == _end || *_p != '"') {
+                fail("expected a member name");
+            }
+            value._keys.push_back(parseString());
+            skipWhitespace();
+            if (_p == _end || *_p != ':') {
+                fail("expected ':'");
+            }
+            ++_p;
+            value._values.push_back(parseValue(depth + 1));
+
+            skipWhitespace();
+            if (_p < _end && *_p == ',') {
+                ++_p;
+            }
+            else if (_p < _end && *_p == '}') {
+                ++_p;
+                return;
+            }
+            else {
+                fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    void parseArray(JsonValue& value, int depth) {
+        value._type = JsonValue::Type::Array;
+        ++_p;
+        skipWhitespace();
+        if (_p < _end && *_p == ']') {
+            ++_p;
+            return;
+        }
+
+        for (;;) {
+            value._values.push_back(parseValue(depth + 1));
+            skipWhitespace();
+            if (_p < _end && *_p == ',') {
+                ++_p;
+            }
+            else if (_p < _end && *_p == ']') {
+                ++_p;
+                return;
+            }
+            else {
+                fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    double parseNumber() {
+        // from_chars neither accepts a leading '+' nor depends on the locale, as json wants
+        double number = 0.0;
+        const auto result = std::from_chars(_p, _end, number);
+        if (result.ec != std::errc() || !std::isfinite(number)) {
+            fail("invalid number");
+        }
+        _p = result.ptr;
+        return number;
+    }
+
+    uint32_t parseHex4() {
+        if (_end - _p < 4) {
+            fail("truncated \\u escape");
+        }
+        uint32_t code = 0;
+        const auto result = std::from_chars(_p, _p + 4, code, 16);
+        if (result.ec != std::errc() || result.ptr != _p + 4) {
+            fail("invalid \\u escape");
+        }
+        _p += 4;
+        return code;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else if (code < 0x10000) {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else {
+            out += static_cast<char>(0xf0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    std::string parseString() {
+        ++_p;
+        std::string out;
+        for (;;) {
+            const char* run = _p;
+            while (_p < _end && *_p != '"' && *_p != '\\') {
+                ++_p;
+            }
+            out.append(run, _p);
+            if (_p == _end) {
+                fail("unterminated string");
+            }
+            if (*_p++ == '"') {
+                return out;
+            }
+
+            if (_p == _end) {
+                fail("unterminated string");
+            }
+            const char escape = *_p++;
+            switch (escape) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code = parseHex4();
+                // characters outside the bmp come as a surrogate pair
+                if (code >= 0xd800 && code < 0xdc00 && _end - _p >= 6 && _p[0] == '\\' && _p[1] == 'u') {
+                    _p += 2;
+                    const uint32_t low = parseHex4();
+                    if (low < 0xdc00 || low >= 0xe000) {
+                        fail("invalid surrogate pair");
+                    }
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                fail("invalid escape");
+            }
+        }
+    }
+};
+
+JsonValue JsonValue::parse(const char* begin, const char* end) {
+    return JsonParser(begin, end).parseDocument();
+}
+
+JsonValue JsonValue::parse(const std::string& text) {
+    return parse(text.data(), text.data() + text.size());
+}
+
+JsonValue::Type JsonValue::getType() const {
+    return _type;
+}
+
+bool JsonValue::isNull() const {
+    return _type == Type::Null;
+}
+
+bool JsonValue::isNumber() const {
+    return _type == Type::Number;
+}
+
+bool JsonValue::isString() const {
+    return _type == Type::String;
+}
+
+bool JsonValue::isArray() const {
+    return _type == Type::Array;
+}
+
+bool JsonValue::isObject() const {
+    return _type == Type::Object;
+}
+
+bool JsonValue::has(const std::string& key) const {
+    return !(*this)[key].isNull();
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const {
+    static const JsonValue nullValue;
+    if (_type != Type::Object) {
+        return nullValue;
+    }
+    for (size_t i = 0; i < _keys.size(); ++i) {
+        if (_keys[i] == key) {
+            return _values[i];
+        }
+    }
+    return nullValue;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    static const JsonValue nullValue;
+    return (_type == Type::Array && index < _values.size()) ? _values[index] : nullValue;
+}
+
+size_t JsonValue::size() const {
+    return (_type == Type::Array || _type == Type::Object) ? _values.size() : 0;
+}
+
+bool JsonValue::asBool(bool fallback) const {
+    return _type == Type::Bool ? _bool : fallback;
+}
+
+double JsonValue::asNumber(double fallback) const {
+    return _type == Type::Number ? _number : fallback;
+}
+
+float JsonValue::asFloat(float fallback) const {
+    return _type == Type::Number ? static_cast<float>(_number) : fallback;
+}
+
+int JsonValue::asInt(int fallback) const {
+    return _type == Type::Number ? static_cast<int>(_number) : fallback;
+}
+
+size_t JsonValue::asSize(size_t fallback) const {
+    return (_type == Type::Number && _number >= 0.0) ? static_cast<size_t>(_number) : fallback;
+}
+
+const std::string& JsonValue::asString() const {
+    static const std::string emptyString;
+    return _type == Type::String ? _string : emptyString;
+}
+
+const std::vector<std::string>& JsonValue::getKeys() const {
+    return _keys;
+}
+
+const std::vector<JsonValue>& JsonValue::getValues() const {
+    return _values;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// minimal json document, enough for asset descriptions such as gltf.
+// lookups of missing keys / indices return a null value instead of throwing
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    JsonValue() = default;
+
+    // throws std::runtime_error with the byte offset of the first syntax error
+    static JsonValue parse(const char* begin, const char* end);
+
+    static JsonValue parse(const std::string& text);
+
+    Type getType() const;
+
+    bool isNull() const;
+
+    bool isNumber() const;
+
+    bool isString() const;
+
+    bool isArray() const;
+
+    bool isObject() const;
+
+    bool has(const std::string& key) const;
+
+    // null value if this is no object or the key is missing
+    const JsonValue& operator[](const std::string& key) const;
+
+    // null value if this is no array or the index is out of range
+    const JsonValue& operator[](size_t index) const;
+
+    // element count of arrays, member count of objects, 0 otherwise
+    size_t size() const;
+
+    bool asBool(bool fallback = false) const;
+
+    double asNumber(double fallback = 0.0) const;
+
+    float asFloat(float fallback = 0.0f) const;
+
+    int asInt(int fallback = 0) const;
+
+    size_t asSize(size_t fallback = 0) const;
+
+    // empty if this is no string
+    const std::string& asString() const;
+
+    const std::vector<std::string>& getKeys() const;
+
+    const std::vector<JsonValue>& getValues() const;
+
+private:
+    Type _type = Type::Null;
+    bool _bool = false;
+    double _number = 0.0;
+    std::string _string;
+    // array elements, or object members in document order together with _keys
+    std::vector<JsonValue> _values;
+    std::vector<std::string> _keys;
+
+    friend class JsonParser;
+};
@@ -0,0 +1,173 @@
+#include "mapped_file.h"
+
+#include "asset_pack.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) : _path(path) {
+    AssetSpan span;
+    if (AssetPack::findMounted(path, span)) {
+        _data = span.data;
+        _size = span.size;
+        _packed = true;
+        return;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open file: " + path);
+    }
+    _fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        cleanup();
+        throw std::runtime_error("failed to query file size: " + path);
+    }
+    _size = static_cast<size_t>(fileSize.QuadPart);
+
+    // an empty file cannot be mapped, leave it as an empty view
+    if (_size == 0) {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        cleanup();
+        throw std::runtime_error("failed to map file: " + path);
+    }
+    _mappingHandle = mapping;
+
+    _data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr) {
+        cleanup();
+        throw std::runtime_error("failed to map file: " + path);
+    }
+#else
+    _fd = ::open(path.c_str(), O_RDONLY);
+    if (_fd < 0) {
+        throw std::runtime_error("failed to open file: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(_fd, &st) != 0) {
+        cleanup();
+        throw std::runtime_error("failed to query file size: " + path);
+    }
+    _size = static_cast<size_t>(st.st_size);
+
+    // an empty file cannot be mapped, leave it as an empty view
+    if (_size == 0) {
+        return;
+    }
+
+    void* addr = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (addr == MAP_FAILED) {
+        cleanup();
+        throw std::runtime_error("failed to map file: " + path);
+    }
+    ::madvise(addr, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char*>(addr);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept
+    : _path(std::move(rhs._path)), _data(rhs._data), _size(rhs._size), _packed(rhs._packed),
+#ifdef _WIN32
+      _fileHandle(rhs._fileHandle), _mappingHandle(rhs._mappingHandle) {
+    rhs._fileHandle = nullptr;
+    rhs._mappingHandle = nullptr;
+#else
+      _fd(rhs._fd) {
+    rhs._fd = -1;
+#endif
+    rhs._data = nullptr;
+    rhs._size = 0;
+    rhs._packed = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept {
+    if (this != &rhs) {
+        cleanup();
+        _path = std::move(rhs._path);
+        _data = rhs._data;
+        _size = rhs._size;
+        _packed = rhs._packed;
+        rhs._data = nullptr;
+        rhs._size = 0;
+        rhs._packed = false;
+#ifdef _WIN32
+        _fileHandle = rhs._fileHandle;
+        _mappingHandle = rhs._mappingHandle;
+        rhs._fileHandle = nullptr;
+        rhs._mappingHandle = nullptr;
+#else
+        _fd = rhs._fd;
+        rhs._fd = -1;
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    cleanup();
+}
+
+const char* MappedFile::data() const {
+    return _data;
+}
+
+size_t MappedFile::size() const {
+    return _size;
+}
+
+bool MappedFile::empty() const {
+    return _size == 0;
+}
+
+const std::string& MappedFile::getPath() const {
+    return _path;
+}
+
+void MappedFile::cleanup() {
+#ifdef _WIN32
+    if (_data != nullptr && !_packed) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mappingHandle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(_mappingHandle));
+        _mappingHandle = nullptr;
+    }
+    if (_fileHandle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(_fileHandle));
+        _fileHandle = nullptr;
+    }
+#else
+    if (_data != nullptr && !_packed) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+#endif
+    _data = nullptr;
+    _size = 0;
+    _packed = false;
+}
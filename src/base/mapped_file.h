@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// read-only memory mapping of a whole file, the mapping lives as long as the object. files in
+// the mounted AssetPack are served as a view into the mapping of the pack instead
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& rhs) noexcept;
+
+    MappedFile& operator=(MappedFile&& rhs) noexcept;
+
+    ~MappedFile();
+
+    const char* data() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    const std::string& getPath() const;
+
+private:
+    std::string _path;
+    const char* _data = nullptr;
+    size_t _size = 0;
+    // points into the mounted pack, nothing to unmap
+    bool _packed = false;
+
+#ifdef _WIN32
+    void* _fileHandle = nullptr;
+    void* _mappingHandle = nullptr;
+#else
+    int _fd = -1;
+#endif
+
+    void cleanup();
+};
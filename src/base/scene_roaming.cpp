@@ -8,7 +8,7 @@ SceneRoaming::SceneRoaming(float fovy, float aspect, float znear, float zfar)
 
 void SceneRoaming::update(float deltaTime, const Input& input) {
     // -----------------
-    // 1. ת
+    // 1. 鼠标旋转
     // -----------------
     float deltaX = input.mouse.move.xNow - input.mouse.move.xOld;
     float deltaY = input.mouse.move.yNow - input.mouse.move.yOld;
@@ -19,7 +19,7 @@ void SceneRoaming::update(float deltaTime, const Input& input) {
     camera.rotate(yaw, pitch);
 
     // -----------------
-    // 2. ƶ
+    // 2. 键盘移动
     // -----------------
     glm::vec3 dir(0.0f);
 
@@ -55,7 +55,7 @@ SkyBox::SkyBox(const std::vector<std::string>& textureFilenames) {
             "void main() {\n"
             "   color = texture(cubemap, texCoord);\n"
             "}\n";
-        //texCoordʾ3Dķcubemapʾͼ
+        //texCoord表示3D纹理坐标的方向向量，cubemap表示立方体贴图的纹理采样器
         _shader.reset(new GLSLProgram);
         _shader->attachVertexShader(vsCode);
         _shader->attachFragmentShader(fsCode);
@@ -91,14 +91,14 @@ void SkyBox::draw(const glm::mat4& projection, const glm::mat4& view) {
     // -----------------------------------------------
     // ...
     // -----------------------------------------------
-    //պɫ
+    //天空盒着色器
     _shader->use();
-    // 2. ȥƽƷ viewֻת
+    // 2. 去除平移分量的 view（只用旋转）
     glm::mat4 viewNoTranslation = glm::mat4(glm::mat3(view));
     _shader->setUniformMat4("projection", projection);
     _shader->setUniformMat4("view", viewNoTranslation);
 
-    // 3. ״̬дȣԣ
+    // 3. 设置深度状态（不写深度，但允许测试）
     GLboolean depthTestWasEnabled = glIsEnabled(GL_DEPTH_TEST);
     GLint prevDepthFunc = 0;
     glGetIntegerv(GL_DEPTH_FUNC, &prevDepthFunc);
@@ -106,17 +106,17 @@ void SkyBox::draw(const glm::mat4& projection, const glm::mat4& view) {
     glDepthFunc(GL_LEQUAL);
     glDepthMask(GL_FALSE);
 
-    // 4. Ԫ 0
+    // 4. 绑定纹理到单元 0
     const int texUnit = 0;
     _texture->bind(texUnit);
     _shader->setUniformInt("cubemap", texUnit);
 
-    // 5.  VAO 
+    // 5. 绑定 VAO 并绘制
     glBindVertexArray(_vao);
     glDrawArrays(GL_TRIANGLES, 0, 36);
     glBindVertexArray(0);
 
-    // 6. ָдȺ
+    // 6. 恢复深度写入与深度函数
     glDepthMask(GL_TRUE);
     glDepthFunc(prevDepthFunc);
     if (!depthTestWasEnabled) glDisable(GL_DEPTH_TEST);
@@ -1,16 +1,37 @@
 #include <cassert>
+#include <cstring>
 #include <sstream>
-#include <stb_image.h>
 
 #include "texture2d.h"
 
+namespace {
+    // glad is generated for the core profile, which leaves out the s3tc extension
+    constexpr GLenum GL_COMPRESSED_RGB_S3TC_DXT1_EXT = 0x83F0;
+    constexpr GLenum GL_COMPRESSED_RGBA_S3TC_DXT5_EXT = 0x83F3;
+
+    bool hasS3tcSupport() {
+        static const bool supported = []() {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count; ++i) {
+                const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                if (name != nullptr && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+                    return true;
+                }
+            }
+            return false;
+            }();
+        return supported;
+    }
+} // namespace
+
 Texture2D::Texture2D(
     GLint internalFormat, int width, int height, GLenum format, GLenum dataType, void* data) {
     glBindTexture(GL_TEXTURE_2D, _handle);
     setDefaultParameters();
     glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, dataType, data);
     glBindTexture(GL_TEXTURE_2D, 0);
-}//׶εԤ䣨
+}//构造阶段的预分配（？）
 
 Texture2D::Texture2D(Texture2D&& rhs) noexcept : Texture(std::move(rhs)) {}
 
@@ -43,25 +64,22 @@ void Texture2D::setDefaultParameters() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
 }
 
-ImageTexture2D::ImageTexture2D(const std::string& path) : _uri(path) {
-    // load image to the memory
-    stbi_set_flip_vertically_on_load(true);
-    int width = 0, height = 0, channels = 0;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
-    if (data == nullptr) {
+ImageTexture2D::ImageTexture2D(const std::string& path) : ImageTexture2D(decodeImage(path)) {}
+
+ImageTexture2D::ImageTexture2D(const DecodedImage& image) : _uri(image.path) {
+    if (image.pixels == nullptr) {
         cleanup();
-        throw std::runtime_error("load " + path + " failure");
+        throw std::runtime_error("load " + image.path + " failure");
     }
 
     // choose image format
     GLenum format = GL_RGB;
-    switch (channels) {
+    switch (image.channels) {
     case 1: format = GL_RED; break;
     case 3: format = GL_RGB; break;
     case 4: format = GL_RGBA; break;
     default:
         cleanup();
-        stbi_image_free(data);
         throw std::runtime_error("unsupported format");
     }
     GLint internalFormat = static_cast<GLint>(format);
@@ -72,13 +90,10 @@ ImageTexture2D::ImageTexture2D(const std::string& path) : _uri(path) {
     setDefaultParameters();
 
     // transfer the image data to GPU
-    upload(data, width, height, channels, internalFormat, format, GL_UNSIGNED_BYTE);
+    upload(image.pixels.get(), image.width, image.height, image.channels, internalFormat, format, GL_UNSIGNED_BYTE);
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    // free data
-    stbi_image_free(data);
-
     // check error
     check();
 }
@@ -101,15 +116,62 @@ ImageTexture2D::ImageTexture2D(
     check();
 }
 
+ImageTexture2D::ImageTexture2D(const BakedTexture& texture, const std::string& uri) : _uri(uri) {
+    GLenum internalFormat = GL_RGBA8;
+    GLenum format = GL_RGBA;
+    switch (texture.getFormat()) {
+    case BakedTextureFormat::R8: internalFormat = GL_R8; format = GL_RED; break;
+    case BakedTextureFormat::RGB8: internalFormat = GL_RGB8; format = GL_RGB; break;
+    case BakedTextureFormat::RGBA8: internalFormat = GL_RGBA8; format = GL_RGBA; break;
+    case BakedTextureFormat::BC1: internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+    case BakedTextureFormat::BC3: internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+    }
+    if (texture.isCompressed() && !hasS3tcSupport()) {
+        cleanup();
+        throw std::runtime_error("s3tc texture compression is not supported: " + uri);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, _handle);
+    setDefaultParameters();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.getLevelCount() - 1));
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t level = 0; level < texture.getLevelCount(); ++level) {
+        const GLint mip = static_cast<GLint>(level);
+        if (texture.isCompressed()) {
+            glCompressedTexImage2D(
+                GL_TEXTURE_2D, mip, internalFormat, texture.getLevelWidth(level), texture.getLevelHeight(level), 0,
+                static_cast<GLsizei>(texture.getLevelSize(level)), texture.getLevelData(level));
+        }
+        else {
+            glTexImage2D(
+                GL_TEXTURE_2D, mip, static_cast<GLint>(internalFormat), texture.getLevelWidth(level),
+                texture.getLevelHeight(level), 0, format, GL_UNSIGNED_BYTE, texture.getLevelData(level));
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    _byteSize = texture.getTotalSize();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    check();
+}
+
 ImageTexture2D::ImageTexture2D(ImageTexture2D&& rhs) noexcept
-    : Texture2D(std::move(rhs)), _uri(std::move(rhs._uri)) {
+    : Texture2D(std::move(rhs)), _uri(std::move(rhs._uri)), _byteSize(rhs._byteSize) {
     rhs._uri = "";
+    rhs._byteSize = 0;
 }
 
 const std::string& ImageTexture2D::getUri() const {
     return _uri;
 }
 
+size_t ImageTexture2D::getByteSize() const {
+    return _byteSize;
+}
+
 void ImageTexture2D::setDefaultParameters() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -140,6 +202,9 @@ void ImageTexture2D::upload(
 
     // 3. restore alignment
     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    const size_t componentSize = (type == GL_FLOAT) ? sizeof(float) : sizeof(unsigned char);
+    _byteSize = static_cast<size_t>(width) * height * channels * componentSize;
 }
 
 Texture2DArray::Texture2DArray(
@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "baked_texture.h"
+#include "image_decoder.h"
 #include "texture.h"
 
 class Texture2D : public Texture {
@@ -34,18 +36,28 @@ class ImageTexture2D : public Texture2D {
 public:
     ImageTexture2D(const std::string& path);
 
+    // uploads an image decoded elsewhere (see decodeImages), throws if decoding failed
+    explicit ImageTexture2D(const DecodedImage& image);
+
     ImageTexture2D(
         const void* data, int width, int height, int channels, GLint internalformat, GLenum format,
         GLenum type, const std::string& uri);
 
+    // uploads every level of the baked mip chain as it is, throws if the driver lacks s3tc
+    ImageTexture2D(const BakedTexture& texture, const std::string& uri);
+
     ImageTexture2D(ImageTexture2D&& rhs) noexcept;
 
     ~ImageTexture2D() = default;
 
     const std::string& getUri() const;
 
+    // bytes of all uploaded levels, drivers may pad rgb to rgba on top of that
+    size_t getByteSize() const;
+
 private:
     std::string _uri;
+    size_t _byteSize = 0;
 
     void setDefaultParameters();
 
@@ -1,6 +1,6 @@
 #include <cassert>
-#include <stb_image.h>
 
+#include "image_decoder.h"
 #include "texture_cubemap.h"
 
 TextureCubemap::TextureCubemap(
@@ -10,16 +10,16 @@ TextureCubemap::TextureCubemap(
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);//ͼ趨ƺ͹˷ʽ
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);//绑定贴图、设定环绕和过滤方式
 
     for (uint32_t i = 0; i < 6; ++i) {
         glTexImage2D(
             GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, width, height, 0, format,
             dataType, nullptr);
     }
-    //ֱǣĵi棬mipmap0ڲʽͼͼߣ߿0ԭʼݵ(data=stb_load()),Ҫ
-    //һĿ
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);//
+    //参数分别是：立方体的第i个面，mipmap级别0，内部格式，图像宽，图像高，边框0，原始像素数据的像素数组(data=stb_load()),都是需要传入的
+    //这一步遍历了整个纹理目标
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);//解绑
 }
 
 TextureCubemap::TextureCubemap(TextureCubemap&& rhs) noexcept : Texture(std::move(rhs)) {}
@@ -50,13 +50,15 @@ ImageTextureCubemap::ImageTextureCubemap(const std::vector<std::string>& filepat
     // -----------------------------------------------
     // ...
     // -----------------------------------------------
-    //imageص
+    //将image加载到缓存
+    // the six faces decode in parallel, only the upload below has to stay on the gl thread
+    const std::vector<DecodedImage> faces = decodeImages(filepaths);
+
     glBindTexture(GL_TEXTURE_CUBE_MAP, _handle);
-    stbi_set_flip_vertically_on_load(true);
     for (size_t i = 0; i < 6; i++)
     {
-        int width = 0, height = 0, channels = 0;
-        unsigned char* data = stbi_load(filepaths[i].c_str(), &width, &height, &channels, 0);
+        const int width = faces[i].width, height = faces[i].height, channels = faces[i].channels;
+        const unsigned char* data = faces[i].pixels.get();
         if (data == nullptr) {
             cleanup();
             throw std::runtime_error("load " + filepaths[i] + " failure");
@@ -69,7 +71,6 @@ ImageTextureCubemap::ImageTextureCubemap(const std::vector<std::string>& filepat
         case 4: format = GL_RGBA; break;
         default:
             cleanup();
-            stbi_image_free(data);
             throw std::runtime_error("unsupported format");
         }
         GLint alignment = 1;
@@ -80,11 +81,11 @@ ImageTextureCubemap::ImageTextureCubemap(const std::vector<std::string>& filepat
         else alignment = 1;
         glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
 
-        // ͼϴ cubemap ĵ i 
+        // 把图像上传到 cubemap 的第 i 个面
         glTexImage2D(
             GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(i),
             0,
-            static_cast<GLint>(format), // ɻΪ GL_RGB8/GL_RGBA8 ȷ internal format
+            static_cast<GLint>(format), // 可换为 GL_RGB8/GL_RGBA8 来明确 internal format
             width,
             height,
             0,
@@ -92,14 +93,11 @@ ImageTextureCubemap::ImageTextureCubemap(const std::vector<std::string>& filepat
             GL_UNSIGNED_BYTE,
             data);
 
-        // ָĬ϶
+        // 恢复默认对齐
         glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-
-        // ͷ CPU ڴ
-        stbi_image_free(data);
     }
 
-    // Ĭϲ
+    // 设置默认参数
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -0,0 +1,125 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        _workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::getThreadCount() const {
+    return _workers.size();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn, size_t maxThreads) {
+    if (count == 0) {
+        return;
+    }
+
+    size_t helpers = std::min(count - 1, _workers.size());
+    if (maxThreads != 0) {
+        helpers = std::min(helpers, maxThreads - 1);
+    }
+
+    if (helpers == 0) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    // shared between the caller and the helpers, a helper which starts after
+    // all items were claimed simply returns
+    struct Batch {
+        std::atomic<size_t> next{ 0 };
+        size_t finished = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto batch = std::make_shared<Batch>();
+
+    auto work = [batch, count, &fn]() {
+        size_t processed = 0;
+        std::exception_ptr error;
+        for (size_t i = batch->next++; i < count; i = batch->next++) {
+            try {
+                fn(i);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            ++processed;
+        }
+        if (processed != 0) {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (error && !batch->error) {
+                batch->error = error;
+            }
+            batch->finished += processed;
+            if (batch->finished == count) {
+                batch->done.notify_all();
+            }
+        }
+    };
+
+    for (size_t i = 0; i < helpers; ++i) {
+        enqueue(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->done.wait(lock, [&]() { return batch->finished == count; });
+    if (batch->error) {
+        std::rethrow_exception(batch->error);
+    }
+}
+
+ThreadPool& ThreadPool::getGlobal() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push(std::move(task));
+    }
+    _condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+            if (_stopping && _tasks.empty()) {
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop();
+        }
+        task();
+    }
+}
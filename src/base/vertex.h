@@ -21,8 +21,11 @@ namespace std {
 template <>
 struct hash<Vertex> {
     size_t operator()(const Vertex& vertex) const {
-        return ((hash<glm::vec3>()(vertex.position) ^ (hash<glm::vec3>()(vertex.normal) << 1)) >> 1)
-               ^ (hash<glm::vec2>()(vertex.texCoord) << 1);
+        size_t seed = 0;
+        glm::detail::hash_combine(seed, hash<glm::vec3>()(vertex.position));
+        glm::detail::hash_combine(seed, hash<glm::vec3>()(vertex.normal));
+        glm::detail::hash_combine(seed, hash<glm::vec2>()(vertex.texCoord));
+        return seed;
     }
 };
 } // namespace std
\ No newline at end of file
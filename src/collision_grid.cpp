@@ -0,0 +1,203 @@
+#include "collision_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+void CollisionGrid::reset(const glm::vec2& origin, float cellSize, int columns, int rows) {
+    if (!(cellSize > 0.0f) || columns <= 0 || rows <= 0) {
+        throw std::runtime_error("collision grid needs a positive cell size and cell count");
+    }
+
+    _origin = origin;
+    _cellSize = cellSize;
+    _inverseCellSize = 1.0f / cellSize;
+    _columns = columns;
+    _rows = rows;
+    _cells.assign(static_cast<size_t>(columns) * static_cast<size_t>(rows), {});
+    _boxes.clear();
+    _used.clear();
+    _freeIds.clear();
+    _size = 0;
+}
+
+void CollisionGrid::build(
+    const glm::vec2& origin, float cellSize, int columns, int rows, const std::vector<BoundingBox>& boxes) {
+    reset(origin, cellSize, columns, rows);
+    _boxes = boxes;
+    _used.assign(boxes.size(), 1);
+    _size = boxes.size();
+    for (size_t id = 0; id < boxes.size(); ++id) {
+        link(static_cast<uint32_t>(id));
+    }
+}
+
+void CollisionGrid::clear() {
+    _columns = 0;
+    _rows = 0;
+    _cells.clear();
+    _boxes.clear();
+    _used.clear();
+    _freeIds.clear();
+    _size = 0;
+}
+
+uint32_t CollisionGrid::insert(const BoundingBox& box) {
+    if (_cells.empty()) {
+        throw std::runtime_error("collision grid used before reset");
+    }
+
+    uint32_t id;
+    if (!_freeIds.empty()) {
+        id = _freeIds.back();
+        _freeIds.pop_back();
+        _boxes[id] = box;
+        _used[id] = 1;
+    }
+    else {
+        id = static_cast<uint32_t>(_boxes.size());
+        _boxes.push_back(box);
+        _used.push_back(1);
+    }
+    ++_size;
+    link(id);
+    return id;
+}
+
+void CollisionGrid::update(uint32_t id, const BoundingBox& box) {
+    if (id >= _boxes.size() || !_used[id]) {
+        throw std::runtime_error("collision grid has no box " + std::to_string(id));
+    }
+
+    const CellRange before = getRange(_boxes[id]);
+    const CellRange after = getRange(box);
+    const bool sameRange = before.minCol == after.minCol && before.minRow == after.minRow
+                           && before.maxCol == after.maxCol && before.maxRow == after.maxRow;
+    const bool emptyBefore = _boxes[id].isEmpty();
+    if (emptyBefore == box.isEmpty() && (emptyBefore || sameRange)) {
+        // same cells, e.g. a box moving inside of its cell
+        _boxes[id] = box;
+        return;
+    }
+
+    unlink(id);
+    _boxes[id] = box;
+    link(id);
+}
+
+void CollisionGrid::remove(uint32_t id) {
+    if (id >= _boxes.size() || !_used[id]) {
+        throw std::runtime_error("collision grid has no box " + std::to_string(id));
+    }
+
+    unlink(id);
+    _boxes[id] = BoundingBox();
+    _used[id] = 0;
+    _freeIds.push_back(id);
+    --_size;
+}
+
+size_t CollisionGrid::size() const {
+    return _size;
+}
+
+int CollisionGrid::getColumnCount() const {
+    return _columns;
+}
+
+int CollisionGrid::getRowCount() const {
+    return _rows;
+}
+
+float CollisionGrid::getCellSize() const {
+    return _cellSize;
+}
+
+glm::ivec2 CollisionGrid::getCell(const glm::vec3& position) const {
+    return glm::ivec2(glm::floor((glm::vec2(position.x, position.z) - _origin) * _inverseCellSize + 0.5f));
+}
+
+const BoundingBox& CollisionGrid::getBox(uint32_t id) const {
+    return _boxes[id];
+}
+
+void CollisionGrid::query(const BoundingBox& region, std::vector<uint32_t>& result) const {
+    if (_cells.empty() || region.isEmpty()) {
+        return;
+    }
+
+    const CellRange range = getRange(region);
+    for (int row = range.minRow; row <= range.maxRow; ++row) {
+        for (int col = range.minCol; col <= range.maxCol; ++col) {
+            for (uint32_t id : _cells[static_cast<size_t>(row) * _columns + col]) {
+                // a box in several of the visited cells is reported from the first one only
+                const CellRange boxRange = getRange(_boxes[id]);
+                if (std::max(boxRange.minCol, range.minCol) == col && std::max(boxRange.minRow, range.minRow) == row) {
+                    result.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+void CollisionGrid::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const {
+    BoundingBox region;
+    region.min = center - glm::vec3(radius);
+    region.max = center + glm::vec3(radius);
+    query(region, result);
+}
+
+size_t CollisionGrid::getByteSize() const {
+    size_t bytes = _cells.capacity() * sizeof(std::vector<uint32_t>);
+    bytes += _boxes.capacity() * sizeof(BoundingBox) + _used.capacity() + _freeIds.capacity() * sizeof(uint32_t);
+    for (const std::vector<uint32_t>& cell : _cells) {
+        bytes += cell.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+CollisionGrid::CellRange CollisionGrid::getRange(const BoundingBox& box) const {
+    // clamped in float first, so boxes far outside do not overflow the int conversion
+    const glm::vec2 limit(static_cast<float>(_columns - 1), static_cast<float>(_rows - 1));
+    const glm::vec2 minCorner = (glm::vec2(box.min.x, box.min.z) - _origin) * _inverseCellSize + 0.5f;
+    const glm::vec2 maxCorner = (glm::vec2(box.max.x, box.max.z) - _origin) * _inverseCellSize + 0.5f;
+    const glm::vec2 minCell = glm::clamp(glm::floor(minCorner), glm::vec2(0.0f), limit);
+    const glm::vec2 maxCell = glm::clamp(glm::floor(maxCorner), glm::vec2(0.0f), limit);
+
+    CellRange range;
+    range.minCol = static_cast<int>(minCell.x);
+    range.minRow = static_cast<int>(minCell.y);
+    range.maxCol = static_cast<int>(maxCell.x);
+    range.maxRow = static_cast<int>(maxCell.y);
+    return range;
+}
+
+void CollisionGrid::link(uint32_t id) {
+    const BoundingBox& box = _boxes[id];
+    if (box.isEmpty()) {
+        return;
+    }
+
+    const CellRange range = getRange(box);
+    for (int row = range.minRow; row <= range.maxRow; ++row) {
+        for (int col = range.minCol; col <= range.maxCol; ++col) {
+            _cells[static_cast<size_t>(row) * _columns + col].push_back(id);
+        }
+    }
+}
+
+void CollisionGrid::unlink(uint32_t id) {
+    const BoundingBox& box = _boxes[id];
+    if (box.isEmpty()) {
+        return;
+    }
+
+    const CellRange range = getRange(box);
+    for (int row = range.minRow; row <= range.maxRow; ++row) {
+        for (int col = range.minCol; col <= range.maxCol; ++col) {
+            std::vector<uint32_t>& cell = _cells[static_cast<size_t>(row) * _columns + col];
+            cell.erase(std::find(cell.begin(), cell.end(), id));
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/bounding_box.h"
+
+// Uniform grid over the xz plane which finds the boxes near a point without looking at the
+// others, the broadphase of the collision against the maze walls.
+//
+// The cells have the size of the maze cells, cell (0, 0) is centered on origin like the maze.
+// A box is registered in every cell its xz rectangle overlaps, boxes and queries beyond the
+// grid are clamped to its border cells, so nothing is lost outside of it. A query visits the
+// cells its rectangle overlaps, for a sphere of at most half a cell that is a part of the 3 x 3
+// cells around its center, however large the maze is. A box reaching into several of the
+// visited cells is only reported from the first of them, so queries need no scratch state and
+// can run on several threads at once.
+//
+// Boxes are addressed by the id returned when they were added, ids of removed boxes are
+// reused by later inserts.
+class CollisionGrid {
+public:
+    // drops all boxes
+    void reset(const glm::vec2& origin, float cellSize, int columns, int rows);
+
+    // reset and insert boxes[i] with id i
+    void build(const glm::vec2& origin, float cellSize, int columns, int rows, const std::vector<BoundingBox>& boxes);
+
+    void clear();
+
+    uint32_t insert(const BoundingBox& box);
+
+    void update(uint32_t id, const BoundingBox& box);
+
+    void remove(uint32_t id);
+
+    // number of boxes
+    size_t size() const;
+
+    int getColumnCount() const;
+
+    int getRowCount() const;
+
+    float getCellSize() const;
+
+    // cell of a world space position, may lie outside of the grid
+    glm::ivec2 getCell(const glm::vec3& position) const;
+
+    const BoundingBox& getBox(uint32_t id) const;
+
+    // appends the ids of the boxes registered in the cells overlapped by the xz rectangle of
+    // region, each once. a superset of the boxes touching region, y is ignored
+    void query(const BoundingBox& region, std::vector<uint32_t>& result) const;
+
+    // query() around a sphere
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const;
+
+    size_t getByteSize() const;
+
+private:
+    // inclusive cell range of a rectangle, clamped to the grid
+    struct CellRange {
+        int minCol, minRow, maxCol, maxRow;
+    };
+
+    glm::vec2 _origin = glm::vec2(0.0f);
+    float _cellSize = 1.0f;
+    float _inverseCellSize = 1.0f;
+    int _columns = 0;
+    int _rows = 0;
+    // box ids per cell, row major
+    std::vector<std::vector<uint32_t>> _cells;
+    std::vector<BoundingBox> _boxes;
+    std::vector<uint8_t> _used;
+    std::vector<uint32_t> _freeIds;
+    size_t _size = 0;
+
+    CellRange getRange(const BoundingBox& box) const;
+
+    void link(uint32_t id);
+
+    void unlink(uint32_t id);
+};
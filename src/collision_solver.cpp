@@ -0,0 +1,262 @@
+#include "collision_solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "base/thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISION_SSE 1
+#endif
+
+namespace {
+
+    // movers per task when a frame is spread over the pool
+    constexpr size_t moversPerTask = 32;
+
+    // scratch of one thread, reused across its movers
+    struct MoverScratch {
+        std::vector<uint32_t> ids;
+        CollisionBoxBatch boxes;
+    };
+
+    thread_local MoverScratch workerScratch;
+
+    // the axis of the box face nearest to a center inside of it, signed away from the box
+    glm::vec3 getExitNormal(const BoundingBox& box, const glm::vec3& center, float& distance) {
+        const glm::vec3 toMin = center - box.min;
+        const glm::vec3 toMax = box.max - center;
+        glm::vec3 normal(0.0f);
+        distance = std::numeric_limits<float>::max();
+        for (int axis = 0; axis < 3; ++axis) {
+            if (toMin[axis] < distance) {
+                distance = toMin[axis];
+                normal = glm::vec3(0.0f);
+                normal[axis] = -1.0f;
+            }
+            if (toMax[axis] < distance) {
+                distance = toMax[axis];
+                normal = glm::vec3(0.0f);
+                normal[axis] = 1.0f;
+            }
+        }
+        return normal;
+    }
+
+    void moveOne(const CollisionGrid& grid, CollisionMover& mover, MoverScratch& scratch, CollisionStats& stats) {
+        mover.contacts = 0;
+        glm::vec3 position = mover.position;
+        const float radius = mover.radius;
+
+        // a longer move, e.g. after a hitch, is cut to what the substeps cover without tunneling
+        const float maxStep = 0.5f * radius;
+        const float maxLength = maxStep * static_cast<float>(CollisionSolver::maxSubsteps);
+        glm::vec3 remaining = mover.displacement;
+        const float length = glm::length(remaining);
+        if (length > maxLength) {
+            remaining *= maxLength / length;
+        }
+
+        // candidates around the whole path, with room for the pushes out of them
+        BoundingBox region;
+        region += position;
+        region += position + remaining;
+        region.min -= glm::vec3(2.0f * radius);
+        region.max += glm::vec3(2.0f * radius);
+        scratch.ids.clear();
+        grid.query(region, scratch.ids);
+        scratch.boxes.clear();
+        for (uint32_t id : scratch.ids) {
+            scratch.boxes.add(grid.getBox(id));
+        }
+        scratch.boxes.finish();
+        stats.candidates += scratch.ids.size();
+
+        const int substeps = std::clamp(
+            static_cast<int>(std::ceil(glm::length(remaining) / maxStep)), 1, CollisionSolver::maxSubsteps);
+        stats.substeps += static_cast<size_t>(substeps);
+        for (int step = 0; step < substeps; ++step) {
+            const glm::vec3 delta = remaining / static_cast<float>(substeps - step);
+            position += delta;
+            remaining -= delta;
+
+            for (int iteration = 0; iteration < CollisionSolver::maxIterations; ++iteration) {
+                stats.tests += scratch.boxes.minX.size();
+                const int contact = findDeepestContact(scratch.boxes, position, radius);
+                if (contact < 0) {
+                    break;
+                }
+
+                const BoundingBox& box = grid.getBox(scratch.ids[static_cast<size_t>(contact)]);
+                const glm::vec3 offset = position - glm::clamp(position, box.min, box.max);
+                const float squaredDistance = glm::dot(offset, offset);
+                glm::vec3 normal;
+                float depth;
+                if (squaredDistance > 0.0f) {
+                    const float distance = std::sqrt(squaredDistance);
+                    normal = offset / distance;
+                    depth = radius - distance;
+                }
+                else {
+                    float inside;
+                    normal = getExitNormal(box, position, inside);
+                    depth = radius + inside;
+                }
+                position += normal * (depth + CollisionSolver::skin);
+                ++mover.contacts;
+
+                // slide: the rest of the move keeps only its part along the wall
+                const float into = glm::dot(remaining, normal);
+                if (into < 0.0f) {
+                    remaining -= normal * into;
+                }
+            }
+        }
+
+        mover.position = position;
+        stats.contacts += mover.contacts;
+    }
+
+} // namespace
+
+void CollisionBoxBatch::clear() {
+    minX.clear();
+    minY.clear();
+    minZ.clear();
+    maxX.clear();
+    maxY.clear();
+    maxZ.clear();
+    count = 0;
+}
+
+void CollisionBoxBatch::add(const BoundingBox& box) {
+    minX.push_back(box.min.x);
+    minY.push_back(box.min.y);
+    minZ.push_back(box.min.z);
+    maxX.push_back(box.max.x);
+    maxY.push_back(box.max.y);
+    maxZ.push_back(box.max.z);
+    ++count;
+}
+
+void CollisionBoxBatch::finish() {
+    // inverted boxes at the far end of space, their distance to anything is infinite
+    const float far = std::numeric_limits<float>::max();
+    while (minX.size() % 4 != 0) {
+        minX.push_back(far);
+        minY.push_back(far);
+        minZ.push_back(far);
+        maxX.push_back(-far);
+        maxY.push_back(-far);
+        maxZ.push_back(-far);
+    }
+}
+
+int findDeepestContact(const CollisionBoxBatch& boxes, const glm::vec3& center, float radius) {
+    // a contact ranks by its squared distance minus the squared depth of the center inside of
+    // the box, both are never positive at once. the smallest key is the deepest contact
+    const float squaredRadius = radius * radius;
+    float bestKey = std::numeric_limits<float>::infinity();
+    int best = -1;
+    size_t i = 0;
+#ifdef COLLISION_SSE
+    const __m128 cx = _mm_set1_ps(center.x);
+    const __m128 cy = _mm_set1_ps(center.y);
+    const __m128 cz = _mm_set1_ps(center.z);
+    const __m128 limit = _mm_set1_ps(squaredRadius);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 bestKeys = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128i bestIndices = _mm_set1_epi32(-1);
+    __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i four = _mm_set1_epi32(4);
+    for (; i + 4 <= boxes.minX.size(); i += 4) {
+        const __m128 belowX = _mm_sub_ps(_mm_loadu_ps(&boxes.minX[i]), cx);
+        const __m128 belowY = _mm_sub_ps(_mm_loadu_ps(&boxes.minY[i]), cy);
+        const __m128 belowZ = _mm_sub_ps(_mm_loadu_ps(&boxes.minZ[i]), cz);
+        const __m128 aboveX = _mm_sub_ps(cx, _mm_loadu_ps(&boxes.maxX[i]));
+        const __m128 aboveY = _mm_sub_ps(cy, _mm_loadu_ps(&boxes.maxY[i]));
+        const __m128 aboveZ = _mm_sub_ps(cz, _mm_loadu_ps(&boxes.maxZ[i]));
+        // per axis the distance outside of the slab, or minus the distance to its nearer face
+        const __m128 gapX = _mm_max_ps(belowX, aboveX);
+        const __m128 gapY = _mm_max_ps(belowY, aboveY);
+        const __m128 gapZ = _mm_max_ps(belowZ, aboveZ);
+        const __m128 outX = _mm_max_ps(gapX, zero);
+        const __m128 outY = _mm_max_ps(gapY, zero);
+        const __m128 outZ = _mm_max_ps(gapZ, zero);
+        const __m128 squaredDistance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(outX, outX), _mm_mul_ps(outY, outY)), _mm_mul_ps(outZ, outZ));
+        const __m128 inside = _mm_max_ps(_mm_sub_ps(zero, _mm_max_ps(_mm_max_ps(gapX, gapY), gapZ)), zero);
+        const __m128 key = _mm_sub_ps(squaredDistance, _mm_mul_ps(inside, inside));
+        const __m128 better = _mm_and_ps(_mm_cmplt_ps(squaredDistance, limit), _mm_cmplt_ps(key, bestKeys));
+        bestKeys = _mm_or_ps(_mm_and_ps(better, key), _mm_andnot_ps(better, bestKeys));
+        const __m128i betterIndices = _mm_castps_si128(better);
+        bestIndices = _mm_or_si128(_mm_and_si128(betterIndices, indices), _mm_andnot_si128(betterIndices, bestIndices));
+        indices = _mm_add_epi32(indices, four);
+    }
+
+    alignas(16) float laneKeys[4];
+    alignas(16) int32_t laneIndices[4];
+    _mm_store_ps(laneKeys, bestKeys);
+    _mm_store_si128(reinterpret_cast<__m128i*>(laneIndices), bestIndices);
+    for (int lane = 0; lane < 4; ++lane) {
+        if (laneIndices[lane] >= 0
+            && (laneKeys[lane] < bestKey || (laneKeys[lane] == bestKey && laneIndices[lane] < best))) {
+            bestKey = laneKeys[lane];
+            best = laneIndices[lane];
+        }
+    }
+#endif
+    for (; i < boxes.minX.size(); ++i) {
+        const glm::vec3 gap = glm::max(
+            glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]) - center,
+            center - glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]));
+        const glm::vec3 out = glm::max(gap, glm::vec3(0.0f));
+        const float squaredDistance = glm::dot(out, out);
+        const float inside = std::max(-std::max(std::max(gap.x, gap.y), gap.z), 0.0f);
+        const float key = squaredDistance - inside * inside;
+        if (squaredDistance < squaredRadius && key < bestKey) {
+            bestKey = key;
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
+
+void CollisionSolver::move(const CollisionGrid& grid, std::vector<CollisionMover>& movers, size_t maxThreads) {
+    const auto begin = std::chrono::high_resolution_clock::now();
+    _stats = CollisionStats();
+    _stats.movers = movers.size();
+
+    if (movers.size() < parallelThreshold) {
+        MoverScratch& scratch = workerScratch;
+        for (CollisionMover& mover : movers) {
+            moveOne(grid, mover, scratch, _stats);
+        }
+    }
+    else {
+        const size_t taskCount = (movers.size() + moversPerTask - 1) / moversPerTask;
+        std::vector<CollisionStats> taskStats(taskCount);
+        ThreadPool::getGlobal().parallelFor(taskCount, [&](size_t task) {
+            MoverScratch& scratch = workerScratch;
+            const size_t end = std::min(movers.size(), (task + 1) * moversPerTask);
+            for (size_t i = task * moversPerTask; i < end; ++i) {
+                moveOne(grid, movers[i], scratch, taskStats[task]);
+            }
+            }, maxThreads);
+        for (const CollisionStats& stats : taskStats) {
+            _stats.substeps += stats.substeps;
+            _stats.candidates += stats.candidates;
+            _stats.tests += stats.tests;
+            _stats.contacts += stats.contacts;
+        }
+    }
+
+    _stats.ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+}
+
+const CollisionStats& CollisionSolver::getStats() const {
+    return _stats;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/bounding_box.h"
+#include "collision_grid.h"
+
+// a sphere which wants to move by displacement this frame
+struct CollisionMover {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 displacement = glm::vec3(0.0f);
+    float radius = 0.2f;
+    // written by the solver: the pushes out of boxes of the last move
+    uint32_t contacts = 0;
+};
+
+// statistics of the last move()
+struct CollisionStats {
+    size_t movers = 0;
+    size_t substeps = 0;
+    size_t candidates = 0;
+    // sphere box tests, a batch of 4 boxes counts 4
+    size_t tests = 0;
+    size_t contacts = 0;
+    double ms = 0.0;
+};
+
+// boxes as structure of arrays, padded to a multiple of 4 with boxes no sphere touches
+struct CollisionBoxBatch {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+    size_t count = 0;
+
+    void clear();
+
+    void add(const BoundingBox& box);
+
+    // pads to the next multiple of 4
+    void finish();
+};
+
+// index of the box in the batch the sphere penetrates deepest, -1 if it touches none. the
+// squared distance of the center to every box is compared to radius^2, 4 boxes at a time with
+// SSE. a center inside of a box counts deeper than any one outside
+int findDeepestContact(const CollisionBoxBatch& boxes, const glm::vec3& center, float radius);
+
+// Moves spheres through the boxes of a CollisionGrid, collide and slide: the move is split
+// into substeps of at most half the radius, so fast movers do not tunnel through thin boxes.
+// Moves longer than maxSubsteps such steps are shortened to that length. After each substep
+// the sphere is pushed out of the box it penetrates deepest along the box normal at the
+// contact, again until it is free or maxIterations is reached, and the rest of the move loses
+// its part into that normal, so it slides along the wall instead of stopping. The candidates
+// of a mover are gathered once around its whole path and tested as one batch per iteration.
+// Movers are independent of each other, large frames are spread over the global thread pool.
+class CollisionSolver {
+public:
+    static constexpr int maxSubsteps = 16;
+
+    static constexpr int maxIterations = 4;
+
+    // movers below this count are moved on the calling thread
+    static constexpr size_t parallelThreshold = 64;
+
+    // distance kept to the boxes after a push, against touching again through rounding
+    static constexpr float skin = 1e-4f;
+
+    // maxThreads == 0 uses the whole global pool
+    void move(const CollisionGrid& grid, std::vector<CollisionMover>& movers, size_t maxThreads = 0);
+
+    const CollisionStats& getStats() const;
+
+private:
+    CollisionStats _stats;
+};
@@ -0,0 +1,309 @@
+#include "frustum_culler.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#define CULLING_X86 1
+#endif
+
+#if defined(CULLING_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CULLING_SSE 1
+#endif
+
+// the avx kernel is compiled for avx on its own and only called after the cpu check, the rest
+// of the program keeps the baseline instruction set
+#if defined(CULLING_SSE) && (defined(__GNUC__) || defined(__clang__))
+#define CULLING_AVX 1
+#define CULLING_TARGET_AVX __attribute__((target("avx")))
+#elif defined(CULLING_SSE) && defined(_MSC_VER)
+#define CULLING_AVX 1
+#define CULLING_TARGET_AVX
+#endif
+
+namespace {
+
+    // extent of boxes which must never be culled, large but finite so that 0 * extent stays 0
+    constexpr float unboundedExtent = 1e30f;
+
+    // the largest number of indices a kernel writes past the visible count
+    constexpr size_t outputSlack = 8;
+
+    // per plane: normal, signed distance and the absolute normal, which projects the extent
+    struct CullingPlanes {
+        float normal[3][6];
+        float distance[6];
+        float absNormal[3][6];
+
+        explicit CullingPlanes(const Frustum& frustum) {
+            for (int p = 0; p < 6; ++p) {
+                const Plane& plane = frustum.planes[p];
+                for (int axis = 0; axis < 3; ++axis) {
+                    normal[axis][p] = plane.normal[axis];
+                    absNormal[axis][p] = glm::abs(plane.normal[axis]);
+                }
+                distance[p] = plane.signedDistance;
+            }
+        }
+    };
+
+    // same order of operations as Frustum::intersect, so that every kernel gives the same result
+    size_t cullScalar(
+        const CullingPlanes& planes, const InstanceBounds& bounds, size_t begin, uint32_t* visible) {
+        const float* cx = bounds.getCenters(0);
+        const float* cy = bounds.getCenters(1);
+        const float* cz = bounds.getCenters(2);
+        const float* ex = bounds.getExtents(0);
+        const float* ey = bounds.getExtents(1);
+        const float* ez = bounds.getExtents(2);
+
+        size_t count = 0;
+        for (size_t i = begin; i < bounds.size(); ++i) {
+            // one box at a time, leaving at the first plane it is outside of pays off here
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; ++p) {
+                const float distance =
+                    planes.normal[0][p] * cx[i] + planes.normal[1][p] * cy[i] + planes.normal[2][p] * cz[i]
+                    + planes.distance[p];
+                const float radius =
+                    planes.absNormal[0][p] * ex[i] + planes.absNormal[1][p] * ey[i] + planes.absNormal[2][p] * ez[i];
+                inside = distance >= -radius;
+            }
+            // written unconditionally, only visible boxes advance the count
+            visible[count] = static_cast<uint32_t>(i);
+            count += inside ? 1 : 0;
+        }
+        return count;
+    }
+
+#ifdef CULLING_SSE
+    size_t cullSSE(const CullingPlanes& planes, const InstanceBounds& bounds, uint32_t* visible, size_t& end) {
+        const float* cx = bounds.getCenters(0);
+        const float* cy = bounds.getCenters(1);
+        const float* cz = bounds.getCenters(2);
+        const float* ex = bounds.getExtents(0);
+        const float* ey = bounds.getExtents(1);
+        const float* ez = bounds.getExtents(2);
+
+        __m128 nx[6], ny[6], nz[6], d[6], ax[6], ay[6], az[6];
+        for (int p = 0; p < 6; ++p) {
+            nx[p] = _mm_set1_ps(planes.normal[0][p]);
+            ny[p] = _mm_set1_ps(planes.normal[1][p]);
+            nz[p] = _mm_set1_ps(planes.normal[2][p]);
+            d[p] = _mm_set1_ps(planes.distance[p]);
+            ax[p] = _mm_set1_ps(planes.absNormal[0][p]);
+            ay[p] = _mm_set1_ps(planes.absNormal[1][p]);
+            az[p] = _mm_set1_ps(planes.absNormal[2][p]);
+        }
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+
+        size_t count = 0;
+        const size_t size = bounds.size() / 4 * 4;
+        for (size_t i = 0; i < size; i += 4) {
+            const __m128 x = _mm_loadu_ps(cx + i);
+            const __m128 y = _mm_loadu_ps(cy + i);
+            const __m128 z = _mm_loadu_ps(cz + i);
+            const __m128 hx = _mm_loadu_ps(ex + i);
+            const __m128 hy = _mm_loadu_ps(ey + i);
+            const __m128 hz = _mm_loadu_ps(ez + i);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; ++p) {
+                const __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_mul_ps(nz[p], z)), d[p]);
+                const __m128 radius =
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], hx), _mm_mul_ps(ay[p], hy)), _mm_mul_ps(az[p], hz));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(radius, signMask)));
+            }
+
+            const int mask = _mm_movemask_ps(inside);
+            const uint32_t index = static_cast<uint32_t>(i);
+            for (int lane = 0; lane < 4; ++lane) {
+                visible[count] = index + lane;
+                count += (mask >> lane) & 1;
+            }
+        }
+        end = size;
+        return count;
+    }
+#endif
+
+#ifdef CULLING_AVX
+    CULLING_TARGET_AVX
+    size_t cullAVX(const CullingPlanes& planes, const InstanceBounds& bounds, uint32_t* visible, size_t& end) {
+        const float* cx = bounds.getCenters(0);
+        const float* cy = bounds.getCenters(1);
+        const float* cz = bounds.getCenters(2);
+        const float* ex = bounds.getExtents(0);
+        const float* ey = bounds.getExtents(1);
+        const float* ez = bounds.getExtents(2);
+
+        __m256 nx[6], ny[6], nz[6], d[6], ax[6], ay[6], az[6];
+        for (int p = 0; p < 6; ++p) {
+            nx[p] = _mm256_set1_ps(planes.normal[0][p]);
+            ny[p] = _mm256_set1_ps(planes.normal[1][p]);
+            nz[p] = _mm256_set1_ps(planes.normal[2][p]);
+            d[p] = _mm256_set1_ps(planes.distance[p]);
+            ax[p] = _mm256_set1_ps(planes.absNormal[0][p]);
+            ay[p] = _mm256_set1_ps(planes.absNormal[1][p]);
+            az[p] = _mm256_set1_ps(planes.absNormal[2][p]);
+        }
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+        size_t count = 0;
+        const size_t size = bounds.size() / 8 * 8;
+        for (size_t i = 0; i < size; i += 8) {
+            const __m256 x = _mm256_loadu_ps(cx + i);
+            const __m256 y = _mm256_loadu_ps(cy + i);
+            const __m256 z = _mm256_loadu_ps(cz + i);
+            const __m256 hx = _mm256_loadu_ps(ex + i);
+            const __m256 hy = _mm256_loadu_ps(ey + i);
+            const __m256 hz = _mm256_loadu_ps(ez + i);
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < 6; ++p) {
+                const __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+                        _mm256_mul_ps(nz[p], z)),
+                    d[p]);
+                const __m256 radius = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(ax[p], hx), _mm256_mul_ps(ay[p], hy)), _mm256_mul_ps(az[p], hz));
+                inside = _mm256_and_ps(
+                    inside, _mm256_cmp_ps(distance, _mm256_xor_ps(radius, signMask), _CMP_GE_OQ));
+            }
+
+            const int mask = _mm256_movemask_ps(inside);
+            const uint32_t index = static_cast<uint32_t>(i);
+            for (int lane = 0; lane < 8; ++lane) {
+                visible[count] = index + lane;
+                count += (mask >> lane) & 1;
+            }
+        }
+        end = size;
+        return count;
+    }
+#endif
+
+    bool isAVXSupported() {
+#if !defined(CULLING_AVX)
+        return false;
+#elif defined(_MSC_VER)
+        // the os has to save the ymm registers as well
+        int info[4];
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+        // checks the os support as well
+        return __builtin_cpu_supports("avx");
+#endif
+    }
+
+} // namespace
+
+size_t InstanceBounds::size() const {
+    return _centers[0].size();
+}
+
+void InstanceBounds::clear() {
+    for (int axis = 0; axis < 3; ++axis) {
+        _centers[axis].clear();
+        _extents[axis].clear();
+    }
+}
+
+void InstanceBounds::reserve(size_t count) {
+    for (int axis = 0; axis < 3; ++axis) {
+        _centers[axis].reserve(count);
+        _extents[axis].reserve(count);
+    }
+}
+
+uint32_t InstanceBounds::add(const BoundingBox& box) {
+    const uint32_t index = static_cast<uint32_t>(size());
+    for (int axis = 0; axis < 3; ++axis) {
+        _centers[axis].push_back(0.0f);
+        _extents[axis].push_back(0.0f);
+    }
+    set(index, box);
+    return index;
+}
+
+void InstanceBounds::set(uint32_t index, const BoundingBox& box) {
+    const bool empty = box.isEmpty();
+    const glm::vec3 center = empty ? glm::vec3(0.0f) : box.getCenter();
+    const glm::vec3 extent = empty ? glm::vec3(unboundedExtent) : box.getExtent();
+    for (int axis = 0; axis < 3; ++axis) {
+        _centers[axis][index] = center[axis];
+        _extents[axis][index] = extent[axis];
+    }
+}
+
+BoundingBox InstanceBounds::get(uint32_t index) const {
+    const glm::vec3 center(_centers[0][index], _centers[1][index], _centers[2][index]);
+    const glm::vec3 extent(_extents[0][index], _extents[1][index], _extents[2][index]);
+    BoundingBox box;
+    box.min = center - extent;
+    box.max = center + extent;
+    return box;
+}
+
+const float* InstanceBounds::getCenters(int axis) const {
+    return _centers[axis].data();
+}
+
+const float* InstanceBounds::getExtents(int axis) const {
+    return _extents[axis].data();
+}
+
+CullingKernel getBestCullingKernel() {
+    static const CullingKernel best = []() {
+        if (isAVXSupported()) {
+            return CullingKernel::AVX;
+        }
+#ifdef CULLING_SSE
+        return CullingKernel::SSE;
+#else
+        return CullingKernel::Scalar;
+#endif
+    }();
+    return best;
+}
+
+const char* getCullingKernelName(CullingKernel kernel) {
+    switch (kernel) {
+    case CullingKernel::SSE:
+        return "sse";
+    case CullingKernel::AVX:
+        return "avx";
+    default:
+        return "scalar";
+    }
+}
+
+size_t cullInstances(
+    const Frustum& frustum, const InstanceBounds& bounds, std::vector<uint32_t>& visible, CullingKernel kernel) {
+    const CullingPlanes planes(frustum);
+    // the kernels store every candidate and only advance over the visible ones
+    visible.resize(bounds.size() + outputSlack);
+
+    size_t count = 0;
+    size_t end = 0;
+#ifdef CULLING_AVX
+    if (kernel == CullingKernel::AVX && getBestCullingKernel() == CullingKernel::AVX) {
+        count = cullAVX(planes, bounds, visible.data(), end);
+    }
+#endif
+#ifdef CULLING_SSE
+    if (kernel != CullingKernel::Scalar && end == 0) {
+        count = cullSSE(planes, bounds, visible.data(), end);
+    }
+#endif
+    // the remainder which does not fill a whole register
+    count += cullScalar(planes, bounds, end, visible.data() + count);
+
+    visible.resize(count);
+    return count;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/bounding_box.h"
+#include "base/frustum.h"
+
+// world space boxes of many instances as structure of arrays, so that the culling kernels
+// load 4 / 8 centers or extents of one axis at once
+class InstanceBounds {
+public:
+    size_t size() const;
+
+    void clear();
+
+    void reserve(size_t count);
+
+    // returns the index of the instance
+    uint32_t add(const BoundingBox& box);
+
+    // empty boxes are stored as infinite and never culled
+    void set(uint32_t index, const BoundingBox& box);
+
+    BoundingBox get(uint32_t index) const;
+
+    const float* getCenters(int axis) const;
+
+    const float* getExtents(int axis) const;
+
+private:
+    std::vector<float> _centers[3];
+    std::vector<float> _extents[3];
+};
+
+enum class CullingKernel {
+    Scalar,
+    // 4 boxes per iteration
+    SSE,
+    // 8 boxes per iteration
+    AVX,
+};
+
+// the widest kernel the cpu supports
+CullingKernel getBestCullingKernel();
+
+const char* getCullingKernelName(CullingKernel kernel);
+
+// replaces visible with the ascending indices of the boxes which intersect the frustum and
+// returns their count. the test is the one of Frustum::intersect(const BoundingBox&), kernels
+// the cpu does not support fall back to the scalar one
+size_t cullInstances(
+    const Frustum& frustum, const InstanceBounds& bounds, std::vector<uint32_t>& visible,
+    CullingKernel kernel = getBestCullingKernel());
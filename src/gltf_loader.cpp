@@ -0,0 +1,408 @@
+#include "gltf_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "asset_registry.h"
+#include "base/json.h"
+
+namespace {
+
+    // gltf primitive modes / accessor component types share their values with gl
+    constexpr int gltfModeTriangles = 4;
+
+    size_t getComponentSize(GLenum componentType) {
+        switch (componentType) {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE: return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT: return 4;
+        default: return 0;
+        }
+    }
+
+    int getComponentCount(const std::string& type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    glm::vec3 readVec3(const JsonValue& value, const glm::vec3& fallback) {
+        if (value.size() < 3) {
+            return fallback;
+        }
+        return glm::vec3(value[size_t(0)].asFloat(), value[1].asFloat(), value[2].asFloat());
+    }
+
+    glm::mat4 getNodeMatrix(const JsonValue& node) {
+        const JsonValue& matrix = node["matrix"];
+        if (matrix.size() == 16) {
+            float m[16];
+            for (size_t i = 0; i < 16; ++i) {
+                m[i] = matrix[i].asFloat();
+            }
+            // column major like glm
+            return glm::make_mat4(m);
+        }
+
+        const glm::vec3 translation = readVec3(node["translation"], glm::vec3(0.0f));
+        const glm::vec3 scale = readVec3(node["scale"], glm::vec3(1.0f));
+        glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+        const JsonValue& r = node["rotation"];
+        if (r.size() == 4) {
+            // gltf stores x, y, z, w
+            rotation = glm::quat(r[3].asFloat(), r[size_t(0)].asFloat(), r[1].asFloat(), r[2].asFloat());
+        }
+        return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation)
+               * glm::scale(glm::mat4(1.0f), scale);
+    }
+
+    class GltfSceneBuilder {
+    public:
+        GltfSceneBuilder(const JsonValue& document, GltfScene& scene) : _document(document), _scene(scene) {}
+
+        void build() {
+            _viewIntervals.resize(_document["bufferViews"].size());
+
+            const JsonValue& scenes = _document["scenes"];
+            const JsonValue& scene = scenes[_document["scene"].asSize(0)];
+            if (!scene.isObject()) {
+                throw std::runtime_error("gltf has no scene");
+            }
+            for (const JsonValue& node : scene["nodes"].getValues()) {
+                visitNode(node.asSize(), glm::mat4(1.0f), 0);
+            }
+            if (_scene.primitives.empty()) {
+                throw std::runtime_error("gltf scene has no indexed triangle primitives");
+            }
+
+            resolveRanges();
+        }
+
+    private:
+        const JsonValue& _document;
+        GltfScene& _scene;
+        struct Interval {
+            size_t begin;
+            size_t end;
+            size_t range;
+        };
+
+        // bytes of each buffer view covered by used accessors, relative to the view
+        std::vector<std::vector<Interval>> _viewIntervals;
+        bool _hasBounds = false;
+
+        void visitNode(size_t nodeIndex, const glm::mat4& parentMatrix, int depth) {
+            const JsonValue& node = _document["nodes"][nodeIndex];
+            // the node graph must be a forest, the depth limit guards against cycles
+            if (!node.isObject() || depth > 64) {
+                throw std::runtime_error("gltf has an invalid node hierarchy");
+            }
+
+            const glm::mat4 worldMatrix = parentMatrix * getNodeMatrix(node);
+            if (node.has("mesh")) {
+                const JsonValue& mesh = _document["meshes"][node["mesh"].asSize()];
+                for (const JsonValue& primitive : mesh["primitives"].getValues()) {
+                    addPrimitive(primitive, worldMatrix, mesh["name"].asString());
+                }
+            }
+            for (const JsonValue& child : node["children"].getValues()) {
+                visitNode(child.asSize(), worldMatrix, depth + 1);
+            }
+        }
+
+        void addPrimitive(const JsonValue& primitive, const glm::mat4& worldMatrix, const std::string& meshName) {
+            const JsonValue& attributes = primitive["attributes"];
+            if (primitive["mode"].asInt(gltfModeTriangles) != gltfModeTriangles || !primitive.has("indices")
+                || !attributes.has("POSITION") || !attributes.has("NORMAL")) {
+                std::cout << "Warning: skipping gltf primitive of mesh '" << meshName
+                          << "', only indexed triangles with normals are supported" << std::endl;
+                return;
+            }
+
+            GltfPrimitive result;
+            result.worldMatrix = worldMatrix;
+            result.positions = resolveAccessor(attributes["POSITION"].asSize());
+            result.normals = resolveAccessor(attributes["NORMAL"].asSize());
+            if (attributes.has("TEXCOORD_0")) {
+                result.texCoords = resolveAccessor(attributes["TEXCOORD_0"].asSize());
+            }
+            result.indices = resolveAccessor(primitive["indices"].asSize());
+
+            if (result.positions.componentType != GL_FLOAT || result.positions.componentCount != 3
+                || result.normals.componentType != GL_FLOAT || result.normals.componentCount != 3) {
+                throw std::runtime_error("gltf positions and normals must be float vec3");
+            }
+            const GLenum indexType = result.indices.componentType;
+            if (result.indices.componentCount != 1 || result.indices.byteStride != 0
+                || (indexType != GL_UNSIGNED_BYTE && indexType != GL_UNSIGNED_SHORT && indexType != GL_UNSIGNED_INT)) {
+                throw std::runtime_error("gltf indices must be tightly packed unsigned integers");
+            }
+
+            // primitives without material index a null value and keep the defaults
+            const JsonValue& material =
+                _document["materials"][primitive["material"].asSize(std::numeric_limits<size_t>::max())];
+            const JsonValue& pbr = material["pbrMetallicRoughness"];
+            result.baseColor = readVec3(pbr["baseColorFactor"], glm::vec3(1.0f));
+            if (pbr.has("baseColorTexture")) {
+                const JsonValue& texture = _document["textures"][pbr["baseColorTexture"]["index"].asSize()];
+                result.texturePath = _document["images"][texture["source"].asSize()]["uri"].asString();
+            }
+
+            expandBounds(attributes["POSITION"].asSize(), result);
+            _scene.primitives.push_back(std::move(result));
+        }
+
+        GltfAccessor resolveAccessor(size_t accessorIndex) {
+            const JsonValue& accessor = _document["accessors"][accessorIndex];
+            if (!accessor.isObject() || !accessor.has("bufferView") || accessor.has("sparse")) {
+                throw std::runtime_error(
+                    "gltf accessor " + std::to_string(accessorIndex) + " has no buffer view or is sparse");
+            }
+
+            GltfAccessor result;
+            // the view index until resolveRanges
+            result.range = accessor["bufferView"].asSize();
+            result.byteOffset = accessor["byteOffset"].asSize(0);
+            result.count = accessor["count"].asSize(0);
+            result.componentType = static_cast<GLenum>(accessor["componentType"].asInt());
+            result.componentCount = getComponentCount(accessor["type"].asString());
+            result.normalized = accessor["normalized"].asBool(false);
+
+            const JsonValue& view = _document["bufferViews"][result.range];
+            const size_t componentSize = getComponentSize(result.componentType);
+            if (!view.isObject() || componentSize == 0 || result.componentCount == 0 || result.count == 0) {
+                throw std::runtime_error("gltf accessor " + std::to_string(accessorIndex) + " is invalid");
+            }
+
+            const size_t elementSize = componentSize * result.componentCount;
+            result.byteStride = view["byteStride"].asSize(0);
+            const size_t stride = result.byteStride != 0 ? result.byteStride : elementSize;
+            const size_t end = result.byteOffset + stride * (result.count - 1) + elementSize;
+            if (end > view["byteLength"].asSize(0)) {
+                throw std::runtime_error("gltf accessor " + std::to_string(accessorIndex) + " exceeds its buffer view");
+            }
+
+            _viewIntervals[result.range].push_back({ result.byteOffset, end, 0 });
+            return result;
+        }
+
+        // the min / max of position accessors are mandatory, no need to read the vertices
+        void expandBounds(size_t positionAccessor, GltfPrimitive& primitive) {
+            const JsonValue& accessor = _document["accessors"][positionAccessor];
+            if (accessor["min"].size() < 3 || accessor["max"].size() < 3) {
+                throw std::runtime_error("gltf position accessor has no min / max");
+            }
+            const glm::vec3 minV = readVec3(accessor["min"], glm::vec3(0.0f));
+            const glm::vec3 maxV = readVec3(accessor["max"], glm::vec3(0.0f));
+            primitive.bounds.min = minV;
+            primitive.bounds.max = maxV;
+
+            for (int corner = 0; corner < 8; ++corner) {
+                const glm::vec3 p(
+                    (corner & 1) ? maxV.x : minV.x, (corner & 2) ? maxV.y : minV.y, (corner & 4) ? maxV.z : minV.z);
+                const glm::vec3 world = glm::vec3(primitive.worldMatrix * glm::vec4(p, 1.0f));
+                _scene.boundsMin = _hasBounds ? glm::min(_scene.boundsMin, world) : world;
+                _scene.boundsMax = _hasBounds ? glm::max(_scene.boundsMax, world) : world;
+                _hasBounds = true;
+            }
+        }
+
+        // merges the overlapping or touching accessor intervals of each view into ranges
+        void resolveRanges() {
+            const JsonValue& bufferViews = _document["bufferViews"];
+            for (size_t v = 0; v < bufferViews.size(); ++v) {
+                std::vector<Interval>& intervals = _viewIntervals[v];
+                if (intervals.empty()) {
+                    continue;
+                }
+
+                const JsonValue& view = bufferViews[v];
+                const size_t bufferIndex = view["buffer"].asSize();
+                const size_t viewOffset = view["byteOffset"].asSize(0);
+                if (bufferIndex >= _scene.buffers.size()
+                    || viewOffset + view["byteLength"].asSize(0) > _scene.buffers[bufferIndex].size()) {
+                    throw std::runtime_error("gltf buffer view " + std::to_string(v) + " exceeds its buffer");
+                }
+
+                std::sort(intervals.begin(), intervals.end(), [](const Interval& lhs, const Interval& rhs) {
+                    return lhs.begin < rhs.begin;
+                    });
+                size_t merged = 0;
+                for (size_t i = 1; i < intervals.size(); ++i) {
+                    if (intervals[i].begin <= intervals[merged].end) {
+                        intervals[merged].end = std::max(intervals[merged].end, intervals[i].end);
+                    }
+                    else {
+                        intervals[++merged] = intervals[i];
+                    }
+                }
+                intervals.resize(merged + 1);
+
+                for (Interval& interval : intervals) {
+                    interval.range = _scene.ranges.size();
+                    GltfBufferRange range;
+                    range.data = _scene.buffers[bufferIndex].data() + viewOffset + interval.begin;
+                    range.byteLength = interval.end - interval.begin;
+                    _scene.ranges.push_back(range);
+                }
+            }
+
+            for (GltfPrimitive& primitive : _scene.primitives) {
+                for (GltfAccessor* accessor :
+                     { &primitive.positions, &primitive.normals, &primitive.texCoords, &primitive.indices }) {
+                    if (accessor->componentCount == 0) {
+                        continue;
+                    }
+                    const std::vector<Interval>& intervals = _viewIntervals[accessor->range];
+                    const auto it = std::upper_bound(
+                        intervals.begin(), intervals.end(), accessor->byteOffset,
+                        [](size_t offset, const Interval& interval) { return offset < interval.begin; });
+                    const Interval& interval = *(it - 1);
+                    accessor->range = interval.range;
+                    accessor->byteOffset -= interval.begin;
+                }
+            }
+        }
+    };
+
+    void bindAttribute(GLuint location, const GltfAccessor& accessor, const std::vector<GLuint>& buffers) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[accessor.range]);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(
+            location, accessor.componentCount, accessor.componentType, accessor.normalized ? GL_TRUE : GL_FALSE,
+            static_cast<GLsizei>(accessor.byteStride), reinterpret_cast<void*>(accessor.byteOffset));
+    }
+
+} // namespace
+
+GltfScene loadGltfScene(const std::string& path) {
+    MappedFile file;
+    try {
+        file = MappedFile(path);
+    }
+    catch (const std::exception&) {
+        throw std::runtime_error("failed to open gltf: " + path);
+    }
+    const JsonValue document = JsonValue::parse(file.data(), file.data() + file.size());
+
+    const std::string& version = document["asset"]["version"].asString();
+    if (version.empty() || version[0] != '2') {
+        throw std::runtime_error("unsupported gltf version '" + version + "': " + path);
+    }
+
+    GltfScene scene;
+    const auto lastSlash = path.find_last_of("/\\");
+    scene.directory = (lastSlash == std::string::npos) ? "" : path.substr(0, lastSlash + 1);
+
+    for (const JsonValue& buffer : document["buffers"].getValues()) {
+        const std::string& uri = buffer["uri"].asString();
+        if (uri.empty() || uri.compare(0, 5, "data:") == 0) {
+            throw std::runtime_error("gltf buffers must be external files: " + path);
+        }
+        scene.buffers.emplace_back(scene.directory + uri);
+        if (scene.buffers.back().size() < buffer["byteLength"].asSize(0)) {
+            throw std::runtime_error("gltf buffer is truncated: " + scene.directory + uri);
+        }
+    }
+
+    GltfSceneBuilder(document, scene).build();
+    return scene;
+}
+
+Model createModel(const GltfScene& scene) {
+    TextureCache textureCache;
+    return createModel(scene, textureCache);
+}
+
+Model createModel(const GltfScene& scene, TextureCache& textureCache) {
+    std::vector<GLuint> buffers(scene.ranges.size(), 0);
+    size_t bufferBytes = 0;
+    glGenBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+    for (size_t i = 0; i < scene.ranges.size(); ++i) {
+        bufferBytes += scene.ranges[i].byteLength;
+        // buffer objects are untyped, a range may serve as vertex or index buffer
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        glBufferData(
+            GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(scene.ranges[i].byteLength), scene.ranges[i].data,
+            GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const glm::vec3 center = 0.5f * (scene.boundsMin + scene.boundsMax);
+    const glm::vec3 extent = scene.boundsMax - scene.boundsMin;
+    const float maxExtent = std::max({ extent.x, extent.y, extent.z, 1e-4f });
+    const glm::mat4 normalization =
+        glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / maxExtent)) * glm::translate(glm::mat4(1.0f), -center);
+
+    std::vector<Mesh> meshes;
+    for (const GltfPrimitive& primitive : scene.primitives) {
+        Mesh mesh{};
+        mesh.baseColor = primitive.baseColor;
+        mesh.localMatrix = normalization * primitive.worldMatrix;
+        mesh.bounds = primitive.bounds;
+        // gltf puts the uv origin at the top left, textures are loaded bottom up
+        mesh.flipTexCoordY = true;
+
+        if (!primitive.texturePath.empty()) {
+            const std::string texturePath = scene.directory + primitive.texturePath;
+            auto it = textureCache.find(texturePath);
+            if (it == textureCache.end()) {
+                std::shared_ptr<ImageTexture2D> texture;
+                try {
+                    texture = AssetRegistry::getGlobal().getTexture(texturePath);
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "  -> ERROR: Failed to load texture: " << e.what() << std::endl;
+                }
+                it = textureCache.emplace(texturePath, texture).first;
+            }
+            mesh.diffuseTexture = it->second;
+        }
+
+        glGenVertexArrays(1, &mesh.vao);
+        glBindVertexArray(mesh.vao);
+        bindAttribute(0, primitive.positions, buffers);
+        bindAttribute(1, primitive.normals, buffers);
+        if (primitive.texCoords.componentCount != 0) {
+            bindAttribute(2, primitive.texCoords, buffers);
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[primitive.indices.range]);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        mesh.indexCount = primitive.indices.count;
+        mesh.indexType = primitive.indices.componentType;
+        mesh.indexByteOffset = primitive.indices.byteOffset;
+        meshes.push_back(std::move(mesh));
+    }
+
+    return Model(std::move(meshes), std::move(buffers), bufferBytes);
+}
+
+Model loadModelFromGltf(const std::string& path) {
+    const auto begin = std::chrono::high_resolution_clock::now();
+
+    const GltfScene scene = loadGltfScene(path);
+    Model model = createModel(scene);
+
+    size_t uploadedBytes = 0;
+    for (const GltfBufferRange& range : scene.ranges) {
+        uploadedBytes += range.byteLength;
+    }
+    std::cout << "Loaded gltf: " << path << " (" << scene.primitives.size() << " primitives, "
+              << uploadedBytes / 1024 << " KiB uploaded, "
+              << std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - begin).count()
+              << " ms)" << std::endl;
+    return model;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/mapped_file.h"
+#include "model.h"
+
+// an accessor resolved down to the uploaded byte range that contains it
+struct GltfAccessor {
+    // index into GltfScene::ranges
+    size_t range = 0;
+    // relative to the start of the uploaded range
+    size_t byteOffset = 0;
+    // 0 for tightly packed elements
+    size_t byteStride = 0;
+    size_t count = 0;
+    GLenum componentType = GL_FLOAT;
+    int componentCount = 0;
+    bool normalized = false;
+};
+
+// bytes of a buffer view covered by used accessors, points into the mapped buffer. accessors of
+// interleaved attributes overlap and share one range
+struct GltfBufferRange {
+    const char* data = nullptr;
+    size_t byteLength = 0;
+};
+
+struct GltfPrimitive {
+    GltfAccessor positions;
+    GltfAccessor normals;
+    // componentCount 0 if the primitive has no TEXCOORD_0
+    GltfAccessor texCoords;
+    GltfAccessor indices;
+    // node hierarchy transform into the space of the scene
+    glm::mat4 worldMatrix = glm::mat4(1.0f);
+    // min / max of the position accessor, before worldMatrix
+    BoundingBox bounds;
+    glm::vec3 baseColor = glm::vec3(1.0f);
+    // relative to GltfScene::directory, empty if the material has no base color texture
+    std::string texturePath;
+};
+
+// cpu side of a .gltf file with external .bin buffers: the json is parsed and the buffers are
+// mapped, but no vertex is touched, the buffer ranges are uploaded to gl as they are
+struct GltfScene {
+    std::string directory;
+    std::vector<MappedFile> buffers;
+    // only these are uploaded, unused attributes (tangents, extra uv sets) stay behind
+    std::vector<GltfBufferRange> ranges;
+    std::vector<GltfPrimitive> primitives;
+    // scene space bounds of all primitives
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// only indexed triangle primitives with normals are loaded, others are skipped with a warning.
+// sparse accessors, embedded (data uri / glb) buffers and extensions are not supported
+GltfScene loadGltfScene(const std::string& path);
+
+// one gl buffer per range shared by all meshes, no deduplication or reordering. every mesh
+// gets a localMatrix which places its node into the unit cube around the origin like the obj
+// loader normalizes its vertices
+Model createModel(const GltfScene& scene);
+
+// textures already in textureCache (keyed by full path) are reused instead of loaded
+Model createModel(const GltfScene& scene, TextureCache& textureCache);
+
+Model loadModelFromGltf(const std::string& path);
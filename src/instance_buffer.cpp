@@ -0,0 +1,48 @@
+#include "instance_buffer.h"
+
+InstanceBuffer::~InstanceBuffer() {
+    if (_vbo != 0) {
+        glDeleteBuffers(1, &_vbo);
+        _vbo = 0;
+    }
+}
+
+void InstanceBuffer::upload(const std::vector<InstanceData>& instances) {
+    if (_vbo == 0) {
+        glGenBuffers(1, &_vbo);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    if (instances.size() > _capacity) {
+        _capacity = instances.size() + instances.size() / 2;
+    }
+    // a fresh store every frame, so the driver does not wait for the draws of the last one
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_capacity * sizeof(InstanceData)), nullptr, GL_STREAM_DRAW);
+    if (!instances.empty()) {
+        glBufferSubData(
+            GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(instances.size() * sizeof(InstanceData)), instances.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::bindAttributes(size_t firstInstance) const {
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    const size_t base = firstInstance * sizeof(InstanceData);
+    for (GLuint column = 0; column < 4; ++column) {
+        const size_t modelOffset = base + offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+        const size_t normalOffset = base + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4);
+
+        glEnableVertexAttribArray(instanceModelLocation + column);
+        glVertexAttribPointer(
+            instanceModelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            reinterpret_cast<void*>(modelOffset));
+        glVertexAttribDivisor(instanceModelLocation + column, 1);
+
+        glEnableVertexAttribArray(instanceNormalMatrixLocation + column);
+        glVertexAttribPointer(
+            instanceNormalMatrixLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            reinterpret_cast<void*>(normalOffset));
+        glVertexAttribDivisor(instanceNormalMatrixLocation + column, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
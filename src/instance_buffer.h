@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+// per instance attributes of the instanced gbuffer draws
+struct InstanceData {
+    glm::mat4 model;
+    // mat3 normal matrix in the upper left, a mat4 keeps the attribute columns aligned
+    glm::mat4 normalMatrix;
+};
+
+// attribute locations in gbuffer.vert, a mat4 takes four of them
+constexpr GLuint instanceModelLocation = 3;
+constexpr GLuint instanceNormalMatrixLocation = 7;
+
+// Vertex buffer with the instances of all instanced draws of a frame. The mesh vaos are
+// shared by every instance group of a model, so the attributes are pointed at the range of
+// a group right before its draw. They stay enabled, gbuffer.vert ignores them unless
+// `instanced` is set and the buffer always holds the instance they point at.
+class InstanceBuffer {
+public:
+    InstanceBuffer() = default;
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    ~InstanceBuffer();
+
+    // replaces the contents, the buffer grows as needed and is orphaned every frame
+    void upload(const std::vector<InstanceData>& instances);
+
+    // sets up the instance attributes of the bound vao, starting at firstInstance
+    void bindAttributes(size_t firstInstance) const;
+
+private:
+    GLuint _vbo = 0;
+    size_t _capacity = 0;
+};
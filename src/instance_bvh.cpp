@@ -0,0 +1,491 @@
+#include "instance_bvh.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "base/thread_pool.h"
+
+namespace {
+
+    constexpr uint32_t invalidIndex = ~0u;
+
+    constexpr int binCount = 16;
+
+    // cost of visiting a node relative to testing one box
+    constexpr float traversalCost = 2.0f;
+
+    // below this depth the builder halves ranges by count, which bounds the depth of the tree
+    // and with it the traversal stacks
+    constexpr int maxSahDepth = 48;
+
+    constexpr int maxStackSize = 96;
+
+    // subtrees of fewer instances are not worth a task of their own
+    constexpr size_t minTaskSize = 1024;
+
+    // marks stack entries of nodes which lie inside the frustum entirely
+    constexpr uint32_t insideFlag = 1u << 31;
+
+    float getHalfArea(const BoundingBox& box) {
+        const glm::vec3 size = box.max - box.min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    float getSquaredDistance(const BoundingBox& box, const glm::vec3& point) {
+        const glm::vec3 closest = glm::clamp(point, box.min, box.max);
+        const glm::vec3 offset = closest - point;
+        return glm::dot(offset, offset);
+    }
+
+    // entry distance of the ray into the box, infinity if it misses it within maxDistance
+    float intersectRay(
+        const BoundingBox& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+        const glm::vec3 t0 = (box.min - origin) * inverseDirection;
+        const glm::vec3 t1 = (box.max - origin) * inverseDirection;
+        const glm::vec3 tNear = glm::min(t0, t1);
+        const glm::vec3 tFar = glm::max(t0, t1);
+        const float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+        const float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+        return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+    }
+
+    // -1 outside of a plane, 1 inside of all of them, 0 crossing one. outside is the test of
+    // Frustum::intersect, so that the tree gives the same result as testing every box
+    int classify(const Frustum& frustum, const BoundingBox& box) {
+        const glm::vec3 center = box.getCenter();
+        const glm::vec3 extent = box.getExtent();
+        int result = 1;
+        for (const Plane& plane : frustum.planes) {
+            const float radius = glm::dot(glm::abs(plane.normal), extent);
+            const float distance = plane.getSignedDistanceToPoint(center);
+            if (distance < -radius) {
+                return -1;
+            }
+            if (distance < radius) {
+                result = 0;
+            }
+        }
+        return result;
+    }
+
+    struct BuildRange {
+        uint32_t node;
+        uint32_t begin;
+        uint32_t end;
+        int depth;
+    };
+
+    // top down binned sah over one index range, writes nodes into its own array
+    class Builder {
+    public:
+        Builder(const std::vector<BoundingBox>& boxes, const std::vector<glm::vec3>& centers, std::vector<uint32_t>& indices)
+            : _boxes(boxes), _centers(centers), _indices(indices) {}
+
+        // splits until the ranges are at most taskSize instances, those are appended to tasks
+        // as leaves to be replaced. taskSize == 0 builds the whole range
+        void build(std::vector<BvhNode>& nodes, BuildRange root, size_t taskSize, std::vector<BuildRange>* tasks) {
+            std::vector<BuildRange> stack = { root };
+            while (!stack.empty()) {
+                const BuildRange range = stack.back();
+                stack.pop_back();
+                BvhNode& node = nodes[range.node];
+                BoundingBox bounds;
+                for (uint32_t i = range.begin; i < range.end; ++i) {
+                    bounds += _boxes[_indices[i]];
+                }
+                node.min = bounds.min;
+                node.max = bounds.max;
+                node.first = range.begin;
+                node.count = range.end - range.begin;
+
+                if (tasks != nullptr && node.count <= taskSize) {
+                    tasks->push_back(range);
+                    continue;
+                }
+                const uint32_t middle = split(range, bounds);
+                if (middle == range.begin) {
+                    continue;
+                }
+
+                // the reference may move when the array grows
+                const uint32_t children = static_cast<uint32_t>(nodes.size());
+                nodes[range.node].first = children;
+                nodes[range.node].count = 0;
+                nodes.resize(nodes.size() + 2);
+                stack.push_back({ children + 1, middle, range.end, range.depth + 1 });
+                stack.push_back({ children, range.begin, middle, range.depth + 1 });
+            }
+        }
+
+    private:
+        const std::vector<BoundingBox>& _boxes;
+        const std::vector<glm::vec3>& _centers;
+        std::vector<uint32_t>& _indices;
+
+        // returns the first index of the right half, begin for a leaf
+        uint32_t split(const BuildRange& range, const BoundingBox& bounds) {
+            const uint32_t count = range.end - range.begin;
+            if (count <= 1) {
+                return range.begin;
+            }
+            uint32_t* first = _indices.data() + range.begin;
+            uint32_t* last = _indices.data() + range.end;
+
+            BoundingBox centerBounds;
+            for (const uint32_t* it = first; it != last; ++it) {
+                centerBounds += _centers[*it];
+            }
+            const glm::vec3 centerExtent = centerBounds.max - centerBounds.min;
+
+            const auto splitByCount = [&]() {
+                if (count <= InstanceBvh::maxLeafSize) {
+                    return range.begin;
+                }
+                const int axis = centerExtent.x > centerExtent.y
+                                     ? (centerExtent.x > centerExtent.z ? 0 : 2)
+                                     : (centerExtent.y > centerExtent.z ? 1 : 2);
+                uint32_t* middle = first + count / 2;
+                std::nth_element(first, middle, last, [this, axis](uint32_t a, uint32_t b) {
+                    return _centers[a][axis] < _centers[b][axis];
+                    });
+                return range.begin + count / 2;
+                };
+            if (range.depth >= maxSahDepth) {
+                return splitByCount();
+            }
+
+            float bestCost = std::numeric_limits<float>::infinity();
+            int bestAxis = -1;
+            int bestBin = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                if (centerExtent[axis] <= 0.0f) {
+                    continue;
+                }
+                BoundingBox binBounds[binCount];
+                uint32_t binCounts[binCount] = {};
+                const float scale = static_cast<float>(binCount) / centerExtent[axis];
+                for (const uint32_t* it = first; it != last; ++it) {
+                    const int bin = std::min(binCount - 1, static_cast<int>((_centers[*it][axis] - centerBounds.min[axis]) * scale));
+                    ++binCounts[bin];
+                    binBounds[bin] += _boxes[*it];
+                }
+
+                // cost of putting bins [0, i) to the left, the sweep from the right adds the rest
+                float leftCosts[binCount] = {};
+                BoundingBox left;
+                uint32_t leftCount = 0;
+                for (int i = 1; i < binCount; ++i) {
+                    left += binBounds[i - 1];
+                    leftCount += binCounts[i - 1];
+                    leftCosts[i] = leftCount != 0 ? getHalfArea(left) * static_cast<float>(leftCount) : 0.0f;
+                }
+                BoundingBox right;
+                uint32_t rightCount = 0;
+                for (int i = binCount - 1; i >= 1; --i) {
+                    right += binBounds[i];
+                    rightCount += binCounts[i];
+                    if (rightCount == 0 || rightCount == count) {
+                        continue;
+                    }
+                    const float cost = leftCosts[i] + getHalfArea(right) * static_cast<float>(rightCount);
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = i;
+                    }
+                }
+            }
+
+            if (bestAxis < 0) {
+                // all centers in one spot
+                return splitByCount();
+            }
+            const float area = getHalfArea(bounds);
+            const float splitCost = traversalCost * area + bestCost;
+            const float leafCost = static_cast<float>(count) * area;
+            if (count <= InstanceBvh::maxLeafSize && leafCost <= splitCost) {
+                return range.begin;
+            }
+
+            const float scale = static_cast<float>(binCount) / centerExtent[bestAxis];
+            const float minCenter = centerBounds.min[bestAxis];
+            uint32_t* middle = std::partition(first, last, [&](uint32_t index) {
+                return std::min(binCount - 1, static_cast<int>((_centers[index][bestAxis] - minCenter) * scale)) < bestBin;
+                });
+            if (middle == first || middle == last) {
+                return splitByCount();
+            }
+            return range.begin + static_cast<uint32_t>(middle - first);
+        }
+    };
+
+} // namespace
+
+void InstanceBvh::build(const std::vector<BoundingBox>& boxes, size_t maxThreads) {
+    _boxes = boxes;
+    _maxThreads = maxThreads;
+    _rebuild = false;
+    _nodes.clear();
+    _indices.clear();
+    _unbounded.clear();
+    _dirtyNodes.clear();
+    _leaves.assign(_boxes.size(), invalidIndex);
+
+    std::vector<glm::vec3> centers(_boxes.size());
+    for (uint32_t i = 0; i < _boxes.size(); ++i) {
+        if (_boxes[i].isEmpty()) {
+            _unbounded.push_back(i);
+        }
+        else {
+            _indices.push_back(i);
+            centers[i] = _boxes[i].getCenter();
+        }
+    }
+    if (_indices.empty()) {
+        _parents.clear();
+        _dirty.clear();
+        return;
+    }
+
+    // the first levels on this thread, enough subtrees below them to keep the pool busy
+    ThreadPool& pool = ThreadPool::getGlobal();
+    size_t threads = pool.getThreadCount() + 1;
+    if (maxThreads != 0) {
+        threads = std::min(threads, maxThreads);
+    }
+    const size_t taskSize = threads > 1 ? std::max(minTaskSize, _indices.size() / (threads * 4)) : _indices.size();
+
+    Builder builder(_boxes, centers, _indices);
+    std::vector<BuildRange> tasks;
+    _nodes.resize(1);
+    builder.build(_nodes, { 0, 0, static_cast<uint32_t>(_indices.size()), 0 }, taskSize, &tasks);
+
+    // every subtree gets its own array, its root replaces the leaf left by the first levels
+    std::vector<std::vector<BvhNode>> subtrees(tasks.size());
+    pool.parallelFor(tasks.size(), [&](size_t i) {
+        subtrees[i].resize(1);
+        builder.build(subtrees[i], { 0, tasks[i].begin, tasks[i].end, tasks[i].depth }, 0, nullptr);
+        }, maxThreads);
+
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        // local node n > 0 ends up at offset + n - 1
+        const uint32_t offset = static_cast<uint32_t>(_nodes.size());
+        const auto remap = [offset](BvhNode node) {
+            if (node.count == 0) {
+                node.first += offset - 1;
+            }
+            return node;
+            };
+        _nodes[tasks[i].node] = remap(subtrees[i][0]);
+        for (size_t n = 1; n < subtrees[i].size(); ++n) {
+            _nodes.push_back(remap(subtrees[i][n]));
+        }
+    }
+
+    _parents.assign(_nodes.size(), invalidIndex);
+    _dirty.assign(_nodes.size(), 0);
+    for (uint32_t n = 0; n < _nodes.size(); ++n) {
+        const BvhNode& node = _nodes[n];
+        if (node.count == 0) {
+            _parents[node.first] = n;
+            _parents[node.first + 1] = n;
+        }
+        else {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                _leaves[_indices[i]] = n;
+            }
+        }
+    }
+}
+
+void InstanceBvh::clear() {
+    _boxes.clear();
+    _nodes.clear();
+    _indices.clear();
+    _unbounded.clear();
+    _leaves.clear();
+    _parents.clear();
+    _dirtyNodes.clear();
+    _dirty.clear();
+    _rebuild = false;
+}
+
+size_t InstanceBvh::size() const {
+    return _boxes.size();
+}
+
+void InstanceBvh::update(uint32_t index, const BoundingBox& box) {
+    const bool wasEmpty = _boxes[index].isEmpty();
+    _boxes[index] = box;
+    if (wasEmpty != box.isEmpty()) {
+        _rebuild = true;
+    }
+    if (_rebuild || wasEmpty) {
+        return;
+    }
+    for (uint32_t node = _leaves[index]; node != invalidIndex && !_dirty[node]; node = _parents[node]) {
+        _dirty[node] = 1;
+        _dirtyNodes.push_back(node);
+    }
+}
+
+void InstanceBvh::refit() {
+    if (_rebuild) {
+        build(_boxes, _maxThreads);
+        return;
+    }
+
+    // children come after their parents
+    std::sort(_dirtyNodes.begin(), _dirtyNodes.end(), std::greater<uint32_t>());
+    for (uint32_t n : _dirtyNodes) {
+        BvhNode& node = _nodes[n];
+        BoundingBox bounds;
+        if (node.count == 0) {
+            const BvhNode& left = _nodes[node.first];
+            const BvhNode& right = _nodes[node.first + 1];
+            bounds.min = glm::min(left.min, right.min);
+            bounds.max = glm::max(left.max, right.max);
+        }
+        else {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                bounds += _boxes[_indices[i]];
+            }
+        }
+        node.min = bounds.min;
+        node.max = bounds.max;
+        _dirty[n] = 0;
+    }
+    _dirtyNodes.clear();
+}
+
+void InstanceBvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& result) const {
+    result.insert(result.end(), _unbounded.begin(), _unbounded.end());
+    if (_nodes.empty()) {
+        return;
+    }
+
+    uint32_t stack[maxStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const uint32_t entry = stack[--top];
+        const BvhNode& node = _nodes[entry & ~insideFlag];
+        bool inside = (entry & insideFlag) != 0;
+        if (!inside) {
+            BoundingBox bounds;
+            bounds.min = node.min;
+            bounds.max = node.max;
+            const int classification = classify(frustum, bounds);
+            if (classification < 0) {
+                continue;
+            }
+            inside = classification > 0;
+        }
+
+        if (node.count == 0) {
+            const uint32_t flag = inside ? insideFlag : 0u;
+            stack[top++] = (node.first + 1) | flag;
+            stack[top++] = node.first | flag;
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            const uint32_t index = _indices[i];
+            if (inside || frustum.intersect(_boxes[index])) {
+                result.push_back(index);
+            }
+        }
+    }
+}
+
+void InstanceBvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const {
+    if (_nodes.empty()) {
+        return;
+    }
+
+    const float squaredRadius = radius * radius;
+    uint32_t stack[maxStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BvhNode& node = _nodes[stack[--top]];
+        BoundingBox bounds;
+        bounds.min = node.min;
+        bounds.max = node.max;
+        if (getSquaredDistance(bounds, center) >= squaredRadius) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            if (getSquaredDistance(_boxes[_indices[i]], center) < squaredRadius) {
+                result.push_back(_indices[i]);
+            }
+        }
+    }
+}
+
+bool InstanceBvh::raycast(
+    const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& hit) const {
+    if (_nodes.empty()) {
+        return false;
+    }
+
+    // divisions by zero give infinities, which the slab test handles
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    float nearest = maxDistance;
+    bool found = false;
+
+    auto getEntry = [&](const BvhNode& node) {
+        BoundingBox bounds;
+        bounds.min = node.min;
+        bounds.max = node.max;
+        return intersectRay(bounds, origin, inverseDirection, nearest);
+        };
+
+    uint32_t stack[maxStackSize];
+    int top = 0;
+    if (getEntry(_nodes[0]) <= nearest) {
+        stack[top++] = 0;
+    }
+    while (top > 0) {
+        const BvhNode& node = _nodes[stack[--top]];
+        if (node.count == 0) {
+            // the nearer child is visited first, the other one is skipped if a hit came closer
+            // than its entry in the meantime
+            const float leftEntry = getEntry(_nodes[node.first]);
+            const float rightEntry = getEntry(_nodes[node.first + 1]);
+            const bool leftFirst = leftEntry <= rightEntry;
+            const float farEntry = leftFirst ? rightEntry : leftEntry;
+            const float nearEntry = leftFirst ? leftEntry : rightEntry;
+            if (farEntry <= nearest) {
+                stack[top++] = leftFirst ? node.first + 1 : node.first;
+            }
+            if (nearEntry <= nearest) {
+                stack[top++] = leftFirst ? node.first : node.first + 1;
+            }
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            const float distance = intersectRay(_boxes[_indices[i]], origin, inverseDirection, nearest);
+            if (distance <= nearest && (!found || distance < nearest || _indices[i] < hit.index)) {
+                nearest = distance;
+                hit.index = _indices[i];
+                hit.distance = distance;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+const std::vector<BvhNode>& InstanceBvh::getNodes() const {
+    return _nodes;
+}
+
+const BoundingBox& InstanceBvh::getBounds(uint32_t index) const {
+    return _boxes[index];
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/bounding_box.h"
+#include "base/frustum.h"
+
+// 32 bytes, two per cache line. Interior nodes have their two children next to each other at
+// first and first + 1, leaves own count entries of the index array from first on
+struct BvhNode {
+    glm::vec3 min;
+    uint32_t first = 0;
+    glm::vec3 max;
+    // 0 for interior nodes
+    uint32_t count = 0;
+};
+
+struct BvhRayHit {
+    uint32_t index = 0;
+    float distance = 0.0f;
+};
+
+// Bounding volume hierarchy over the world space boxes of many instances, flattened into one
+// array of nodes in which children always come after their parent.
+//
+// Built top down with binned SAH, the subtrees below the first levels are built on the global
+// thread pool. Boxes which move are refitted: update() marks the path up to the root, refit()
+// recomputes the marked nodes children first, the structure stays the same and slowly loses
+// quality as the boxes drift apart. Empty boxes are unbounded: they are kept out of the tree,
+// pass every frustum and are never hit by spheres and rays. A box becoming empty or bounded
+// rebuilds the tree on the next refit.
+class InstanceBvh {
+public:
+    static constexpr size_t maxLeafSize = 4;
+
+    // maxThreads == 0 uses the whole global pool
+    void build(const std::vector<BoundingBox>& boxes, size_t maxThreads = 0);
+
+    void clear();
+
+    // number of instances
+    size_t size() const;
+
+    void update(uint32_t index, const BoundingBox& box);
+
+    // applies the updates since the last refit or build
+    void refit();
+
+    // appends the instances whose box passes Frustum::intersect, in no particular order
+    void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& result) const;
+
+    // appends the instances whose box is closer than radius to center
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const;
+
+    // nearest box along the ray within maxDistance, direction needs not be normalized, the
+    // distance is in units of its length
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& hit) const;
+
+    const std::vector<BvhNode>& getNodes() const;
+
+    const BoundingBox& getBounds(uint32_t index) const;
+
+private:
+    std::vector<BoundingBox> _boxes;
+    std::vector<BvhNode> _nodes;
+    // instance indices, grouped by leaf
+    std::vector<uint32_t> _indices;
+    std::vector<uint32_t> _unbounded;
+    // per instance its leaf, per node its parent. ~0u for unbounded instances and the root
+    std::vector<uint32_t> _leaves;
+    std::vector<uint32_t> _parents;
+    std::vector<uint32_t> _dirtyNodes;
+    std::vector<uint8_t> _dirty;
+    bool _rebuild = false;
+    size_t _maxThreads = 0;
+};
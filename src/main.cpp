@@ -1,4 +1,5 @@
 #include "maze_app.h"
+#include "base/asset_pack.h"
 #include <iostream>
 #include <filesystem>
 #ifdef _WIN32
@@ -52,6 +53,11 @@ Options getOptions(int argc, char* argv[]) {
 int main(int argc, char* argv[]) {
     Options options = getOptions(argc, argv);
 
+    // one mapped file written by tools/asset_packer, loose files are the fallback in development
+    if (!AssetPack::mount(options.assetRootDir + "assets.pack", options.assetRootDir)) {
+        std::cout << "No asset pack, loading loose files from " << options.assetRootDir << std::endl;
+    }
+
     try {
         MazeApp app(options);
         app.run();
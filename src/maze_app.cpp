@@ -1,5 +1,6 @@
 ﻿#include "maze_app.h"
 
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 #include <string>
@@ -15,6 +16,8 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include "asset_registry.h"
+
 void printCwd() {
     char buf[1024];
     if (getcwd(buf, sizeof(buf)) != nullptr) {
@@ -33,6 +36,20 @@ static const std::string ssaoBlurFs = "shaders/ssao_blur.frag";
 static const std::string lightFs = "shaders/lightening.frag";
 static const std::string hdrFs = "shaders/hdr_quad.frag";
 
+// scene models sharing a model are drawn instanced from this many on
+static const size_t minInstanceCount = 2;
+
+// the instance attributes replace the model matrix, meshes with a transform of their own
+// below the model (gltf node hierarchies) are drawn one by one
+static bool isInstanceable(const Model& model) {
+    for (const Mesh& mesh : model.getMeshes()) {
+        if (mesh.localMatrix != glm::mat4(1.0f)) {
+            return false;
+        }
+    }
+    return !model.getMeshes().empty();
+}
+
 void MazeApp::initResources() {
     printCwd();
     try {
@@ -207,6 +224,446 @@ void MazeApp::createSSAOBuffer() {
     _ssaoShader->setUniformVec2("noiseScale", glm::vec2((float)_windowWidth / 4.0f, (float)_windowHeight / 4.0f));
 }
 
+void MazeApp::cullSceneModels(const Frustum& frustum) {
+    if (_sceneBounds.size() != _sceneModels.size()) {
+        _sceneBounds.clear();
+        _sceneBounds.reserve(_sceneModels.size());
+        for (SceneModel& sm : _sceneModels) {
+            sm.boundsModel = nullptr;
+            _sceneBounds.add(BoundingBox());
+        }
+        _sceneBvh.build(std::vector<BoundingBox>(_sceneModels.size()));
+    }
+
+    size_t liveModels = 0;
+    for (size_t i = 0; i < _sceneModels.size(); ++i) {
+        SceneModel& sm = _sceneModels[i];
+        if (!sm.asset || sm.asset->failed || isBatched(sm)) continue;
+        ++liveModels;
+        const Model& sceneModel = sm.asset->model ? *sm.asset->model : *_placeholderModel;
+        if (sm.boundsModel != &sceneModel) {
+            // models without vertices have no bounds and are never culled
+            const BoundingBox bounds = transformBoundingBox(sceneModel.getBounds(), sm.transform.getLocalMatrix());
+            _sceneBounds.set(static_cast<uint32_t>(i), bounds);
+            _sceneBvh.update(static_cast<uint32_t>(i), bounds);
+            sm.boundsModel = &sceneModel;
+        }
+    }
+    // streamed models replacing their placeholder only refit the tree
+    _sceneBvh.refit();
+
+    if (_frustumCulling && _sceneModels.size() >= _bvhCullingThreshold) {
+        _visibleIndices.clear();
+        _sceneBvh.queryFrustum(frustum, _visibleIndices);
+        // the order of the scan, which the draws are grouped by
+        std::sort(_visibleIndices.begin(), _visibleIndices.end());
+    }
+    else if (_frustumCulling) {
+        cullInstances(frustum, _sceneBounds, _visibleIndices);
+    }
+    else {
+        _visibleIndices.resize(_sceneModels.size());
+        for (size_t i = 0; i < _visibleIndices.size(); ++i) {
+            _visibleIndices[i] = static_cast<uint32_t>(i);
+        }
+    }
+
+    const glm::ivec2 pvsCell = getPvsCell();
+    _pvsCulled = 0;
+    size_t candidates = 0;
+    for (uint32_t index : _visibleIndices) {
+        const SceneModel& sm = _sceneModels[index];
+        if (!sm.asset || sm.asset->failed || isBatched(sm)) continue;
+        if (pvsCell.x >= 0 && !isInPvs(pvsCell, _sceneBounds.get(index))) {
+            ++_pvsCulled;
+            continue;
+        }
+        _visibleIndices[candidates++] = index;
+    }
+    _visibleIndices.resize(candidates);
+
+    if (_occlusionCulling) {
+        _occlusionBuffer.cullOccluded(_visibleIndices, [this](uint32_t index) { return _sceneBounds.get(index); });
+    }
+
+    _visibleModels.clear();
+    for (uint32_t index : _visibleIndices) {
+        _visibleModels.push_back(&_sceneModels[index]);
+    }
+    _culledModels = liveModels - _visibleModels.size();
+}
+
+void MazeApp::renderOccluders(const Frustum& frustum, const glm::mat4& viewProjection) {
+    _occluders.clear();
+    if (!_occlusionCulling) {
+        return;
+    }
+
+    _occluderCandidates.clear();
+    for (size_t i = 0; i < _sceneModels.size(); ++i) {
+        const SceneModel& sm = _sceneModels[i];
+        if (!sm.isWall) continue;
+        BoundingBox box;
+        box.min = sm.aabb.min;
+        box.max = sm.aabb.max;
+        if (frustum.intersect(box)) {
+            _occluderCandidates.emplace_back(glm::length(box.getCenter() - _camera.transform.position), i);
+        }
+    }
+
+    const size_t count = std::min(_occluderCount, _occluderCandidates.size());
+    std::nth_element(
+        _occluderCandidates.begin(), _occluderCandidates.begin() + count, _occluderCandidates.end());
+    for (size_t i = 0; i < count; ++i) {
+        const AABB& aabb = _sceneModels[_occluderCandidates[i].second].aabb;
+        const glm::vec3 center = 0.5f * (aabb.min + aabb.max);
+        const glm::vec3 extent = 0.5f * _occluderScale * (aabb.max - aabb.min);
+        BoundingBox occluder;
+        occluder.min = center - extent;
+        occluder.max = center + extent;
+        _occluders.push_back(occluder);
+    }
+    _occlusionBuffer.render(_occluders, viewProjection);
+}
+
+void MazeApp::queueSceneModel(const SceneModel& sm, const Frustum& frustum) {
+    const Model& sceneModel = sm.asset->model ? *sm.asset->model : *_placeholderModel;
+
+    // models are normalized into the unit cube around their origin
+    const glm::vec3& scale = sm.transform.scale;
+    const float objectScale = glm::max(scale.x, glm::max(scale.y, scale.z));
+    const float boundingRadius = 0.5f * glm::sqrt(3.0f) * objectScale;
+    const float distance = glm::length(sm.transform.position - _camera.transform.position) - boundingRadius;
+    // normal cones are not preserved by non uniform scaling
+    const bool coneCulling = glm::min(scale.x, glm::min(scale.y, scale.z)) >= 0.999f * objectScale;
+
+    glm::mat4 model = sm.transform.getLocalMatrix();
+    glm::mat3 normalMat = glm::transpose(glm::inverse(glm::mat3(model)));
+    const glm::vec3 eye = glm::vec3(glm::inverse(model) * glm::vec4(_camera.transform.position, 1.0f));
+
+    for (const Mesh& mesh : sceneModel.getMeshes()) {
+        DrawCommand command;
+        command.vao = mesh.vao;
+        command.texture = mesh.diffuseTexture != nullptr ? mesh.diffuseTexture->getHandle() : 0;
+        command.indexType = mesh.indexType;
+        command.color = mesh.baseColor * sm.fallbackColor;
+        command.compactVertex = mesh.vertexFormat == VertexFormat::Compact;
+        command.flipTexCoordY = mesh.flipTexCoordY;
+        command.model = model;
+        command.normalMatrix = normalMat;
+
+        // meshes of a node hierarchy (gltf) carry their own transform below the model
+        if (mesh.localMatrix != glm::mat4(1.0f)) {
+            command.model = model * mesh.localMatrix;
+            command.normalMatrix = glm::transpose(glm::inverse(glm::mat3(command.model)));
+        }
+
+        GLsizei indexCount = static_cast<GLsizei>(mesh.indexCount);
+        size_t indexOffset = 0;
+        const size_t level = mesh.lods.empty() ? 0 : selectLod(mesh, objectScale, distance);
+        if (!mesh.lods.empty()) {
+            indexCount = static_cast<GLsizei>(mesh.lods[level].indexCount);
+            indexOffset = mesh.lods[level].indexOffset;
+        }
+
+        if (level == 0 && _meshletCulling && !mesh.meshlets.empty()) {
+            cullMeshlets(mesh, model, objectScale, frustum, eye, coneCulling);
+            if (_drawCounts.empty()) {
+                continue;
+            }
+            command.type = DrawType::MultiElements;
+            command.indexType = GL_UNSIGNED_INT;
+            command.firstRange = _renderQueue.addRanges(_drawCounts, _drawOffsets);
+            command.rangeCount = _drawCounts.size();
+        }
+        else {
+            _drawnTriangles += indexCount / 3;
+            command.indexCount = indexCount;
+            command.indexByteOffset = mesh.indexByteOffset + indexOffset * sizeof(uint32_t);
+        }
+        queueDraw(command, distance);
+    }
+}
+
+void MazeApp::buildInstanceGroups() {
+    _singleModels.clear();
+    _instanceGroups.clear();
+    _instances.clear();
+    if (!_instancing) {
+        _singleModels = _visibleModels;
+        return;
+    }
+
+    std::vector<std::vector<const SceneModel*>> members;
+    for (const SceneModel* sm : _visibleModels) {
+        const Model& sceneModel = sm->asset->model ? *sm->asset->model : *_placeholderModel;
+        if (!isInstanceable(sceneModel)) {
+            _singleModels.push_back(sm);
+            continue;
+        }
+
+        size_t index = 0;
+        while (index < _instanceGroups.size()
+               && (_instanceGroups[index].model != &sceneModel || _instanceGroups[index].fallbackColor != sm->fallbackColor)) {
+            ++index;
+        }
+        if (index == _instanceGroups.size()) {
+            InstanceGroup group;
+            group.model = &sceneModel;
+            group.fallbackColor = sm->fallbackColor;
+            group.distance = std::numeric_limits<float>::max();
+            _instanceGroups.push_back(group);
+            members.emplace_back();
+        }
+        members[index].push_back(sm);
+    }
+
+    // single instances keep the per model path with lods and meshlet culling of their own
+    size_t kept = 0;
+    for (size_t i = 0; i < _instanceGroups.size(); ++i) {
+        if (members[i].size() < minInstanceCount) {
+            _singleModels.insert(_singleModels.end(), members[i].begin(), members[i].end());
+            continue;
+        }
+
+        InstanceGroup group = _instanceGroups[i];
+        group.firstInstance = _instances.size();
+        group.instanceCount = members[i].size();
+        for (const SceneModel* sm : members[i]) {
+            // models are normalized into the unit cube around their origin
+            const glm::vec3& scale = sm->transform.scale;
+            const float objectScale = glm::max(scale.x, glm::max(scale.y, scale.z));
+            const float boundingRadius = 0.5f * glm::sqrt(3.0f) * objectScale;
+            const float distance = glm::length(sm->transform.position - _camera.transform.position) - boundingRadius;
+            // the nearest / largest instance needs the finest lod, the group shares it
+            group.objectScale = glm::max(group.objectScale, objectScale);
+            group.distance = glm::min(group.distance, distance);
+
+            InstanceData instance;
+            instance.model = sm->transform.getLocalMatrix();
+            instance.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(instance.model))));
+            _instances.push_back(instance);
+        }
+        _instanceGroups[kept++] = group;
+    }
+    _instanceGroups.resize(kept);
+
+    if (!_instances.empty()) {
+        _instanceBuffer.upload(_instances);
+    }
+}
+
+void MazeApp::queueInstanceGroup(const InstanceGroup& group) {
+    for (const Mesh& mesh : group.model->getMeshes()) {
+        DrawCommand command;
+        command.type = DrawType::Instanced;
+        command.vao = mesh.vao;
+        command.texture = mesh.diffuseTexture != nullptr ? mesh.diffuseTexture->getHandle() : 0;
+        command.indexType = mesh.indexType;
+        command.color = mesh.baseColor * group.fallbackColor;
+        command.compactVertex = mesh.vertexFormat == VertexFormat::Compact;
+        command.flipTexCoordY = mesh.flipTexCoordY;
+        command.firstInstance = group.firstInstance;
+        command.instanceCount = group.instanceCount;
+
+        // meshlets are culled per instance, instanced draws take the whole level
+        GLsizei indexCount = static_cast<GLsizei>(mesh.indexCount);
+        size_t indexOffset = 0;
+        if (!mesh.lods.empty()) {
+            const size_t level = selectLod(mesh, group.objectScale, group.distance);
+            indexCount = static_cast<GLsizei>(mesh.lods[level].indexCount);
+            indexOffset = mesh.lods[level].indexOffset;
+        }
+        command.indexCount = indexCount;
+        command.indexByteOffset = mesh.indexByteOffset + indexOffset * sizeof(uint32_t);
+        _drawnTriangles += indexCount / 3 * group.instanceCount;
+        queueDraw(command, group.distance);
+    }
+}
+
+void MazeApp::buildStaticGeometry() {
+    std::vector<StaticBatchInput> inputs;
+    std::vector<SceneModel*> batchedModels;
+    size_t sourceBytes = 0;
+    std::vector<const Model*> sourceModels;
+    for (SceneModel& sm : _sceneModels) {
+        if (!sm.isStatic || !sm.asset || sm.asset->failed) continue;
+        // waits for the streamer, the placeholder is not worth a batch
+        if (!sm.asset->model) return;
+
+        const Model& sceneModel = *sm.asset->model;
+        const auto& meshes = sceneModel.getMeshes();
+        if (!std::all_of(meshes.begin(), meshes.end(), [](const Mesh& mesh) { return isStaticBatchable(mesh); })) {
+            continue;
+        }
+        const glm::mat4 model = sm.transform.getLocalMatrix();
+        for (const Mesh& mesh : meshes) {
+            inputs.push_back({ &mesh, model, sm.fallbackColor });
+        }
+        if (std::find(sourceModels.begin(), sourceModels.end(), &sceneModel) == sourceModels.end()) {
+            sourceModels.push_back(&sceneModel);
+            sourceBytes += sceneModel.getByteSize();
+        }
+        batchedModels.push_back(&sm);
+    }
+    _staticGeometryBuilt = true;
+    if (inputs.empty()) {
+        return;
+    }
+
+    // only the configured chunk size is built and uploaded, the others are opt-in since every
+    // build reads the meshes back from the gpu. the source meshes are shared by the instanced
+    // path and stay resident next to the batches
+    std::cout << "Static batching: " << batchedModels.size() << " models, " << inputs.size()
+              << " meshes drawn one by one, " << sourceBytes / 1024 << " KiB shared source buffers" << std::endl;
+    std::vector<float> chunkSizes = { _staticChunkSize };
+    if (_compareStaticChunkSizes) {
+        chunkSizes = { 0.0f, 4.0f * _staticChunkSize, 2.0f * _staticChunkSize, _staticChunkSize };
+    }
+    for (float chunkSize : chunkSizes) {
+        const std::vector<StaticBatchData> batches = buildStaticBatches(inputs, chunkSize);
+        size_t bytes = 0;
+        for (const StaticBatchData& batch : batches) {
+            bytes += batch.vertices.size() * sizeof(Vertex) + batch.indices.size() * sizeof(uint32_t);
+        }
+        std::cout << "  -> chunk " << (chunkSize > 0.0f ? std::to_string(static_cast<int>(chunkSize)) : "all")
+                  << ": " << batches.size() << " draws (" << inputs.size() - batches.size() << " saved), "
+                  << bytes / 1024 << " KiB" << std::endl;
+        if (chunkSize == _staticChunkSize) {
+            _staticGeometry.upload(batches);
+        }
+    }
+
+    for (SceneModel* sm : batchedModels) {
+        sm->batched = true;
+    }
+}
+
+void MazeApp::queueStaticGeometry(const Frustum& frustum) {
+    _visibleBatches = 0;
+    if (!_staticBatching) {
+        return;
+    }
+
+    const glm::ivec2 pvsCell = getPvsCell();
+    const std::vector<StaticBatch>& batches = _staticGeometry.getBatches();
+    _visibleBatchIndices.clear();
+    for (size_t i = 0; i < batches.size(); ++i) {
+        if (_frustumCulling && !frustum.intersect(batches[i].bounds)) {
+            continue;
+        }
+        if (pvsCell.x >= 0 && !isInPvs(pvsCell, batches[i].bounds)) {
+            ++_pvsCulled;
+            continue;
+        }
+        _visibleBatchIndices.push_back(static_cast<uint32_t>(i));
+    }
+    if (_occlusionCulling) {
+        _occlusionBuffer.cullOccluded(_visibleBatchIndices, [&batches](uint32_t index) { return batches[index].bounds; });
+    }
+
+    for (uint32_t index : _visibleBatchIndices) {
+        const StaticBatch& batch = batches[index];
+        ++_visibleBatches;
+
+        // the batches are in world space already, the command keeps the identity model matrix
+        DrawCommand command;
+        command.vao = batch.vao;
+        command.texture = batch.texture != nullptr ? batch.texture->getHandle() : 0;
+        command.indexCount = static_cast<GLsizei>(batch.indexCount);
+        command.color = batch.color;
+        _drawnTriangles += batch.indexCount / 3;
+
+        const glm::vec3 toCamera = glm::abs(_camera.transform.position - batch.bounds.getCenter());
+        const float distance = glm::length(glm::max(toCamera - batch.bounds.getExtent(), glm::vec3(0.0f)));
+        queueDraw(command, distance);
+    }
+}
+
+void MazeApp::queueDraw(const DrawCommand& command, float distance) {
+    // everything here is the opaque gbuffer pass of one program
+    const uint64_t key = RenderQueue::makeSortKey(
+        0, 0, _renderQueue.getTextureIndex(command.texture), _renderQueue.getVaoIndex(command.vao),
+        RenderQueue::getDepthBucket(distance, _camera.zfar));
+    _renderQueue.push(key, command);
+}
+
+glm::ivec2 MazeApp::getMazeCell(const glm::vec3& position) const {
+    return glm::ivec2(glm::floor((glm::vec2(position.x, position.z) - _mazeOrigin) / _mazeCellSize + 0.5f));
+}
+
+glm::ivec2 MazeApp::getPvsCell() const {
+    // the sets only hold below the top of the walls, above them the whole maze can be seen
+    const glm::ivec2 cell = getMazeCell(_camera.transform.position);
+    if (!_pvsCulling || _camera.transform.position.y >= _mazeWallTop || !_mazePvs.hasSet(cell.x, cell.y)) {
+        return glm::ivec2(-1);
+    }
+    return cell;
+}
+
+bool MazeApp::isInPvs(const glm::ivec2& cell, const BoundingBox& bounds) const {
+    // unbounded models stay visible, the clamp keeps huge bounds from overflowing the cast
+    const glm::vec2 limit(static_cast<float>(_mazePvs.getColumnCount()), static_cast<float>(_mazePvs.getRowCount()));
+    const glm::vec2 min = glm::clamp(
+        (glm::vec2(bounds.min.x, bounds.min.z) - _mazeOrigin) / _mazeCellSize + 0.5f, glm::vec2(-1.0f), limit);
+    const glm::vec2 max = glm::clamp(
+        (glm::vec2(bounds.max.x, bounds.max.z) - _mazeOrigin) / _mazeCellSize + 0.5f, glm::vec2(-1.0f), limit);
+    const glm::ivec2 minCell(glm::floor(min));
+    const glm::ivec2 maxCell(glm::floor(max));
+    if (minCell.x < 0 || minCell.y < 0 || maxCell.x >= _mazePvs.getColumnCount()
+        || maxCell.y >= _mazePvs.getRowCount()) {
+        return true;
+    }
+    return _mazePvs.isAnyVisible(cell.x, cell.y, minCell.x, minCell.y, maxCell.x, maxCell.y);
+}
+
+size_t MazeApp::selectLod(const Mesh& mesh, float objectScale, float distance) const {
+    // pixels covered by one world unit at the given distance
+    const float pixelsPerUnit = static_cast<float>(_windowHeight) / (2.0f * glm::tan(0.5f * _camera.fovy));
+    const float screenScale = objectScale * pixelsPerUnit / glm::max(distance, _camera.znear);
+    const float threshold = glm::exp2(_lodBias);
+
+    size_t level = 0;
+    while (level + 1 < mesh.lods.size() && mesh.lods[level + 1].error * screenScale <= threshold) {
+        ++level;
+    }
+    return level;
+}
+
+void MazeApp::cullMeshlets(
+    const Mesh& mesh, const glm::mat4& model, float objectScale, const Frustum& frustum,
+    const glm::vec3& eye, bool coneCulling) {
+    _drawCounts.clear();
+    _drawOffsets.clear();
+
+    uint32_t rangeEnd = 0;
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        ++_totalMeshlets;
+
+        const glm::vec3 center = glm::vec3(model * glm::vec4(meshlet.center, 1.0f));
+        if (!isSphereInFrustum(frustum, center, meshlet.radius * objectScale)) {
+            continue;
+        }
+        if (coneCulling && isMeshletBackFacing(meshlet, eye)) {
+            continue;
+        }
+
+        ++_visibleMeshlets;
+        _drawnTriangles += meshlet.indexCount / 3;
+
+        // consecutive visible meshlets are drawn as one range
+        if (!_drawCounts.empty() && rangeEnd == meshlet.indexOffset) {
+            _drawCounts.back() += static_cast<GLsizei>(meshlet.indexCount);
+        }
+        else {
+            _drawCounts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+            _drawOffsets.push_back(
+                reinterpret_cast<const void*>(mesh.indexByteOffset + size_t(meshlet.indexOffset) * sizeof(uint32_t)));
+        }
+        rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+    }
+}
+
 void MazeApp::updateCamera(float deltaTime) {
     // 1️⃣ 获取鼠标当前位置
     double xpos, ypos;
@@ -257,21 +714,17 @@ void MazeApp::updateCamera(float deltaTime) {
 
     if (glm::length(dir) > 0.0f) dir = glm::normalize(dir);
 
-    glm::vec3 proposedPos = _camera.transform.position + dir * _moveSpeed * deltaTime;
     float playerRadius = 0.2f; // 玩家碰撞半径，可调
 
-    // 遍历所有墙壁 AABB
-    for (const auto& sm : _sceneModels) {
-        if (sm.isWall) {
-            if (sm.aabb.intersects(proposedPos, playerRadius)) {
-                dir = glm::vec3(0.0f); // 碰撞 → 阻止移动
-                break;
-            }
-        }
-    }
+    // 沿墙滑动，而不是碰到墙就停下
+    _movers.resize(1);
+    _movers[0].position = _camera.transform.position;
+    _movers[0].displacement = dir * _moveSpeed * deltaTime;
+    _movers[0].radius = playerRadius;
+    _collisionSolver.move(_wallGrid, _movers);
 
     // 最终移动
-    _camera.move(dir * _moveSpeed * deltaTime);
+    _camera.transform.position = _movers[0].position;
 
 }
 
@@ -332,26 +785,33 @@ MazeApp::MazeApp(const Options& options)
     _shader->attachVertexShader(vsCode);
     _shader->attachFragmentShader(fsCode);
     _shader->link();
+    markStartupPhase("forward shader");
 
 
     //init
     initResources();
+    markStartupPhase("deferred shaders");
     createGBuffer();
+    markStartupPhase("gbuffer");
     createSSAOBuffer();
+    markStartupPhase("ssao buffer");
 
     try {
-        const auto monsterModel = std::make_shared<Model>(
-            loadModelFromFile(getAssetFullPath("obj/Monster.obj"), false));
-        const auto judyModel = std::make_shared<Model>(
-            loadModelFromFile(getAssetFullPath("obj/judy_3d.obj"), true));
-        const auto nikeModel = std::make_shared<Model>(
-            loadModelFromFile(getAssetFullPath("obj/nike.obj"), true));
-        const auto snowModel = std::make_shared<Model>(
-            loadModelFromFile(getAssetFullPath("obj/snow_box.obj"), true));
-
-        auto addInstance = [&](const std::shared_ptr<Model>& model, const glm::vec3& pos, const glm::vec3& color, const glm::vec3& scale = glm::vec3(1.0f)) {
+        // all maze assets are normalized into the unit cube, so the compact vertex format is safe
+        ModelLoadOptions loadOptions;
+        loadOptions.vertexFormat = VertexFormat::Compact;
+
+        _placeholderModel = std::make_shared<Model>(createPlaceholderModel());
+        const auto monsterModel = _assetStreamer.requestModel(getAssetFullPath("obj/Monster.obj"), false, loadOptions);
+        const auto judyModel = _assetStreamer.requestModel(getAssetFullPath("obj/judy_3d.obj"), true, loadOptions);
+        const auto nikeModel = _assetStreamer.requestModel(getAssetFullPath("obj/nike.obj"), true, loadOptions);
+        const auto snowModel = _assetStreamer.requestModel(getAssetFullPath("obj/snow_box.obj"), true, loadOptions);
+        // uploaded straight from the buffer views of scene.bin
+        const auto knightModel = _assetStreamer.requestGltfModel(getAssetFullPath("gltf/grey_knight/scene.gltf"));
+
+        auto addInstance = [&](const std::shared_ptr<StreamedModel>& model, const glm::vec3& pos, const glm::vec3& color, const glm::vec3& scale = glm::vec3(1.0f)) {
             SceneModel sm;
-            sm.model = model;
+            sm.asset = model;
             sm.transform.position = pos;
             sm.transform.scale = scale;
             sm.fallbackColor = color;
@@ -360,6 +820,7 @@ MazeApp::MazeApp(const Options& options)
 
         const float cellSize = 1.5f;
         const float wallY = -2.0f;
+        const float wallSize = 1.8f;
         const std::vector<std::string> maze = {
             "###############",
             "#S   #     #  #",
@@ -379,6 +840,15 @@ MazeApp::MazeApp(const Options& options)
         const float startX = -0.5f * cellSize * static_cast<float>(cols - 1);
         const float startZ = -0.5f * cellSize * static_cast<float>(rows - 1);
 
+        _mazeOrigin = glm::vec2(startX, startZ);
+        _mazeCellSize = cellSize;
+        _mazeWallTop = wallY + 0.5f * wallSize;
+        _mazePvs.build(maze);
+        const MazePvs::Stats& pvsStats = _mazePvs.getStats();
+        std::cout << "Maze PVS: " << cols << "x" << rows << " cells in " << pvsStats.buildMs << " ms, "
+                  << _mazePvs.getByteSize() << " bytes, " << pvsStats.visibleWalls << " of "
+                  << pvsStats.wallCells << " walls visible per cell on average" << std::endl;
+
         for (int r = 0; r < rows; ++r) {
             for (int c = 0; c < cols; ++c) {
                 if (maze[r][c] == '#') {
@@ -386,11 +856,12 @@ MazeApp::MazeApp(const Options& options)
                         startX + static_cast<float>(c) * cellSize, wallY,
                         startZ + static_cast<float>(r) * cellSize);
                     SceneModel sm;
-                    sm.model = snowModel;
+                    sm.asset = snowModel;
                     sm.transform.position = pos;
-                    sm.transform.scale = glm::vec3(1.8f);  // 放大到 1.8
+                    sm.transform.scale = glm::vec3(wallSize);  // 放大到 1.8
                     sm.fallbackColor = glm::vec3(0.8f);
                     sm.isWall = true;
+                    sm.isStatic = true;
 
                     //初始化 AABB
                     glm::vec3 halfScale = sm.transform.scale * 0.5f;
@@ -403,6 +874,17 @@ MazeApp::MazeApp(const Options& options)
             }
         }
 
+        std::vector<BoundingBox> wallBoxes;
+        for (const SceneModel& sm : _sceneModels) {
+            if (sm.isWall) {
+                BoundingBox box;
+                box.min = sm.aabb.min;
+                box.max = sm.aabb.max;
+                wallBoxes.push_back(box);
+            }
+        }
+        _wallGrid.build(_mazeOrigin, cellSize, cols, rows, wallBoxes);
+
         const auto cellToWorld = [&](int c, int r, float y) -> glm::vec3 {
             return glm::vec3(
                 startX + static_cast<float>(c) * cellSize,
@@ -413,7 +895,7 @@ MazeApp::MazeApp(const Options& options)
         // Judy at start (near 'S')
         {
             SceneModel judy;
-            judy.model = judyModel;
+            judy.asset = judyModel;
             judy.transform.position = cellToWorld(1, 1, 0.0f);
             judy.transform.scale = glm::vec3(0.5f);  // 缩小到 50%
             judy.transform.lookAt(cellToWorld(3, 3, 0.0f));
@@ -424,23 +906,34 @@ MazeApp::MazeApp(const Options& options)
         // Nike at goal (near 'E')
         {
             SceneModel nike;
-            nike.model = nikeModel;
+            nike.asset = nikeModel;
             nike.transform.position = cellToWorld(cols - 3, rows - 2, 0.0f);
             nike.transform.scale = glm::vec3(0.6f);  // 缩小到 60%
             nike.fallbackColor = glm::vec3(0.9f, 0.9f, 0.9f);
             _sceneModels.push_back(std::move(nike));
         }
 
+        // Knight guarding the lower left room
+        {
+            SceneModel knight;
+            knight.asset = knightModel;
+            knight.transform.position = cellToWorld(2, rows - 3, 0.0f);
+            knight.transform.scale = glm::vec3(0.6f);
+            knight.transform.lookAt(cellToWorld(2, rows - 5, 0.0f));
+            knight.fallbackColor = glm::vec3(0.75f, 0.75f, 0.8f);
+            _sceneModels.push_back(std::move(knight));
+        }
+
         // Monster patrol near center
         {
             SceneModel monster;
-            monster.model = monsterModel;
+            monster.asset = monsterModel;
             monster.transform.position = cellToWorld(cols / 2, rows / 2, 0.0f);
             monster.transform.scale = glm::vec3(0.4f);  // 缩小到 40%
             monster.fallbackColor = glm::vec3(0.8f, 0.7f, 0.6f);
             _sceneModels.push_back(std::move(monster));
         }
-
+        markStartupPhase("scene setup");
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -448,7 +941,13 @@ MazeApp::MazeApp(const Options& options)
     }
 }
 
+bool MazeApp::isStreamingComplete() const {
+    return _assetStreamer.getPendingCount() == 0;
+}
+
 MazeApp::~MazeApp() {
+    // the registry outlives the gl context otherwise
+    AssetRegistry::getGlobal().clear();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -461,6 +960,15 @@ void MazeApp::renderFrame() {
 
     updateCamera(deltaTime);
 
+    _assetStreamer.update(_streamingBudgetMs);
+    if (!_streamingPhaseMarked && isStreamingComplete()) {
+        markStartupPhase("asset streaming");
+        _streamingPhaseMarked = true;
+    }
+    if (!_staticGeometryBuilt) {
+        buildStaticGeometry();
+    }
+
     showFpsInWindowTitle();
     std::ostringstream title;
     title << "Maze | FPS: " << static_cast<int>(1.0f / deltaTime)
@@ -469,7 +977,27 @@ void MazeApp::renderFrame() {
         << " | Intensity:" << _lightIntensity
         << " | Exposure:" << exposure
         << " | SSAO:" << ssaoRadius
-        << " | Ambient:" << ambientStrength;
+        << " | Ambient:" << ambientStrength
+        << " | LOD bias:" << _lodBias
+        << " | Models:" << _visibleModels.size() << " drawn, " << _culledModels << " culled"
+        << (_frustumCulling ? "" : " (culling off)")
+        << " | PVS:" << _pvsCulled << " culled" << (_pvsCulling ? "" : " (off)")
+        << " | Occlusion:" << _occlusionBuffer.getStats().occluded << " hidden by "
+        << _occlusionBuffer.getStats().occluders << ", raster " << std::setprecision(2)
+        << _occlusionBuffer.getStats().rasterMs << " ms, test " << _occlusionBuffer.getStats().testMs << " ms"
+        << std::setprecision(1) << (_occlusionCulling ? "" : " (off)")
+        << " | Draws:" << _renderQueue.getStats().draws << (_instancing ? "" : " (instancing off)")
+        << " | Binds avoided: tex " << _renderQueue.getStats().textureBindsSkipped << ", vao "
+        << _renderQueue.getStats().vaoBindsSkipped << ", uniforms " << _renderQueue.getStats().uniformUpdatesSkipped
+        << " | Batches:" << _visibleBatches << "/" << _staticGeometry.getBatches().size()
+        << (_staticBatching ? "" : " (batching off)")
+        << " | Tris:" << _drawnTriangles
+        << " | Clusters:" << _visibleMeshlets << "/" << _totalMeshlets
+        << (_meshletCulling ? "" : " (culling off)");
+    if (_assetStreamer.getPendingCount() != 0) {
+        title << " | Streaming:" << _assetStreamer.getPendingCount();
+    }
+    title << " | Assets:" << AssetRegistry::getGlobal().getResidentBytes() / (1024 * 1024) << " MiB";
     glfwSetWindowTitle(_window, title.str().c_str());
 
     glClearColor(_clearColor.r, _clearColor.g, _clearColor.b, _clearColor.a);
@@ -497,39 +1025,23 @@ void MazeApp::renderFrame() {
     _gBufferShader->setUniformMat4("view", view);
     _gBufferShader->setUniformMat4("projection", projection);
 
-    for (const SceneModel& sm : _sceneModels) {
-        if (!sm.model) continue;
-
-        glm::mat4 model = sm.transform.getLocalMatrix();
-        glm::mat3 normalMat = glm::transpose(glm::inverse(glm::mat3(model)));
-
-        _gBufferShader->setUniformMat4("model", model);
-        _gBufferShader->setUniformMat3("normalMatrix", normalMat);
-
-        for (const Mesh& mesh : sm.model->getMeshes()) {
-            bool hasTexture = (mesh.diffuseTexture != nullptr);
-
-            glm::vec3 finalColor = mesh.baseColor * sm.fallbackColor;
-            _gBufferShader->setUniformVec3("fallbackColor", finalColor);
-            _gBufferShader->setUniformBool("useAlbedoTexture", hasTexture ? true : false);
-
-            // 绑定纹理到 unit 0
-            glActiveTexture(GL_TEXTURE0);
-            if (hasTexture) {
-                mesh.diffuseTexture->bind();
-            }
-            else {
-                glBindTexture(GL_TEXTURE_2D, 0);
-            }
-
-            // 绘制
-            glBindVertexArray(mesh.vao);
-            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
-
-            if (hasTexture) mesh.diffuseTexture->unbind();
-        }
+    const Frustum frustum = _camera.getFrustum();
+    renderOccluders(frustum, projection * view);
+    cullSceneModels(frustum);
+    buildInstanceGroups();
+    _drawnTriangles = 0;
+    _visibleMeshlets = 0;
+    _totalMeshlets = 0;
+    _renderQueue.clear();
+    queueStaticGeometry(frustum);
+    for (const SceneModel* sm : _singleModels) {
+        queueSceneModel(*sm, frustum);
     }
+    for (const InstanceGroup& group : _instanceGroups) {
+        queueInstanceGroup(group);
+    }
+    _renderQueue.sort();
+    _renderQueue.submit(*_gBufferShader, _instanceBuffer);
     _gBufferShader->unuse();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -687,9 +1199,56 @@ void MazeApp::handleInput() {
         _keyPressed[GLFW_KEY_8] = true;
     }
 
+    // LOD bias (9/0 keys), higher means coarser
+    if (_input.keyboard.keyStates[GLFW_KEY_9] == GLFW_PRESS && !_keyPressed[GLFW_KEY_9]) {
+        _lodBias = glm::max(-4.0f, _lodBias - 0.5f);
+        _keyPressed[GLFW_KEY_9] = true;
+    }
+    if (_input.keyboard.keyStates[GLFW_KEY_0] == GLFW_PRESS && !_keyPressed[GLFW_KEY_0]) {
+        _lodBias = glm::min(8.0f, _lodBias + 0.5f);
+        _keyPressed[GLFW_KEY_0] = true;
+    }
+
+    // meshlet culling on / off (M key)
+    if (_input.keyboard.keyStates[GLFW_KEY_M] == GLFW_PRESS && !_keyPressed[GLFW_KEY_M]) {
+        _meshletCulling = !_meshletCulling;
+        _keyPressed[GLFW_KEY_M] = true;
+    }
+
+    // frustum culling of scene models on / off (F key)
+    if (_input.keyboard.keyStates[GLFW_KEY_F] == GLFW_PRESS && !_keyPressed[GLFW_KEY_F]) {
+        _frustumCulling = !_frustumCulling;
+        _keyPressed[GLFW_KEY_F] = true;
+    }
+
+    // instancing of repeated models on / off (I key)
+    if (_input.keyboard.keyStates[GLFW_KEY_I] == GLFW_PRESS && !_keyPressed[GLFW_KEY_I]) {
+        _instancing = !_instancing;
+        _keyPressed[GLFW_KEY_I] = true;
+    }
+
+    // static batching on / off (B key), the walls fall back to instancing
+    if (_input.keyboard.keyStates[GLFW_KEY_B] == GLFW_PRESS && !_keyPressed[GLFW_KEY_B]) {
+        _staticBatching = !_staticBatching;
+        _keyPressed[GLFW_KEY_B] = true;
+    }
+
+    // maze cell visibility on / off (P key)
+    if (_input.keyboard.keyStates[GLFW_KEY_P] == GLFW_PRESS && !_keyPressed[GLFW_KEY_P]) {
+        _pvsCulling = !_pvsCulling;
+        _keyPressed[GLFW_KEY_P] = true;
+    }
+
+    // software occlusion culling on / off (O key)
+    if (_input.keyboard.keyStates[GLFW_KEY_O] == GLFW_PRESS && !_keyPressed[GLFW_KEY_O]) {
+        _occlusionCulling = !_occlusionCulling;
+        _keyPressed[GLFW_KEY_O] = true;
+    }
+
     // 重置所有按键状态（释放时）
     for (int key : {GLFW_KEY_1, GLFW_KEY_2, GLFW_KEY_3, GLFW_KEY_4,
-        GLFW_KEY_5, GLFW_KEY_6, GLFW_KEY_7, GLFW_KEY_8}) {
+        GLFW_KEY_5, GLFW_KEY_6, GLFW_KEY_7, GLFW_KEY_8, GLFW_KEY_9, GLFW_KEY_0, GLFW_KEY_M, GLFW_KEY_F,
+        GLFW_KEY_I, GLFW_KEY_B, GLFW_KEY_P, GLFW_KEY_O}) {
         if (_input.keyboard.keyStates[key] == GLFW_RELEASE) {
             _keyPressed[key] = false;
         }
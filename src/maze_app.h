@@ -4,7 +4,18 @@
 #include "base/camera.h"
 #include "base/glsl_program.h"
 #include "base/transform.h"
+#include "asset_streamer.h"
+#include "collision_grid.h"
+#include "collision_solver.h"
+#include "frustum_culler.h"
+#include "instance_buffer.h"
+#include "instance_bvh.h"
+#include "maze_pvs.h"
+#include "occlusion_buffer.h"
 #include "model.h"
+#include "render_queue.h"
+#include "static_batch.h"
+#include <limits>
 #include <memory>
 #include <vector>
 #include<map>
@@ -19,33 +30,43 @@ public:
 
     ~MazeApp();
 
+    // every requested model is uploaded (or failed)
+    bool isStreamingComplete() const;
+
 private:
     struct AABB {
         glm::vec3 min;
         glm::vec3 max;
-
-        // -ײ
-        bool intersects(const glm::vec3& point, float radius) const {
-            glm::vec3 clamped = glm::clamp(point, min, max);
-            return glm::length(clamped - point) < radius;
-        }
     };
 
     struct SceneModel {
-        std::shared_ptr<Model> model;
+        // drawn as _placeholderModel until the streamer uploaded it
+        std::shared_ptr<StreamedModel> asset;
         Transform transform;
         glm::vec3 fallbackColor = glm::vec3(0.8f);
         AABB aabb;
         bool isWall = false;
+        // never moves after setup, merged into _staticGeometry once it is loaded
+        bool isStatic = false;
+        bool batched = false;
+        // the model whose world space bounds are in _sceneBounds, the transforms of the scene do
+        // not change after setup, so they are only recomputed when the placeholder is replaced
+        const Model* boundsModel = nullptr;
     };
 
     PerspectiveCamera _camera;
     std::unique_ptr<GLSLProgram> _shader;
     std::vector<SceneModel> _sceneModels;
 
+    // models are streamed in after the first frame, uploads get a slice of every frame
+    AssetStreamer _assetStreamer;
+    std::shared_ptr<Model> _placeholderModel;
+    float _streamingBudgetMs = 4.0f;
+    bool _streamingPhaseMarked = false;
 
-    float _yaw = -90.0f;   // ˮƽǶȣʼ -Z
-    float _pitch = 0.0f;   // ֱǶ
+
+    float _yaw = -90.0f;   // 水平方向角度，初始朝 -Z
+    float _pitch = 0.0f;   // 垂直方向角度
     float _moveSpeed = 2.0f;
     float _mouseSensitivity = 0.02f;
 
@@ -61,9 +82,69 @@ private:
 
     void updateCamera(float deltaTime);
 
+    // rasterizes the _occluderCount nearest walls in view into _occlusionBuffer
+    void renderOccluders(const Frustum& frustum, const glm::mat4& viewProjection);
+
+    // collects the scene models whose world bounds intersect the view frustum, lie in the pvs
+    // and are not hidden behind the occluders into _visibleModels
+    void cullSceneModels(const Frustum& frustum);
+
+    // visible scene models which share a model and fallback color, one instanced draw per mesh
+    struct InstanceGroup {
+        const Model* model = nullptr;
+        glm::vec3 fallbackColor = glm::vec3(0.8f);
+        // range of _instances
+        size_t firstInstance = 0;
+        size_t instanceCount = 0;
+        // largest scale / smallest distance of the instances, the lod of the whole group
+        float objectScale = 0.0f;
+        float distance = 0.0f;
+    };
+
+    // splits _visibleModels into _instanceGroups and _singleModels and uploads the instances
+    void buildInstanceGroups();
+
+    // the draws of the gbuffer pass go into _renderQueue and are submitted sorted by state
+    void queueSceneModel(const SceneModel& sm, const Frustum& frustum);
+
+    void queueInstanceGroup(const InstanceGroup& group);
+
+    // merges the static scene models into _staticGeometry once all of them are loaded and
+    // logs the cost of a few chunk sizes
+    void buildStaticGeometry();
+
+    void queueStaticGeometry(const Frustum& frustum);
+
+    // distance to the camera for the front to back order within equal state
+    void queueDraw(const DrawCommand& command, float distance);
+
+    // maze cell of a world position, which may lie outside of the maze
+    glm::ivec2 getMazeCell(const glm::vec3& position) const;
+
+    // the camera's cell if pvs culling is on and the camera stands in an open cell, -1 otherwise
+    glm::ivec2 getPvsCell() const;
+
+    // any maze cell touched by bounds is in the pvs of cell, bounds reaching outside of the
+    // maze are checked against the cells inside only
+    bool isInPvs(const glm::ivec2& cell, const BoundingBox& bounds) const;
+
+    // drawn as part of _staticGeometry instead of on its own
+    bool isBatched(const SceneModel& sm) const {
+        return sm.batched && _staticBatching;
+    }
+
+    // coarsest lod whose error stays below the pixel threshold at the given scale / distance
+    size_t selectLod(const Mesh& mesh, float objectScale, float distance) const;
+
+    // collects the index ranges of the meshlets which pass the frustum and cone tests
+    // into _drawCounts / _drawOffsets, eye is given in model space
+    void cullMeshlets(
+        const Mesh& mesh, const glm::mat4& model, float objectScale, const Frustum& frustum,
+        const glm::vec3& eye, bool coneCulling);
+
     float _lastFrameTime = 0.0f;
 
-    //Чʵ
+    //光照效果实现
         //
     struct GBufferUniforms {
         GLint model = -1;
@@ -99,7 +180,7 @@ private:
     std::vector<glm::vec3> ssaoKernel;
     GLuint noiseTexture = 0;
 
-    //
+    //函数
     void initResources();
 
     // parameters
@@ -114,12 +195,78 @@ private:
     float _materialShininess = 32.0f;
 
   
-    float _lightIntensity = 1.0f;  // ǿ
+    float _lightIntensity = 1.0f;  // 新增：光强倍数
+
+    // lod selection: screen space error threshold is 2^_lodBias pixels
+    float _lodBias = 0.0f;
+    size_t _drawnTriangles = 0;
+
+    // per model frustum culling (F key) and its statistics of the last frame
+    bool _frustumCulling = true;
+    // world space bounds of _sceneModels, same order
+    InstanceBounds _sceneBounds;
+    // the same bounds as a tree, which replaces the scan of _sceneBounds for frustum culling
+    // from _bvhCullingThreshold models on. below that the simd scan is faster
+    InstanceBvh _sceneBvh;
+    size_t _bvhCullingThreshold = 8192;
+    std::vector<uint32_t> _visibleIndices;
+    std::vector<const SceneModel*> _visibleModels;
+    size_t _culledModels = 0;
+
+    // maze cell visibility (P key), only models and batches touching a cell visible from the
+    // camera's cell are drawn while the camera is below _mazeWallTop. _mazeOrigin is the xz
+    // center of cell (0, 0)
+    bool _pvsCulling = true;
+    MazePvs _mazePvs;
+    glm::vec2 _mazeOrigin = glm::vec2(0.0f);
+    float _mazeCellSize = 1.0f;
+    float _mazeWallTop = std::numeric_limits<float>::max();
+    size_t _pvsCulled = 0;
+
+    // software occlusion culling (O key) of models and batches against the nearest walls,
+    // drawn as boxes of _occluderScale times the wall box since the snow does not fill it
+    bool _occlusionCulling = true;
+    size_t _occluderCount = 32;
+    float _occluderScale = 0.85f;
+    OcclusionBuffer _occlusionBuffer{ 256, 128 };
+    std::vector<BoundingBox> _occluders;
+    std::vector<std::pair<float, size_t>> _occluderCandidates;
+    std::vector<uint32_t> _visibleBatchIndices;
+
+    // wall boxes by maze cell, the player is only tested against the walls around it. every
+    // moving sphere of the frame is a mover, for now only the player
+    CollisionGrid _wallGrid;
+    CollisionSolver _collisionSolver;
+    std::vector<CollisionMover> _movers;
+
+    // instancing of repeated models (I key) and the draw calls of the last frame
+    bool _instancing = true;
+    std::vector<InstanceGroup> _instanceGroups;
+    std::vector<const SceneModel*> _singleModels;
+    std::vector<InstanceData> _instances;
+    InstanceBuffer _instanceBuffer;
+    RenderQueue _renderQueue;
+
+    // static batching (B key), chunks of _staticChunkSize world units
+    bool _staticBatching = true;
+    bool _staticGeometryBuilt = false;
+    float _staticChunkSize = 6.0f;
+    // also builds the whole scene, 4x and 2x chunks at startup and logs their draws and size
+    bool _compareStaticChunkSizes = false;
+    StaticGeometry _staticGeometry;
+    size_t _visibleBatches = 0;
+
+    // per meshlet culling (M key) and its statistics of the last frame
+    bool _meshletCulling = true;
+    size_t _visibleMeshlets = 0;
+    size_t _totalMeshlets = 0;
+    std::vector<GLsizei> _drawCounts;
+    std::vector<const void*> _drawOffsets;
 
-    // ٶ
-    const float _lightMoveSpeed = 5.0f;      // Դƶٶ (λ/)
-    const float _paramAdjustSpeed = 0.5f;    // ٶ
+    // 参数调节速度
+    const float _lightMoveSpeed = 5.0f;      // 光源移动速度 (单位/秒)
+    const float _paramAdjustSpeed = 0.5f;    // 参数增减速度
 
-    // ״̬ȥֹ·仯
+    // 键盘状态去抖（防止连续按键导致疯狂变化）
     std::map<int, bool> _keyPressed;
 };
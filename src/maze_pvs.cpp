@@ -0,0 +1,377 @@
+#include "maze_pvs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "base/thread_pool.h"
+
+namespace {
+
+    // 3 x 3 grid inside a cell of unit size, the center first since it decides most visible
+    // cells. fewer points miss cells seen at grazing angles past wall corners
+    constexpr float sampleInset = 0.02f;
+    constexpr float samplePoints[9][2] = {
+        { 0.5f, 0.5f },
+        { sampleInset, sampleInset },
+        { 0.5f, sampleInset },
+        { 1.0f - sampleInset, sampleInset },
+        { sampleInset, 0.5f },
+        { 1.0f - sampleInset, 0.5f },
+        { sampleInset, 1.0f - sampleInset },
+        { 0.5f, 1.0f - sampleInset },
+        { 1.0f - sampleInset, 1.0f - sampleInset },
+    };
+
+    enum CellState : uint8_t {
+        Unseen = 0,
+        Queued,
+        Visible,
+        Hidden,
+        // next to a visible cell, added to the set to cover the sight lines between the samples
+        Grown,
+    };
+
+    // search state of one worker, reused across the source cells of a row
+    struct Search {
+        std::vector<uint8_t> states;
+        std::vector<int> touched;
+        std::vector<int> queue;
+        std::vector<int> path;
+    };
+
+    struct RowResult {
+        std::vector<int32_t> rects;
+        std::vector<uint64_t> bits;
+        size_t visibleCells = 0;
+        size_t visibleWalls = 0;
+    };
+
+} // namespace
+
+void MazePvs::build(const std::vector<std::string>& maze, size_t maxThreads) {
+    const auto start = std::chrono::steady_clock::now();
+    clear();
+    if (maze.empty() || maze[0].empty()) {
+        return;
+    }
+
+    const int rows = static_cast<int>(maze.size());
+    const int cols = static_cast<int>(maze[0].size());
+    if (rows > std::numeric_limits<int16_t>::max() || cols > std::numeric_limits<int16_t>::max()) {
+        throw std::runtime_error("maze too large for its pvs");
+    }
+    std::vector<uint8_t> walls(static_cast<size_t>(rows) * cols);
+    for (int r = 0; r < rows; ++r) {
+        if (static_cast<int>(maze[r].size()) != cols) {
+            throw std::runtime_error("maze rows differ in length");
+        }
+        for (int c = 0; c < cols; ++c) {
+            walls[static_cast<size_t>(r) * cols + c] = maze[r][c] == '#' ? 1 : 0;
+        }
+    }
+
+    // walks the cells between the two points in cell units, true if none of them is a wall.
+    // path receives the crossed cells, without the first and the last one
+    const auto castRay = [&walls, cols](float x0, float y0, float x1, float y1, std::vector<int>& path) {
+        path.clear();
+        int x = static_cast<int>(std::floor(x0));
+        int y = static_cast<int>(std::floor(y0));
+        const int endX = static_cast<int>(std::floor(x1));
+        const int endY = static_cast<int>(std::floor(y1));
+        const float dx = x1 - x0;
+        const float dy = y1 - y0;
+        const int stepX = dx > 0.0f ? 1 : -1;
+        const int stepY = dy > 0.0f ? 1 : -1;
+        const float inf = std::numeric_limits<float>::infinity();
+        const float deltaX = dx != 0.0f ? 1.0f / std::abs(dx) : inf;
+        const float deltaY = dy != 0.0f ? 1.0f / std::abs(dy) : inf;
+        float maxX = dx != 0.0f ? (dx > 0.0f ? float(x + 1) - x0 : x0 - float(x)) * deltaX : inf;
+        float maxY = dy != 0.0f ? (dy > 0.0f ? float(y + 1) - y0 : y0 - float(y)) * deltaY : inf;
+
+        // float steps may run past the end on the other axis, never take more than needed
+        int steps = std::abs(endX - x) + std::abs(endY - y);
+        while (steps-- > 0) {
+            // exact corners step on y first, two walls touching at a corner close the gap
+            if (maxX < maxY) {
+                x += stepX;
+                maxX += deltaX;
+            }
+            else {
+                y += stepY;
+                maxY += deltaY;
+            }
+            if (x == endX && y == endY) {
+                break;
+            }
+            const int cell = y * cols + x;
+            if (walls[cell]) {
+                return false;
+            }
+            path.push_back(cell);
+        }
+        return true;
+        };
+
+    const size_t cellCount = walls.size();
+    std::vector<RowResult> results(rows);
+
+    ThreadPool::getGlobal().parallelFor(static_cast<size_t>(rows), [&](size_t row) {
+        // every source leaves all states unseen again
+        thread_local Search workerSearch;
+        Search& search = workerSearch;
+        if (search.states.size() != cellCount) {
+            search.states.assign(cellCount, Unseen);
+        }
+        RowResult& result = results[row];
+        const int r = static_cast<int>(row);
+
+        for (int c = 0; c < cols; ++c) {
+            const int source = r * cols + c;
+            if (walls[source]) {
+                result.rects.insert(result.rects.end(), { 0, 0, 0, 0 });
+                continue;
+            }
+
+            search.touched.clear();
+            search.queue.clear();
+            const auto enqueue = [&search](int cell) {
+                search.touched.push_back(cell);
+                search.queue.push_back(cell);
+                };
+            // marks cells proven visible by a ray, cells which were tested hidden before are
+            // queued again so that their neighbours get expanded
+            const auto markVisible = [&search, &enqueue](int cell) {
+                const uint8_t state = search.states[cell];
+                search.states[cell] = Visible;
+                if (state == Unseen || state == Hidden) {
+                    enqueue(cell);
+                }
+                };
+
+            markVisible(source);
+            for (size_t next = 0; next < search.queue.size(); ++next) {
+                const int cell = search.queue[next];
+                const int cellCol = cell % cols;
+                const int cellRow = cell / cols;
+                if (search.states[cell] != Visible) {
+                    bool visible = false;
+                    for (const auto& from : samplePoints) {
+                        for (const auto& to : samplePoints) {
+                            if (castRay(
+                                    float(c) + from[0], float(r) + from[1], float(cellCol) + to[0],
+                                    float(cellRow) + to[1], search.path)) {
+                                visible = true;
+                                break;
+                            }
+                        }
+                        if (visible) {
+                            break;
+                        }
+                    }
+                    if (!visible) {
+                        search.states[cell] = Hidden;
+                        continue;
+                    }
+                    search.states[cell] = Visible;
+                    for (int crossed : search.path) {
+                        markVisible(crossed);
+                    }
+                }
+
+                // the view ends at walls
+                if (walls[cell]) {
+                    continue;
+                }
+                const int neighbours[4][2] = {
+                    { cellCol - 1, cellRow }, { cellCol + 1, cellRow }, { cellCol, cellRow - 1 }, { cellCol, cellRow + 1 },
+                };
+                for (const auto& neighbour : neighbours) {
+                    if (neighbour[0] < 0 || neighbour[0] >= cols || neighbour[1] < 0 || neighbour[1] >= rows) {
+                        continue;
+                    }
+                    const int neighbourCell = neighbour[1] * cols + neighbour[0];
+                    if (search.states[neighbourCell] == Unseen) {
+                        search.states[neighbourCell] = Queued;
+                        enqueue(neighbourCell);
+                    }
+                }
+            }
+
+            // grow the set by the 8 neighbours of every visible cell. a sight line the samples
+            // miss passes next to one they see, so the grown set covers it
+            const size_t floodCount = search.touched.size();
+            for (size_t i = 0; i < floodCount; ++i) {
+                const int cell = search.touched[i];
+                if (search.states[cell] != Visible) {
+                    continue;
+                }
+                const int cellCol = cell % cols;
+                const int cellRow = cell / cols;
+                for (int neighbourRow = std::max(cellRow - 1, 0); neighbourRow <= std::min(cellRow + 1, rows - 1);
+                     ++neighbourRow) {
+                    for (int neighbourCol = std::max(cellCol - 1, 0); neighbourCol <= std::min(cellCol + 1, cols - 1);
+                         ++neighbourCol) {
+                        const int neighbourCell = neighbourRow * cols + neighbourCol;
+                        const uint8_t state = search.states[neighbourCell];
+                        if (state != Visible && state != Grown) {
+                            search.states[neighbourCell] = Grown;
+                            search.touched.push_back(neighbourCell);
+                        }
+                    }
+                }
+            }
+            const auto isInSet = [&search](int cell) {
+                return search.states[cell] == Visible || search.states[cell] == Grown;
+                };
+
+            int minCol = c, minRow = r, maxCol = c, maxRow = r;
+            for (int cell : search.touched) {
+                if (isInSet(cell)) {
+                    minCol = std::min(minCol, cell % cols);
+                    maxCol = std::max(maxCol, cell % cols);
+                    minRow = std::min(minRow, cell / cols);
+                    maxRow = std::max(maxRow, cell / cols);
+                }
+            }
+            const int width = maxCol - minCol + 1;
+            const int height = maxRow - minRow + 1;
+            const size_t offset = result.bits.size();
+            result.bits.resize(offset + (static_cast<size_t>(width) * height + 63) / 64, 0);
+            result.rects.insert(result.rects.end(), { minCol, minRow, width, height });
+
+            for (int cell : search.touched) {
+                if (isInSet(cell)) {
+                    // a cell can be queued twice, only count it once
+                    search.states[cell] = Unseen;
+                    const size_t bit = static_cast<size_t>(cell / cols - minRow) * width + (cell % cols - minCol);
+                    result.bits[offset + bit / 64] |= uint64_t(1) << (bit % 64);
+                    ++result.visibleCells;
+                    result.visibleWalls += walls[cell];
+                }
+                search.states[cell] = Unseen;
+            }
+        }
+        }, maxThreads);
+
+    _cols = cols;
+    _rows = rows;
+    _walls = std::move(walls);
+    _sets.resize(cellCount);
+    size_t visibleCells = 0, visibleWalls = 0;
+    for (int r = 0; r < rows; ++r) {
+        const RowResult& result = results[r];
+        const size_t base = _bits.size();
+        size_t offset = base;
+        for (int c = 0; c < cols; ++c) {
+            CellSet& set = _sets[static_cast<size_t>(r) * cols + c];
+            set.minCol = static_cast<int16_t>(result.rects[c * 4 + 0]);
+            set.minRow = static_cast<int16_t>(result.rects[c * 4 + 1]);
+            set.width = static_cast<int16_t>(result.rects[c * 4 + 2]);
+            set.height = static_cast<int16_t>(result.rects[c * 4 + 3]);
+            set.offset = static_cast<uint32_t>(offset);
+            offset += (static_cast<size_t>(set.width) * set.height + 63) / 64;
+        }
+        _bits.insert(_bits.end(), result.bits.begin(), result.bits.end());
+        visibleCells += result.visibleCells;
+        visibleWalls += result.visibleWalls;
+    }
+
+    _stats.wallCells = static_cast<size_t>(std::count(_walls.begin(), _walls.end(), uint8_t(1)));
+    _stats.openCells = cellCount - _stats.wallCells;
+    if (_stats.openCells != 0) {
+        _stats.visibleCells = static_cast<double>(visibleCells) / static_cast<double>(_stats.openCells);
+        _stats.visibleWalls = static_cast<double>(visibleWalls) / static_cast<double>(_stats.openCells);
+    }
+    _stats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MazePvs::clear() {
+    _cols = 0;
+    _rows = 0;
+    _walls.clear();
+    _sets.clear();
+    _bits.clear();
+    _stats = Stats();
+}
+
+bool MazePvs::empty() const {
+    return _sets.empty();
+}
+
+int MazePvs::getColumnCount() const {
+    return _cols;
+}
+
+int MazePvs::getRowCount() const {
+    return _rows;
+}
+
+bool MazePvs::isInside(int col, int row) const {
+    return col >= 0 && col < _cols && row >= 0 && row < _rows;
+}
+
+bool MazePvs::isWall(int col, int row) const {
+    return isInside(col, row) && _walls[static_cast<size_t>(row) * _cols + col] != 0;
+}
+
+bool MazePvs::hasSet(int col, int row) const {
+    return isInside(col, row) && getSet(col, row).width != 0;
+}
+
+bool MazePvs::isVisible(int fromCol, int fromRow, int col, int row) const {
+    return testBit(getSet(fromCol, fromRow), col, row);
+}
+
+bool MazePvs::isAnyVisible(int fromCol, int fromRow, int minCol, int minRow, int maxCol, int maxRow) const {
+    const CellSet& set = getSet(fromCol, fromRow);
+    minCol = std::max(minCol, int(set.minCol));
+    minRow = std::max(minRow, int(set.minRow));
+    maxCol = std::min(maxCol, set.minCol + set.width - 1);
+    maxRow = std::min(maxRow, set.minRow + set.height - 1);
+    for (int row = minRow; row <= maxRow; ++row) {
+        for (int col = minCol; col <= maxCol; ++col) {
+            if (testBit(set, col, row)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t MazePvs::getVisibleCount(int fromCol, int fromRow) const {
+    const CellSet& set = getSet(fromCol, fromRow);
+    const size_t words = (static_cast<size_t>(set.width) * set.height + 63) / 64;
+    size_t count = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t word = _bits[set.offset + i];
+        for (; word != 0; word &= word - 1) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t MazePvs::getByteSize() const {
+    return _bits.size() * sizeof(uint64_t) + _sets.size() * sizeof(CellSet) + _walls.size();
+}
+
+const MazePvs::Stats& MazePvs::getStats() const {
+    return _stats;
+}
+
+const MazePvs::CellSet& MazePvs::getSet(int col, int row) const {
+    return _sets[static_cast<size_t>(row) * _cols + col];
+}
+
+bool MazePvs::testBit(const CellSet& set, int col, int row) const {
+    col -= set.minCol;
+    row -= set.minRow;
+    if (col < 0 || col >= set.width || row < 0 || row >= set.height) {
+        return false;
+    }
+    const size_t bit = static_cast<size_t>(row) * set.width + col;
+    return (_bits[set.offset + bit / 64] >> (bit % 64)) & 1;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Potentially visible set of every open cell of a maze grid: the cells which can be seen from
+// somewhere inside the cell, looking between the walls in any direction. Walls are whole
+// cells ('#') which block the view, the camera is assumed to stay below their top.
+//
+// A cell sees another one if a ray between a 3 x 3 grid of sample points in each of the two
+// only crosses open cells. The search floods outwards from the source over the
+// neighbours of visible open cells, so its cost follows the visible area and not the maze.
+// Sampling alone misses cells seen only at grazing angles, so every set is grown by the 8
+// neighbours of its visible cells afterwards. That keeps the sets conservative at the cost of
+// a ring of cells drawn without need.
+//
+// Each set is stored as a bitset over the bounding rectangle of its cells, which is small
+// compared to the maze since walls keep the sight lines short.
+class MazePvs {
+public:
+    struct Stats {
+        double buildMs = 0.0;
+        size_t openCells = 0;
+        size_t wallCells = 0;
+        // averages over all open cells
+        double visibleCells = 0.0;
+        double visibleWalls = 0.0;
+    };
+
+    // rows of equal length, maxThreads == 0 uses the whole global thread pool
+    void build(const std::vector<std::string>& maze, size_t maxThreads = 0);
+
+    void clear();
+
+    bool empty() const;
+
+    int getColumnCount() const;
+
+    int getRowCount() const;
+
+    bool isInside(int col, int row) const;
+
+    bool isWall(int col, int row) const;
+
+    // false for walls and cells outside of the maze, which have no set
+    bool hasSet(int col, int row) const;
+
+    // from must have a set
+    bool isVisible(int fromCol, int fromRow, int col, int row) const;
+
+    // any cell of the inclusive rectangle, which may reach outside of the maze
+    bool isAnyVisible(int fromCol, int fromRow, int minCol, int minRow, int maxCol, int maxRow) const;
+
+    size_t getVisibleCount(int fromCol, int fromRow) const;
+
+    // bitsets and their rectangles
+    size_t getByteSize() const;
+
+    const Stats& getStats() const;
+
+private:
+    // 12 bytes, limits mazes to 32767 cells a side
+    struct CellSet {
+        int16_t minCol = 0;
+        int16_t minRow = 0;
+        int16_t width = 0;
+        int16_t height = 0;
+        // first word in _bits
+        uint32_t offset = 0;
+    };
+
+    int _cols = 0;
+    int _rows = 0;
+    std::vector<uint8_t> _walls;
+    std::vector<CellSet> _sets;
+    std::vector<uint64_t> _bits;
+    Stats _stats;
+
+    const CellSet& getSet(int col, int row) const;
+
+    bool testBit(const CellSet& set, int col, int row) const;
+};
@@ -0,0 +1,389 @@
+#include "mesh_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "base/asset_pack.h"
+
+namespace {
+
+    constexpr char cacheMagic[8] = { 'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H' };
+    // bump whenever the layout below or the content of the cached data changes
+    constexpr uint32_t cacheVersion = 4;
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        float center[3];
+        float scale;
+        uint32_t meshCount;
+        uint32_t vertexStride;
+        // stamps of the mtllib files of the source
+        uint64_t mtlOffset;
+        uint32_t mtlCount;
+        uint32_t reserved;
+    };
+
+    // a missing file is stamped with size and time 0
+    struct CacheMtlEntry {
+        uint64_t size;
+        int64_t time;
+        uint64_t pathOffset;
+        uint32_t pathLength;
+        uint32_t reserved;
+    };
+
+    struct CacheMeshEntry {
+        float baseColor[3];
+        uint32_t texturePathLength;
+        uint64_t texturePathOffset;
+        uint64_t vertexOffset;
+        uint64_t vertexCount;
+        uint64_t indexOffset;
+        uint64_t indexCount;
+        uint64_t lodOffset;
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        uint64_t meshletOffset;
+    };
+
+    struct CacheLodEntry {
+        uint32_t indexOffset;
+        uint32_t indexCount;
+        float error;
+        uint32_t reserved;
+    };
+
+    uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    const CacheHeader* getHeader(const MappedFile& file) {
+        return reinterpret_cast<const CacheHeader*>(file.data());
+    }
+
+    const CacheMeshEntry& getEntry(const MappedFile& file, size_t i) {
+        return reinterpret_cast<const CacheMeshEntry*>(file.data() + sizeof(CacheHeader))[i];
+    }
+
+    const Meshlet* getMeshlets(const MappedFile& file, const CacheMeshEntry& entry) {
+        return reinterpret_cast<const Meshlet*>(file.data() + entry.meshletOffset);
+    }
+
+    const CacheLodEntry* getLods(const MappedFile& file, const CacheMeshEntry& entry) {
+        return reinterpret_cast<const CacheLodEntry*>(file.data() + entry.lodOffset);
+    }
+
+    const CacheMtlEntry* getMtls(const MappedFile& file) {
+        return reinterpret_cast<const CacheMtlEntry*>(file.data() + getHeader(file)->mtlOffset);
+    }
+
+    std::string getDirectory(const std::string& path) {
+        const auto lastSlash = path.find_last_of("/\\");
+        return lastSlash == std::string::npos ? "" : path.substr(0, lastSlash + 1);
+    }
+
+    void getMtlStamp(const std::string& path, uint64_t& size, int64_t& time) {
+        if (!getAssetStamp(path, size, time)) {
+            size = 0;
+            time = 0;
+        }
+    }
+
+    bool isMtlCurrent(const MappedFile& file, const std::string& directory) {
+        const CacheHeader* header = getHeader(file);
+        const uint64_t fileSize = file.size();
+        if (header->mtlOffset % alignof(CacheMtlEntry) != 0
+            || header->mtlOffset + uint64_t(header->mtlCount) * sizeof(CacheMtlEntry) > fileSize) {
+            return false;
+        }
+        for (uint32_t i = 0; i < header->mtlCount; ++i) {
+            const CacheMtlEntry& mtl = getMtls(file)[i];
+            if (mtl.pathOffset + mtl.pathLength > fileSize) {
+                return false;
+            }
+            uint64_t size = 0;
+            int64_t time = 0;
+            getMtlStamp(directory + std::string(file.data() + mtl.pathOffset, mtl.pathLength), size, time);
+            if (size != mtl.size || time != mtl.time) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool areIndicesInRange(const uint32_t* indices, uint64_t indexCount, uint64_t vertexCount) {
+        uint32_t maxIndex = 0;
+        for (uint64_t i = 0; i < indexCount; ++i) {
+            maxIndex = std::max(maxIndex, indices[i]);
+        }
+        return indexCount == 0 || maxIndex < vertexCount;
+    }
+
+} // namespace
+
+std::string MeshCache::getCachePath(const std::string& sourcePath) {
+    return sourcePath + ".meshcache";
+}
+
+uint32_t MeshCache::getFlags(bool loadMtl, const ModelLoadOptions& options) {
+    uint32_t flags = 0;
+    if (loadMtl) {
+        flags |= LoadMtl;
+    }
+    if (options.optimizeMeshes) {
+        flags |= Optimized;
+    }
+    if (options.buildMeshlets) {
+        flags |= Meshlets;
+    }
+    flags |= static_cast<uint32_t>(std::clamp(options.maxLodLevels, 1, 255)) << LodLevelShift;
+    return flags;
+}
+
+bool MeshCache::open(const std::string& sourcePath, uint32_t flags) {
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    if (!getAssetStamp(sourcePath, sourceSize, sourceTime)) {
+        return false;
+    }
+
+    const std::string cachePath = getCachePath(sourcePath);
+    if (!assetExists(cachePath)) {
+        return false;
+    }
+
+    try {
+        _file = MappedFile(cachePath);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl;
+        return false;
+    }
+
+    const uint64_t fileSize = _file.size();
+    if (fileSize < sizeof(CacheHeader)) {
+        _file = MappedFile();
+        return false;
+    }
+
+    const CacheHeader* header = getHeader(_file);
+    if (std::memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 || header->version != cacheVersion
+        || header->vertexStride != sizeof(Vertex) || header->flags != flags
+        || header->sourceSize != sourceSize || header->sourceTime != sourceTime
+        || !isMtlCurrent(_file, getDirectory(sourcePath))) {
+        std::cout << "Mesh cache is stale: " << cachePath << std::endl;
+        _file = MappedFile();
+        return false;
+    }
+
+    // reject a truncated or damaged file before any array is handed out
+    const uint64_t entriesEnd = sizeof(CacheHeader) + uint64_t(header->meshCount) * sizeof(CacheMeshEntry);
+    bool valid = header->meshCount != 0 && entriesEnd <= fileSize;
+    for (size_t i = 0; valid && i < header->meshCount; ++i) {
+        const CacheMeshEntry& entry = getEntry(_file, i);
+        valid = entry.texturePathOffset + entry.texturePathLength <= fileSize
+                && entry.vertexOffset % alignof(Vertex) == 0
+                && entry.vertexOffset + entry.vertexCount * sizeof(Vertex) <= fileSize
+                && entry.indexOffset % alignof(uint32_t) == 0
+                && entry.indexOffset + entry.indexCount * sizeof(uint32_t) <= fileSize
+                && entry.lodOffset % alignof(CacheLodEntry) == 0
+                && entry.lodOffset + uint64_t(entry.lodCount) * sizeof(CacheLodEntry) <= fileSize
+                && entry.meshletOffset % alignof(Meshlet) == 0
+                && entry.meshletOffset + uint64_t(entry.meshletCount) * sizeof(Meshlet) <= fileSize;
+        for (uint32_t j = 0; valid && j < entry.lodCount; ++j) {
+            const CacheLodEntry& lod = getLods(_file, entry)[j];
+            valid = uint64_t(lod.indexOffset) + lod.indexCount <= entry.indexCount;
+        }
+        for (uint32_t j = 0; valid && j < entry.meshletCount; ++j) {
+            const Meshlet& meshlet = getMeshlets(_file, entry)[j];
+            valid = uint64_t(meshlet.indexOffset) + meshlet.indexCount <= entry.indexCount;
+        }
+        valid = valid && areIndicesInRange(
+            reinterpret_cast<const uint32_t*>(_file.data() + entry.indexOffset), entry.indexCount, entry.vertexCount);
+    }
+    if (!valid) {
+        std::cerr << "Warning: damaged mesh cache: " << cachePath << std::endl;
+        _file = MappedFile();
+        return false;
+    }
+
+    _meshCount = header->meshCount;
+    return true;
+}
+
+size_t MeshCache::getMeshCount() const {
+    return _meshCount;
+}
+
+MeshData MeshCache::getMeshInfo(size_t i) const {
+    const CacheMeshEntry& entry = getEntry(_file, i);
+    MeshData info;
+    info.baseColor = glm::vec3(entry.baseColor[0], entry.baseColor[1], entry.baseColor[2]);
+    info.texturePath.assign(_file.data() + entry.texturePathOffset, entry.texturePathLength);
+    for (uint32_t j = 0; j < entry.lodCount; ++j) {
+        const CacheLodEntry& lod = getLods(_file, entry)[j];
+        MeshLod meshLod;
+        meshLod.indexOffset = lod.indexOffset;
+        meshLod.indexCount = lod.indexCount;
+        meshLod.error = lod.error;
+        info.lods.push_back(meshLod);
+    }
+    const Meshlet* meshlets = getMeshlets(_file, entry);
+    info.meshlets.assign(meshlets, meshlets + entry.meshletCount);
+    return info;
+}
+
+const Vertex* MeshCache::getVertices(size_t i) const {
+    return reinterpret_cast<const Vertex*>(_file.data() + getEntry(_file, i).vertexOffset);
+}
+
+size_t MeshCache::getVertexCount(size_t i) const {
+    return static_cast<size_t>(getEntry(_file, i).vertexCount);
+}
+
+const uint32_t* MeshCache::getIndices(size_t i) const {
+    return reinterpret_cast<const uint32_t*>(_file.data() + getEntry(_file, i).indexOffset);
+}
+
+size_t MeshCache::getIndexCount(size_t i) const {
+    return static_cast<size_t>(getEntry(_file, i).indexCount);
+}
+
+glm::vec3 MeshCache::getCenter() const {
+    const CacheHeader* header = getHeader(_file);
+    return glm::vec3(header->center[0], header->center[1], header->center[2]);
+}
+
+float MeshCache::getScale() const {
+    return getHeader(_file)->scale;
+}
+
+bool MeshCache::write(const std::string& sourcePath, uint32_t flags, const ModelData& data) {
+    CacheHeader header{};
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.flags = flags;
+    if (!getAssetStamp(sourcePath, header.sourceSize, header.sourceTime)) {
+        return false;
+    }
+    header.center[0] = data.center.x;
+    header.center[1] = data.center.y;
+    header.center[2] = data.center.z;
+    header.scale = data.scale;
+    header.meshCount = static_cast<uint32_t>(data.meshes.size());
+    header.vertexStride = sizeof(Vertex);
+
+    // layout: header, entries, mtl stamps, meshlets, lod tables, texture paths, mtl paths,
+    // then the 16 byte aligned arrays of every mesh
+    std::vector<CacheMeshEntry> entries(data.meshes.size());
+    std::vector<CacheLodEntry> lods;
+    std::vector<CacheMtlEntry> mtls(data.mtlFiles.size());
+    uint64_t offset = sizeof(CacheHeader) + entries.size() * sizeof(CacheMeshEntry);
+    header.mtlOffset = offset;
+    header.mtlCount = static_cast<uint32_t>(mtls.size());
+    offset += mtls.size() * sizeof(CacheMtlEntry);
+    for (size_t i = 0; i < data.meshes.size(); ++i) {
+        entries[i].meshletOffset = offset;
+        entries[i].meshletCount = static_cast<uint32_t>(data.meshes[i].meshlets.size());
+        offset += entries[i].meshletCount * sizeof(Meshlet);
+    }
+    for (size_t i = 0; i < data.meshes.size(); ++i) {
+        entries[i].lodOffset = offset;
+        entries[i].lodCount = static_cast<uint32_t>(data.meshes[i].lods.size());
+        offset += entries[i].lodCount * sizeof(CacheLodEntry);
+        for (const MeshLod& meshLod : data.meshes[i].lods) {
+            lods.push_back({ meshLod.indexOffset, meshLod.indexCount, meshLod.error, 0 });
+        }
+    }
+    for (size_t i = 0; i < data.meshes.size(); ++i) {
+        entries[i].texturePathOffset = offset;
+        entries[i].texturePathLength = static_cast<uint32_t>(data.meshes[i].texturePath.size());
+        offset += entries[i].texturePathLength;
+    }
+    const std::string directory = getDirectory(sourcePath);
+    for (size_t i = 0; i < mtls.size(); ++i) {
+        getMtlStamp(directory + data.mtlFiles[i], mtls[i].size, mtls[i].time);
+        mtls[i].pathOffset = offset;
+        mtls[i].pathLength = static_cast<uint32_t>(data.mtlFiles[i].size());
+        mtls[i].reserved = 0;
+        offset += mtls[i].pathLength;
+    }
+    for (size_t i = 0; i < data.meshes.size(); ++i) {
+        const MeshData& mesh = data.meshes[i];
+        CacheMeshEntry& entry = entries[i];
+        entry.baseColor[0] = mesh.baseColor.r;
+        entry.baseColor[1] = mesh.baseColor.g;
+        entry.baseColor[2] = mesh.baseColor.b;
+        entry.vertexOffset = offset = alignUp(offset, 16);
+        entry.vertexCount = mesh.vertices.size();
+        offset += entry.vertexCount * sizeof(Vertex);
+        entry.indexOffset = offset = alignUp(offset, 16);
+        entry.indexCount = mesh.indices.size();
+        offset += entry.indexCount * sizeof(uint32_t);
+    }
+
+    const std::string cachePath = getCachePath(sourcePath);
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Warning: cannot write mesh cache: " << cachePath << std::endl;
+            return false;
+        }
+
+        uint64_t written = 0;
+        const auto put = [&](const void* bytes, uint64_t size) {
+            out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+            written += size;
+        };
+        const auto padTo = [&](uint64_t target) {
+            static const char zeros[16] = {};
+            put(zeros, target - written);
+        };
+
+        put(&header, sizeof(header));
+        put(entries.data(), entries.size() * sizeof(CacheMeshEntry));
+        put(mtls.data(), mtls.size() * sizeof(CacheMtlEntry));
+        for (const auto& mesh : data.meshes) {
+            put(mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+        }
+        put(lods.data(), lods.size() * sizeof(CacheLodEntry));
+        for (const auto& mesh : data.meshes) {
+            put(mesh.texturePath.data(), mesh.texturePath.size());
+        }
+        for (const auto& mtlFile : data.mtlFiles) {
+            put(mtlFile.data(), mtlFile.size());
+        }
+        for (size_t i = 0; i < data.meshes.size(); ++i) {
+            padTo(entries[i].vertexOffset);
+            put(data.meshes[i].vertices.data(), entries[i].vertexCount * sizeof(Vertex));
+            padTo(entries[i].indexOffset);
+            put(data.meshes[i].indices.data(), entries[i].indexCount * sizeof(uint32_t));
+        }
+
+        if (!out) {
+            std::cerr << "Warning: cannot write mesh cache: " << cachePath << std::endl;
+            out.close();
+            std::filesystem::remove(tempPath);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec) {
+        std::cerr << "Warning: cannot write mesh cache: " << cachePath << " (" << ec.message() << ")" << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    std::cout << "Wrote mesh cache: " << cachePath << std::endl;
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "base/mapped_file.h"
+#include "model.h"
+
+// Binary cache of an already deduplicated model, stored next to the source asset as
+// <asset>.meshcache. The file is memory mapped on load and the vertex / index arrays
+// are handed to glBufferData without copying. A cache is stale when the size or the
+// modification time of the source or of one of its .mtl files changed, or when it was written
+// with other flags. A cache whose indices reach past the vertices of their mesh is damaged.
+class MeshCache {
+public:
+    enum Flags : uint32_t {
+        LoadMtl = 1u << 0,
+        Optimized = 1u << 1,
+        Meshlets = 1u << 2,
+        // bits 8..15 hold ModelLoadOptions::maxLodLevels
+        LodLevelShift = 8,
+    };
+
+    static std::string getCachePath(const std::string& sourcePath);
+
+    // the flags a cache for these load options has to be written with
+    static uint32_t getFlags(bool loadMtl, const ModelLoadOptions& options);
+
+    // returns false if the cache is missing, stale or damaged
+    bool open(const std::string& sourcePath, uint32_t flags);
+
+    size_t getMeshCount() const;
+
+    // description of the mesh (color, texture, lods, meshlets) without the vertex / index arrays
+    MeshData getMeshInfo(size_t i) const;
+
+    const Vertex* getVertices(size_t i) const;
+
+    size_t getVertexCount(size_t i) const;
+
+    const uint32_t* getIndices(size_t i) const;
+
+    size_t getIndexCount(size_t i) const;
+
+    glm::vec3 getCenter() const;
+
+    float getScale() const;
+
+    // writes the cache atomically, failures are reported and ignored
+    static bool write(const std::string& sourcePath, uint32_t flags, const ModelData& data);
+
+private:
+    MappedFile _file;
+    size_t _meshCount = 0;
+};
@@ -0,0 +1,346 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+    // forsyth scoring, see https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+    constexpr int forsythCacheSize = 32;
+    constexpr float cacheDecayPower = 1.5f;
+    constexpr float lastTriangleScore = 0.75f;
+    constexpr float valenceBoostScale = 2.0f;
+    constexpr float valenceBoostPower = 0.5f;
+    constexpr int maxValenceScore = 32;
+
+    struct ForsythTables {
+        float cache[forsythCacheSize];
+        float valence[maxValenceScore];
+
+        ForsythTables() {
+            for (int i = 0; i < forsythCacheSize; ++i) {
+                if (i < 3) {
+                    // the vertices of the last triangle get a fixed score so that the next
+                    // triangle does not simply reuse the same edge every time
+                    cache[i] = lastTriangleScore;
+                }
+                else {
+                    const float scaler = 1.0f / (forsythCacheSize - 3);
+                    cache[i] = std::pow(1.0f - (i - 3) * scaler, cacheDecayPower);
+                }
+            }
+            valence[0] = 0.0f;
+            for (int i = 1; i < maxValenceScore; ++i) {
+                // boost vertices with few remaining triangles to get rid of lone triangles
+                valence[i] = valenceBoostScale * std::pow(static_cast<float>(i), -valenceBoostPower);
+            }
+        }
+    };
+
+    float getVertexScore(const ForsythTables& tables, int cachePosition, uint32_t remainingValence) {
+        if (remainingValence == 0) {
+            return -1.0f;
+        }
+
+        float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+        score += tables.valence[std::min<uint32_t>(remainingValence, maxValenceScore - 1)];
+        return score;
+    }
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0) {
+        return stats;
+    }
+
+    // fifo cache: a vertex is a hit while less than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (uint32_t index : indices) {
+        if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+            ++misses;
+            loadedAt[index] = misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    static const ForsythTables tables;
+
+    // triangles adjacent to each vertex, triangles which are emitted are swapped to the
+    // end of the vertex range so the first remainingValence entries are the pending ones
+    std::vector<uint32_t> remainingValence(vertexCount, 0);
+    for (uint32_t index : indices) {
+        ++remainingValence[index];
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingValence[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+    }
+
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = getVertexScore(tables, -1, remainingValence[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]]
+                           + vertexScore[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    // three extra slots for the vertices pushed out by the triangle being emitted
+    uint32_t cache[forsythCacheSize + 3];
+    uint32_t newCache[forsythCacheSize + 3];
+    size_t cacheCount = 0;
+
+    size_t bestTriangle = 0;
+    for (size_t t = 1; t < triangleCount; ++t) {
+        if (triangleScore[t] > triangleScore[bestTriangle]) {
+            bestTriangle = t;
+        }
+    }
+    // fallback cursor once no triangle in the cache is left, all triangles before it were emitted
+    size_t inputCursor = 0;
+
+    while (result.size() < indices.size()) {
+        const uint32_t a = indices[bestTriangle * 3];
+        const uint32_t b = indices[bestTriangle * 3 + 1];
+        const uint32_t c = indices[bestTriangle * 3 + 2];
+        result.push_back(a);
+        result.push_back(b);
+        result.push_back(c);
+        emitted[bestTriangle] = 1;
+
+        // move the triangle to the front of the lru cache
+        size_t newCacheCount = 0;
+        newCache[newCacheCount++] = a;
+        newCache[newCacheCount++] = b;
+        newCache[newCacheCount++] = c;
+        for (size_t i = 0; i < cacheCount; ++i) {
+            const uint32_t v = cache[i];
+            if (v != a && v != b && v != c) {
+                newCache[newCacheCount++] = v;
+            }
+        }
+
+        for (uint32_t v : { a, b, c }) {
+            uint32_t* begin = adjacency.data() + adjacencyOffsets[v];
+            uint32_t* end = begin + remainingValence[v];
+            uint32_t* it = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+            std::swap(*it, *(end - 1));
+            --remainingValence[v];
+        }
+
+        // rescore everything in the cache, the vertices past forsythCacheSize drop out
+        for (size_t i = 0; i < newCacheCount; ++i) {
+            const uint32_t v = newCache[i];
+            const int position = i < static_cast<size_t>(forsythCacheSize) ? static_cast<int>(i) : -1;
+            const float score = getVertexScore(tables, position, remainingValence[v]);
+            const float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            const uint32_t* begin = adjacency.data() + adjacencyOffsets[v];
+            for (const uint32_t* it = begin; it != begin + remainingValence[v]; ++it) {
+                triangleScore[*it] += delta;
+            }
+        }
+
+        // the next triangle is picked among the pending triangles around the cache
+        float bestScore = -1.0f;
+        bool found = false;
+        for (size_t i = 0; i < newCacheCount; ++i) {
+            const uint32_t v = newCache[i];
+            const uint32_t* begin = adjacency.data() + adjacencyOffsets[v];
+            for (const uint32_t* it = begin; it != begin + remainingValence[v]; ++it) {
+                if (triangleScore[*it] > bestScore) {
+                    bestScore = triangleScore[*it];
+                    bestTriangle = *it;
+                    found = true;
+                }
+            }
+        }
+
+        cacheCount = std::min<size_t>(newCacheCount, forsythCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        if (!found && result.size() < indices.size()) {
+            // nothing left around the cache, continue with the next unused triangle in input order
+            while (emitted[inputCursor]) {
+                ++inputCursor;
+            }
+            bestTriangle = inputCursor;
+        }
+    }
+
+    indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // fifo cache simulation, advancing the timestamp by more than cacheSize flushes the cache
+    constexpr size_t cacheSize = 16;
+    std::vector<size_t> loadedAt(vertices.size(), 0);
+    size_t timestamp = cacheSize + 1;
+    const auto countMisses = [&](size_t t) {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = indices[t * 3 + k];
+            if (timestamp - loadedAt[v] > cacheSize) {
+                loadedAt[v] = timestamp++;
+                ++misses;
+            }
+        }
+        return misses;
+        };
+    const auto flushCache = [&]() {
+        timestamp += cacheSize + 1;
+        };
+
+    // hard boundaries: the cache optimizer jumped to a disconnected triangle
+    std::vector<size_t> hardClusters;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (countMisses(t) == 3 || t == 0) {
+            hardClusters.push_back(t);
+        }
+    }
+
+    // soft boundaries: a hard cluster is split as soon as the acmr of the part so far
+    // (starting with a cold cache) is within threshold of the acmr of the whole cluster
+    std::vector<size_t> clusters;
+    for (size_t i = 0; i < hardClusters.size(); ++i) {
+        const size_t begin = hardClusters[i];
+        const size_t end = i + 1 < hardClusters.size() ? hardClusters[i + 1] : triangleCount;
+
+        flushCache();
+        size_t clusterMisses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            clusterMisses += countMisses(t);
+        }
+        const float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+        clusters.push_back(begin);
+        flushCache();
+        size_t runMisses = 0;
+        size_t runTriangles = 0;
+        for (size_t t = begin; t < end; ++t) {
+            runMisses += countMisses(t);
+            ++runTriangles;
+            if (static_cast<float>(runMisses) / static_cast<float>(runTriangles) <= clusterThreshold) {
+                clusters.push_back(t + 1);
+                flushCache();
+                runMisses = 0;
+                runTriangles = 0;
+            }
+        }
+
+        // the remainder after the last split may be worse than the threshold, it is
+        // simply kept as its own cluster; a split right at the end is dropped
+        if (clusters.back() == end) {
+            clusters.pop_back();
+        }
+    }
+
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const glm::vec3& p0 = vertices[indices[t * 3]].position;
+        const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+        const float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCenter += (p0 + p1 + p2) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea > 0.0f) {
+        meshCenter /= meshArea;
+    }
+
+    // clusters whose area weighted normal points away from the center are likely to
+    // occlude the rest of the mesh and are drawn first
+    std::vector<float> sortKey(clusters.size());
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        const size_t begin = clusters[i];
+        const size_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = begin; t < end; ++t) {
+            const glm::vec3& p0 = vertices[indices[t * 3]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            const float a = glm::length(n);
+            center += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        if (area > 0.0f) {
+            center /= area;
+        }
+        sortKey[i] = glm::dot(center - meshCenter, normal);
+    }
+
+    std::vector<size_t> order(clusters.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKey](size_t lhs, size_t rhs) {
+        return sortKey[lhs] > sortKey[rhs];
+        });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (size_t i : order) {
+        const size_t begin = clusters[i];
+        const size_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+    }
+
+    indices.swap(result);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    constexpr uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
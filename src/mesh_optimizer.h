@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/vertex.h"
+
+// post-transform vertex cache statistics of an index buffer, simulated with a fifo cache
+struct VertexCacheStats {
+    // average cache miss ratio: transformed vertices per triangle, 0.5 .. 3
+    float acmr = 0.0f;
+    // average transform to vertex ratio: transformed vertices per vertex, 1 is optimal
+    float atvr = 0.0f;
+};
+
+VertexCacheStats analyzeVertexCache(
+    const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = 16);
+
+// reorders triangles for the post-transform vertex cache (Forsyth, linear speed)
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// reorders the clusters of a cache optimized index buffer so that triangles facing away
+// from the mesh center are drawn first (Sander et al. "Fast triangle reordering for
+// vertex locality and reduced overdraw"). threshold is the acmr a cluster may lose, 1.05 = 5%
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+// reorders the vertices in order of first use by the index buffer and drops unused ones
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
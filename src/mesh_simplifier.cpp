@@ -0,0 +1,266 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+    // symmetric 4x4 error matrix of the planes around a vertex, weighted by triangle area
+    struct Quadric {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+        double weight = 0.0;
+
+        void addPlane(const glm::dvec3& n, double d, double w) {
+            a00 += w * n.x * n.x;
+            a01 += w * n.x * n.y;
+            a02 += w * n.x * n.z;
+            a11 += w * n.y * n.y;
+            a12 += w * n.y * n.z;
+            a22 += w * n.z * n.z;
+            b0 += w * n.x * d;
+            b1 += w * n.y * d;
+            b2 += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        Quadric& operator+=(const Quadric& q) {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+            return *this;
+        }
+
+        // weighted sum of squared distances of p to all planes
+        double evaluate(const glm::dvec3& p) const {
+            const double rx = a00 * p.x + a01 * p.y + a02 * p.z;
+            const double ry = a01 * p.x + a11 * p.y + a12 * p.z;
+            const double rz = a02 * p.x + a12 * p.y + a22 * p.z;
+            return p.x * rx + p.y * ry + p.z * rz + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        }
+    };
+
+    struct Collapse {
+        uint32_t source;
+        uint32_t target;
+        float error;
+    };
+
+    uint64_t getEdgeKey(uint32_t a, uint32_t b) {
+        return a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a);
+    }
+
+} // namespace
+
+std::vector<uint32_t> simplifyMesh(
+    const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount,
+    float targetError, float* resultError) {
+    std::vector<uint32_t> result = indices;
+    float maxError = 0.0f;
+
+    // vertices which differ only in normal / texcoord share one position id
+    std::vector<uint32_t> positionId(vertices.size());
+    std::vector<uint32_t> wedgeCount;
+    std::vector<glm::dvec3> positions;
+    {
+        std::unordered_map<glm::vec3, uint32_t> positionMap;
+        positionMap.reserve(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            auto it = positionMap.emplace(vertices[i].position, static_cast<uint32_t>(positions.size())).first;
+            if (it->second == positions.size()) {
+                positions.push_back(glm::dvec3(vertices[i].position));
+                wedgeCount.push_back(0);
+            }
+            positionId[i] = it->second;
+            ++wedgeCount[it->second];
+        }
+    }
+
+    // vertices on open borders, non manifold edges and attribute seams never move
+    std::vector<char> locked(positions.size(), 0);
+    {
+        std::unordered_map<uint64_t, uint32_t> edgeUse;
+        edgeUse.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                ++edgeUse[getEdgeKey(positionId[result[i + k]], positionId[result[i + (k + 1) % 3]])];
+            }
+        }
+        for (const auto& edge : edgeUse) {
+            if (edge.second != 2) {
+                locked[edge.first >> 32] = 1;
+                locked[edge.first & 0xffffffffu] = 1;
+            }
+        }
+        for (size_t p = 0; p < positions.size(); ++p) {
+            if (wedgeCount[p] > 1) {
+                locked[p] = 1;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(positions.size());
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const glm::dvec3& p0 = positions[positionId[result[i]]];
+        const glm::dvec3& p1 = positions[positionId[result[i + 1]]];
+        const glm::dvec3& p2 = positions[positionId[result[i + 2]]];
+        const glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+        const double area = glm::length(n);
+        if (area == 0.0) {
+            continue;
+        }
+        const glm::dvec3 normal = n / area;
+        for (int k = 0; k < 3; ++k) {
+            quadrics[positionId[result[i + k]]].addPlane(normal, -glm::dot(normal, p0), area);
+        }
+    }
+
+    std::vector<Collapse> bestCollapse(positions.size());
+    std::vector<char> hasCollapse(positions.size());
+    std::vector<char> touched(positions.size());
+    std::vector<uint32_t> adjacencyOffsets(positions.size() + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    while (result.size() > targetIndexCount) {
+        // cheapest collapse of every free vertex, the target is one of its neighbours
+        std::fill(hasCollapse.begin(), hasCollapse.end(), 0);
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 6; ++k) {
+                const uint32_t source = result[i + k % 3];
+                const uint32_t target = result[i + (k < 3 ? (k + 1) % 3 : (k + 2) % 3)];
+                const uint32_t ps = positionId[source];
+                const uint32_t pt = positionId[target];
+                if (ps == pt || locked[ps]) {
+                    continue;
+                }
+
+                Quadric q = quadrics[ps];
+                q += quadrics[pt];
+                const float error = q.weight > 0.0
+                    ? static_cast<float>(std::sqrt(std::max(q.evaluate(positions[pt]), 0.0) / q.weight))
+                    : 0.0f;
+                if (!hasCollapse[ps] || error < bestCollapse[ps].error) {
+                    bestCollapse[ps] = { source, target, error };
+                    hasCollapse[ps] = 1;
+                }
+            }
+        }
+
+        collapses.clear();
+        for (size_t p = 0; p < positions.size(); ++p) {
+            if (hasCollapse[p] && bestCollapse[p].error <= targetError) {
+                collapses.push_back(bestCollapse[p]);
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+            return lhs.error < rhs.error;
+            });
+
+        // triangles around each position for the flip test
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result) {
+            ++adjacencyOffsets[positionId[index] + 1];
+        }
+        for (size_t p = 0; p < positions.size(); ++p) {
+            adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+        }
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); ++i) {
+                adjacency[fill[positionId[result[i]]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        // every collapse removes about two triangles, do not overshoot the target
+        const size_t collapseBudget = (result.size() - targetIndexCount) / 6 + 1;
+        size_t applied = 0;
+        std::vector<uint32_t> remap(vertices.size());
+        for (size_t i = 0; i < remap.size(); ++i) {
+            remap[i] = static_cast<uint32_t>(i);
+        }
+        std::fill(touched.begin(), touched.end(), 0);
+
+        for (const Collapse& collapse : collapses) {
+            const uint32_t ps = positionId[collapse.source];
+            const uint32_t pt = positionId[collapse.target];
+            if (touched[ps] || touched[pt]) {
+                continue;
+            }
+
+            // reject the collapse if a remaining triangle around the source would flip
+            bool flips = false;
+            for (uint32_t a = adjacencyOffsets[ps]; a < adjacencyOffsets[ps + 1] && !flips; ++a) {
+                const uint32_t t = adjacency[a];
+                glm::dvec3 p[3];
+                bool containsTarget = false;
+                for (int k = 0; k < 3; ++k) {
+                    const uint32_t id = positionId[result[t * 3 + k]];
+                    containsTarget = containsTarget || id == pt;
+                    p[k] = positions[id];
+                }
+                if (containsTarget) {
+                    continue;
+                }
+
+                const glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int k = 0; k < 3; ++k) {
+                    if (positionId[result[t * 3 + k]] == ps) {
+                        p[k] = positions[pt];
+                    }
+                }
+                const glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                flips = glm::dot(before, after) <= 0.25 * glm::length(before) * glm::length(after);
+            }
+            if (flips) {
+                continue;
+            }
+
+            // the one ring of the source changes shape, keep it fixed for the rest of the pass
+            for (uint32_t a = adjacencyOffsets[ps]; a < adjacencyOffsets[ps + 1]; ++a) {
+                const uint32_t t = adjacency[a];
+                for (int k = 0; k < 3; ++k) {
+                    touched[positionId[result[t * 3 + k]]] = 1;
+                }
+            }
+
+            remap[collapse.source] = collapse.target;
+            quadrics[pt] += quadrics[ps];
+            maxError = std::max(maxError, collapse.error);
+            if (++applied == collapseBudget) {
+                break;
+            }
+        }
+
+        if (applied == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t a = remap[result[i]];
+            const uint32_t b = remap[result[i + 1]];
+            const uint32_t c = remap[result[i + 2]];
+            if (positionId[a] == positionId[b] || positionId[b] == positionId[c] || positionId[a] == positionId[c]) {
+                continue;
+            }
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (resultError != nullptr) {
+        *resultError = maxError;
+    }
+    return result;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/vertex.h"
+
+// Quadric error edge collapse (Garland & Heckbert) that only moves a vertex onto one of
+// its neighbours, so the result still indexes the original vertex array and all levels of
+// detail can share one vertex buffer. Vertices on borders and attribute seams (several
+// vertices with the same position) are kept in place so that no cracks can open.
+// Stops at targetIndexCount or when the next collapse would exceed targetError, the error
+// is the rms distance to the original surface in model units.
+std::vector<uint32_t> simplifyMesh(
+    const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount,
+    float targetError, float* resultError = nullptr);
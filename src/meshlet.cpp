@@ -0,0 +1,215 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+    // closed in terms of positions, attribute seams do not count as borders
+    bool isClosedMesh(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount) {
+        std::unordered_map<glm::vec3, uint32_t> positionMap;
+        std::vector<uint32_t> positionId(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            positionId[i] = positionMap.emplace(vertices[i].position, static_cast<uint32_t>(positionMap.size())).first->second;
+        }
+
+        // every directed edge of a closed, consistently wound mesh is matched by its reverse
+        std::unordered_map<uint64_t, int> edgeBalance;
+        edgeBalance.reserve(indexCount);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t a = positionId[indices[i + k]];
+                const uint32_t b = positionId[indices[i + (k + 1) % 3]];
+                if (a < b) {
+                    ++edgeBalance[uint64_t(a) << 32 | b];
+                }
+                else {
+                    --edgeBalance[uint64_t(b) << 32 | a];
+                }
+            }
+        }
+
+        return std::all_of(edgeBalance.begin(), edgeBalance.end(), [](const std::pair<const uint64_t, int>& edge) {
+            return edge.second == 0;
+            });
+    }
+
+    void computeBounds(Meshlet& meshlet, const std::vector<Vertex>& vertices, const uint32_t* indices, bool withCone) {
+        const uint32_t* begin = indices + meshlet.indexOffset;
+        const uint32_t* end = begin + meshlet.indexCount;
+
+        glm::vec3 minV(std::numeric_limits<float>::max());
+        glm::vec3 maxV(-std::numeric_limits<float>::max());
+        for (const uint32_t* it = begin; it != end; ++it) {
+            minV = glm::min(minV, vertices[*it].position);
+            maxV = glm::max(maxV, vertices[*it].position);
+        }
+        meshlet.center = 0.5f * (minV + maxV);
+        meshlet.radius = 0.0f;
+        for (const uint32_t* it = begin; it != end; ++it) {
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[*it].position - meshlet.center));
+        }
+
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+        if (!withCone) {
+            return;
+        }
+
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.indexCount / 3);
+        glm::vec3 axis(0.0f);
+        for (const uint32_t* it = begin; it != end; it += 3) {
+            const glm::vec3& p0 = vertices[it[0]].position;
+            const glm::vec3& p1 = vertices[it[1]].position;
+            const glm::vec3& p2 = vertices[it[2]].position;
+            const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            const float length = glm::length(n);
+            if (length > 0.0f) {
+                normals.push_back(n / length);
+                axis += normals.back();
+            }
+        }
+
+        const float axisLength = glm::length(axis);
+        if (axisLength == 0.0f) {
+            return;
+        }
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (const glm::vec3& n : normals) {
+            minDot = std::min(minDot, glm::dot(n, axis));
+        }
+
+        // a cone wider than ~84 degrees practically never culls
+        if (minDot <= 0.1f) {
+            return;
+        }
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+} // namespace
+
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, uint32_t* indices, size_t indexCount) {
+    std::vector<Meshlet> meshlets;
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return meshlets;
+    }
+
+    const bool withCone = isClosedMesh(vertices, indices, indexCount);
+
+    std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+        ++adjacencyOffsets[indices[i] + 1];
+    }
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<glm::vec3> triangleNormals(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const glm::vec3& p0 = vertices[indices[t * 3]].position;
+        const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+        const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(n);
+        triangleNormals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+    }
+
+    std::vector<char> emitted(triangleCount, 0);
+    // marks the vertices of the current meshlet, reset through the list of used vertices
+    std::vector<char> used(vertices.size(), 0);
+    std::vector<uint32_t> usedList;
+    usedList.reserve(maxMeshletVertices);
+
+    std::vector<uint32_t> result;
+    result.reserve(indexCount);
+    Meshlet current;
+    glm::vec3 normalSum(0.0f);
+    size_t seedCursor = 0;
+
+    const auto countNewVertices = [&](size_t t) {
+        size_t count = 0;
+        for (int k = 0; k < 3; ++k) {
+            count += used[indices[t * 3 + k]] ? 0 : 1;
+        }
+        return count;
+        };
+
+    const auto flush = [&]() {
+        current.indexCount = static_cast<uint32_t>(result.size()) - current.indexOffset;
+        meshlets.push_back(current);
+        current = Meshlet();
+        current.indexOffset = static_cast<uint32_t>(result.size());
+        normalSum = glm::vec3(0.0f);
+        for (uint32_t v : usedList) {
+            used[v] = 0;
+        }
+        usedList.clear();
+        };
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        // grow the meshlet with the adjacent triangle which adds the fewest vertices and
+        // bends the normal cone the least, so that the cones stay narrow enough to cull
+        size_t best = triangleCount;
+        float bestScore = std::numeric_limits<float>::max();
+        const glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+        for (uint32_t v : usedList) {
+            for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a) {
+                const uint32_t t = adjacency[a];
+                if (emitted[t]) {
+                    continue;
+                }
+                const float score = static_cast<float>(countNewVertices(t))
+                                    + 2.0f * (1.0f - glm::dot(triangleNormals[t], axis));
+                if (score < bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        const size_t triangles = (result.size() - current.indexOffset) / 3;
+        if (best == triangleCount || usedList.size() + countNewVertices(best) > maxMeshletVertices
+            || triangles == maxMeshletTriangles) {
+            if (triangles != 0) {
+                flush();
+            }
+            // start the next meshlet where the (cache optimized) input order continues
+            while (emitted[seedCursor]) {
+                ++seedCursor;
+            }
+            best = seedCursor;
+        }
+
+        emitted[best] = 1;
+        normalSum += triangleNormals[best];
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = indices[best * 3 + k];
+            result.push_back(v);
+            if (!used[v]) {
+                used[v] = 1;
+                usedList.push_back(v);
+            }
+        }
+    }
+    flush();
+
+    std::copy(result.begin(), result.end(), indices);
+    for (Meshlet& meshlet : meshlets) {
+        computeBounds(meshlet, vertices, indices, withCone);
+    }
+    return meshlets;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/frustum.h"
+#include "base/vertex.h"
+
+constexpr size_t maxMeshletVertices = 64;
+constexpr size_t maxMeshletTriangles = 124;
+
+// a cluster of neighbouring triangles, stored as a range of the mesh index buffer
+struct Meshlet {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    // bounding sphere in model space
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    // normal cone, coneCutoff >= 1 means the triangles face too many directions to be culled
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f;
+};
+
+static_assert(sizeof(Meshlet) == 40, "Meshlet is stored as is in the mesh cache");
+
+// groups the triangles into meshlets of at most maxMeshletVertices unique vertices and
+// maxMeshletTriangles triangles and reorders the indices meshlet by meshlet. meshlets grow
+// from seeds taken in index order, so the indices should be optimized for the vertex cache.
+// offsets are relative to indices. cones are only computed for closed meshes since back
+// faces of open meshes can be visible
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, uint32_t* indices, size_t indexCount);
+
+// eye in the model space of the meshlet
+inline bool isMeshletBackFacing(const Meshlet& meshlet, const glm::vec3& eye) {
+    if (meshlet.coneCutoff >= 1.0f) {
+        return false;
+    }
+    const glm::vec3 toCenter = meshlet.center - eye;
+    return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
+
+// world space sphere against the planes of the frustum, which point inside
+inline bool isSphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius) {
+    for (const Plane& plane : frustum.planes) {
+        if (plane.getSignedDistanceToPoint(center) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
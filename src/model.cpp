@@ -1,10 +1,16 @@
 #include "model.h"
 
+#include "asset_registry.h"
+#include "base/asset_pack.h"
 #include "base/gl_utility.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "obj_parser.h"
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <limits>
-#include <sstream>
 #include <stdexcept>
 #include <unordered_map>
 #include <iostream>
@@ -15,68 +21,7 @@ Model::Model(const std::string& filepath) {
 }
 namespace {
 
-    struct FaceVertex {
-        int positionIndex = -1;
-        int texcoordIndex = -1;
-        int normalIndex = -1;
-    };
-
-    struct MaterialData {
-        glm::vec3 diffuseColor = glm::vec3(0.8f);
-        std::string diffuseTexture;
-    };
-
-    struct FaceGroup {
-        std::string materialName;
-        std::vector<FaceVertex> vertices;
-    };
-
-    struct ParsedObj {
-        std::vector<glm::vec3> positions;
-        std::vector<glm::vec3> normals;
-        std::vector<glm::vec2> texcoords;
-        std::vector<FaceGroup> groups;
-        std::unordered_map<std::string, MaterialData> materials;
-    };
-
-    glm::vec3 parseVec3(std::istringstream& iss) {
-        float x = 0.0f, y = 0.0f, z = 0.0f;
-        iss >> x >> y >> z;
-        return { x, y, z };
-    }
-
-    glm::vec2 parseVec2(std::istringstream& iss) {
-        float x = 0.0f, y = 0.0f;
-        iss >> x >> y;
-        return { x, y };
-    }
-
-    std::string trim(const std::string& s) {
-        const auto begin = s.find_first_not_of(" \t\r\n");
-        if (begin == std::string::npos) {
-            return "";
-        }
-        const auto end = s.find_last_not_of(" \t\r\n");
-        return s.substr(begin, end - begin + 1);
-    }
-
-    std::vector<std::string> tokenize(const std::string& line) {
-        std::istringstream iss(line);
-        std::vector<std::string> tokens;
-        std::string token;
-        while (iss >> token) {
-            tokens.push_back(token);
-        }
-        return tokens;
-    }
-
-    // ļǷ
-    bool fileExists(const std::string& path) {
-        std::ifstream f(path);
-        return f.good();
-    }
-
-    // ·ȡƣȥչ
+    // 从完整路径中提取基础名称（去除扩展名）
     std::string getBaseName(const std::string& path) {
         auto lastSlash = path.find_last_of("/\\");
         auto lastDot = path.find_last_of('.');
@@ -87,171 +32,277 @@ namespace {
         return path.substr(start, end - start);
     }
 
-    void loadMtlFile(
-        const std::string& mtlPath, std::unordered_map<std::string, MaterialData>& materials) {
-        std::ifstream file(mtlPath);
-        if (!file.is_open()) {
-            std::cerr << "Warning: Could not open MTL file: " << mtlPath << std::endl;
-            return;
+    // open addressing (linear probing) table from a resolved (position, texcoord, normal)
+    // index triple to the index of the deduplicated vertex, sized once so it never rehashes
+    class VertexIndexTable {
+    public:
+        explicit VertexIndexTable(size_t maxEntries) {
+            size_t capacity = 16;
+            while (capacity < maxEntries * 2) {
+                capacity <<= 1;
+            }
+            _mask = capacity - 1;
+            _slots.resize(capacity);
         }
 
-        std::cout << "Loading MTL file: " << mtlPath << std::endl;
-
-        std::string line;
-        std::string currentName;
-        MaterialData currentMaterial;
-
-        auto commitMaterial = [&]() {
-            if (!currentName.empty()) {
-                materials[currentName] = currentMaterial;
-                std::cout << "  Material '" << currentName << "': ";
-                std::cout << "Kd(" << currentMaterial.diffuseColor.r << ", "
-                    << currentMaterial.diffuseColor.g << ", "
-                    << currentMaterial.diffuseColor.b << ")";
-                if (!currentMaterial.diffuseTexture.empty()) {
-                    std::cout << ", Texture: '" << currentMaterial.diffuseTexture << "'";
+        // returns the index stored for the triple, or stores and returns newIndex
+        uint32_t findOrInsert(int position, int texcoord, int normal, uint32_t newIndex) {
+            size_t i = hash(position, texcoord, normal) & _mask;
+            for (;;) {
+                Slot& slot = _slots[i];
+                if (slot.index == emptySlot) {
+                    slot = { position, texcoord, normal, newIndex };
+                    return newIndex;
                 }
-                std::cout << std::endl;
+                if (slot.position == position && slot.texcoord == texcoord && slot.normal == normal) {
+                    return slot.index;
+                }
+                i = (i + 1) & _mask;
             }
-            };
+        }
 
-        while (std::getline(file, line)) {
-            line = trim(line);
-            if (line.empty() || line[0] == '#') {
-                continue;
-            }
+    private:
+        static constexpr uint32_t emptySlot = std::numeric_limits<uint32_t>::max();
+
+        struct Slot {
+            int position = -1;
+            int texcoord = -1;
+            int normal = -1;
+            uint32_t index = emptySlot;
+        };
+
+        std::vector<Slot> _slots;
+        size_t _mask = 0;
+
+        static size_t hash(int position, int texcoord, int normal) {
+            // murmur3 finalizer over the packed triple
+            uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(position)) << 32)
+                         ^ static_cast<uint32_t>(texcoord);
+            h ^= static_cast<uint64_t>(static_cast<uint32_t>(normal)) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ull;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+    };
 
-            std::istringstream iss(line);
-            std::string key;
-            iss >> key;
+    std::shared_ptr<ImageTexture2D> loadMeshTexture(const std::string& texturePath, TextureCache& textureCache) {
+        auto cacheIt = textureCache.find(texturePath);
+        if (cacheIt != textureCache.end()) {
+            std::cout << "  -> Using cached texture" << std::endl;
+            return cacheIt->second;
+        }
+
+        try {
+            // shared with every other model using the same image
+            auto texture = AssetRegistry::getGlobal().getTexture(texturePath);
+            textureCache[texturePath] = texture;
+            std::cout << "  -> Texture loaded successfully!" << std::endl;
+            return texture;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "  -> ERROR: Failed to load texture: " << e.what() << std::endl;
+            return nullptr;
+        }
+    }
 
-            if (key == "newmtl") {
-                commitMaterial();
-                iss >> currentName;
-                currentMaterial = MaterialData{};
+    // decodes the textures of a load batch in parallel and uploads them into the cache, so that
+    // createMesh finds them there instead of decoding one after another. baked textures are
+    // left to loadTexture, resident ones come from the registry
+    void preloadTextures(const std::vector<std::string>& texturePaths, TextureCache& textureCache) {
+        AssetRegistry& registry = AssetRegistry::getGlobal();
+        std::vector<std::string> pending;
+        for (const std::string& texturePath : texturePaths) {
+            if (textureCache.count(texturePath) != 0
+                || std::find(pending.begin(), pending.end(), texturePath) != pending.end()) {
+                continue;
             }
-            else if (key == "Kd") {
-                currentMaterial.diffuseColor = parseVec3(iss);
+            if (auto texture = registry.findTexture(AssetRegistry::getTextureKey(texturePath))) {
+                textureCache[texturePath] = texture;
+                continue;
             }
-            else if (key == "map_Kd") {
-                std::string texPath;
-                std::getline(iss, texPath);
-                texPath = trim(texPath);
-                // бתΪб
-                std::replace(texPath.begin(), texPath.end(), '\\', '/');
-                currentMaterial.diffuseTexture = texPath;
+            BakedTexture baked;
+            if (!baked.open(texturePath)) {
+                pending.push_back(texturePath);
             }
         }
+        if (pending.empty()) {
+            return;
+        }
 
-        commitMaterial();
-    }
+        const auto begin = std::chrono::high_resolution_clock::now();
+        const std::vector<DecodedImage> images = decodeImages(pending);
+        const float decodeMs = std::chrono::duration<float, std::milli>(
+            std::chrono::high_resolution_clock::now() - begin).count();
 
-    FaceVertex parseFaceToken(const std::string& token) {
-        FaceVertex fv{};
-        std::istringstream ss(token);
-        std::string element;
-        int idx = 0;
-        while (std::getline(ss, element, '/')) {
-            if (element.empty()) {
-                ++idx;
-                continue;
+        for (const DecodedImage& image : images) {
+            try {
+                auto texture = std::make_shared<ImageTexture2D>(image);
+                registry.addTexture(AssetRegistry::getTextureKey(image.path), texture);
+                textureCache[image.path] = texture;
             }
-            int value = std::stoi(element);
-            int fixedIndex = (value < 0) ? value : value - 1;
-            switch (idx) {
-            case 0: fv.positionIndex = fixedIndex; break;
-            case 1: fv.texcoordIndex = fixedIndex; break;
-            case 2: fv.normalIndex = fixedIndex; break;
-            default: break;
+            catch (const std::exception& e) {
+                std::cerr << "  -> ERROR: Failed to load texture: " << e.what() << std::endl;
+                textureCache[image.path] = nullptr;
             }
-            ++idx;
         }
-        return fv;
+        std::cout << "  -> Decoded " << images.size() << " textures in parallel (" << decodeMs << " ms)"
+                  << std::endl;
     }
 
-    ParsedObj parseObjFile(const std::string& path, bool loadMtl) {
-        ParsedObj result;
-        std::ifstream file(path);
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open obj file: " + path);
-        }
+    // every level halves the triangles of the previous one until the simplifier gets stuck on
+    // borders and seams or the error budget is used up, the levels are appended to the indices
+    void buildLodChain(MeshData& meshData, int maxLevels) {
+        // models are normalized into the unit cube, so this is 5% of the model size
+        constexpr float maxLodError = 0.05f;
+
+        std::vector<uint32_t> previous = meshData.indices;
+        float error = 0.0f;
+        for (int level = 1; level < maxLevels; ++level) {
+            float levelError = 0.0f;
+            std::vector<uint32_t> lod = simplifyMesh(
+                meshData.vertices, previous, previous.size() / 6 * 3, maxLodError - error, &levelError);
+            if (lod.empty() || lod.size() > previous.size() * 3 / 4) {
+                break;
+            }
 
-        const auto lastSlash = path.find_last_of("/\\");
-        const std::string directory = (lastSlash == std::string::npos) ? "" : path.substr(0, lastSlash + 1);
+            optimizeVertexCache(lod, meshData.vertices.size());
+            error += levelError;
 
-        std::string line;
-        std::string currentMaterial;
-        while (std::getline(file, line)) {
-            line = trim(line);
-            if (line.empty() || line[0] == '#') {
-                continue;
-            }
+            MeshLod meshLod;
+            meshLod.indexOffset = static_cast<uint32_t>(meshData.indices.size());
+            meshLod.indexCount = static_cast<uint32_t>(lod.size());
+            meshLod.error = error;
+            meshData.indices.insert(meshData.indices.end(), lod.begin(), lod.end());
+            meshData.lods.push_back(meshLod);
+            previous.swap(lod);
+        }
+    }
 
-            std::istringstream iss(line);
-            std::string key;
-            iss >> key;
+} // namespace
 
-            if (key == "v") {
-                result.positions.push_back(parseVec3(iss));
-            }
-            else if (key == "vt") {
-                result.texcoords.push_back(parseVec2(iss));
-            }
-            else if (key == "vn") {
-                result.normals.push_back(parseVec3(iss));
-            }
-            else if (key == "f") {
-                std::vector<std::string> tokens = tokenize(line);
-                if (tokens.size() < 4) {
-                    continue;
-                }
+const void* EncodedVertices::getData() const {
+    return format == VertexFormat::Compact ? static_cast<const void*>(compact.data()) : vertices;
+}
 
-                std::vector<FaceVertex> faceVertices;
-                for (size_t i = 1; i < tokens.size(); ++i) {
-                    faceVertices.push_back(parseFaceToken(tokens[i]));
-                }
+EncodedVertices encodeVertices(const Vertex* vertices, size_t count, VertexFormat format) {
+    EncodedVertices result;
+    result.format = format;
+    result.count = count;
+    if (format == VertexFormat::Compact) {
+        result.compact = compressVertices(vertices, count, &result.error);
+    }
+    else {
+        result.vertices = vertices;
+    }
+    // the vertices of the lods are shared, the full vertex range covers all of them
+    for (size_t i = 0; i < count; ++i) {
+        result.bounds += vertices[i].position;
+    }
+    return result;
+}
 
-                for (size_t i = 1; i + 1 < faceVertices.size(); ++i) {
-                    FaceGroup group;
-                    group.materialName = currentMaterial;
-                    group.vertices.push_back(faceVertices[0]);
-                    group.vertices.push_back(faceVertices[i]);
-                    group.vertices.push_back(faceVertices[i + 1]);
-                    result.groups.push_back(std::move(group));
-                }
-            }
-            else if (key == "usemtl") {
-                iss >> currentMaterial;
-            }
-            else if (key == "mtllib" && loadMtl) {
-                std::string mtlFile;
-                iss >> mtlFile;
-                loadMtlFile(directory + mtlFile, result.materials);
-            }
-        }
+Mesh createMesh(
+    const MeshData& meshData, const EncodedVertices& vertices, const uint32_t* indices, size_t indexCount,
+    const std::string& directory, TextureCache& textureCache) {
+    const VertexFormat vertexFormat = vertices.format;
+    Mesh mesh{};
+    mesh.baseColor = meshData.baseColor;
+    mesh.vertexFormat = vertexFormat;
+
+    if (!meshData.texturePath.empty()) {
+        mesh.diffuseTexture = loadMeshTexture(directory + meshData.texturePath, textureCache);
+    }
 
-        return result;
+    glGenVertexArrays(1, &mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
+    glGenBuffers(1, &mesh.ebo);
+
+    glBindVertexArray(mesh.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(
+        GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.count * getVertexStride(vertexFormat)),
+        vertices.getData(), GL_STATIC_DRAW);
+    if (vertexFormat == VertexFormat::Compact) {
+        const VertexQuantizationError& error = vertices.error;
+        std::cout << "Compact vertices: " << vertices.count << " x " << sizeof(CompactVertex) << " bytes (was "
+                  << sizeof(Vertex) << "), max error: position " << error.maxPositionError << ", normal "
+                  << error.maxNormalError << " deg, texcoord " << error.maxTexCoordError << std::endl;
     }
 
-    struct Hasher {
-        size_t operator()(const Vertex& v) const {
-            return std::hash<Vertex>{}(v);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+    glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indexCount * sizeof(uint32_t)),
+        indices, GL_STATIC_DRAW);
+
+    setupVertexAttributes(vertexFormat);
+
+    glBindVertexArray(0);
+
+    mesh.indexCount = meshData.lods.empty() ? indexCount : meshData.lods[0].indexCount;
+    mesh.bufferBytes = vertices.count * getVertexStride(vertexFormat) + indexCount * sizeof(uint32_t);
+    mesh.lods = meshData.lods;
+    mesh.meshlets = meshData.meshlets;
+    mesh.bounds = vertices.bounds;
+    return mesh;
+}
+
+std::shared_ptr<ImageTexture2D> loadTexture(const std::string& path) {
+    const auto begin = std::chrono::high_resolution_clock::now();
+    const auto elapsedMs = [&begin]() {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+        };
+
+    BakedTexture baked;
+    if (baked.open(path)) {
+        try {
+            auto texture = std::make_shared<ImageTexture2D>(baked, path);
+            std::cout << "  -> Baked texture: " << baked.getWidth() << "x" << baked.getHeight() << ", "
+                      << baked.getLevelCount() << " levels, " << baked.getTotalSize() / 1024 << " KiB ("
+                      << elapsedMs() << " ms)" << std::endl;
+            return texture;
         }
-    };
+        catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << ", decoding the image instead" << std::endl;
+        }
+    }
 
-} // namespace
+    auto texture = std::make_shared<ImageTexture2D>(path);
+    std::cout << "  -> Decoded texture: " << path << " (" << elapsedMs() << " ms)" << std::endl;
+    return texture;
+}
+
+Model::Model(std::vector<Mesh>&& meshes) : _meshes(std::move(meshes)) {
+    computeBoundingBox();
+}
 
-Model::Model(std::vector<Mesh>&& meshes) : _meshes(std::move(meshes)) {}
+Model::Model(std::vector<Mesh>&& meshes, std::vector<GLuint>&& sharedBuffers, size_t sharedBufferBytes)
+    : _meshes(std::move(meshes)), _sharedBuffers(std::move(sharedBuffers)), _sharedBufferBytes(sharedBufferBytes) {
+    computeBoundingBox();
+}
 
-Model::Model(Model&& rhs) noexcept : _meshes(std::move(rhs._meshes)) {
+Model::Model(Model&& rhs) noexcept
+    : _boundingBox(rhs._boundingBox), _meshes(std::move(rhs._meshes)), _sharedBuffers(std::move(rhs._sharedBuffers)),
+      _sharedBufferBytes(rhs._sharedBufferBytes) {
     rhs._meshes.clear();
+    rhs._sharedBuffers.clear();
+    rhs._sharedBufferBytes = 0;
+    rhs._boundingBox = BoundingBox();
 }
 
 Model& Model::operator=(Model&& rhs) noexcept {
     if (this != &rhs) {
         cleanup();
         _meshes = std::move(rhs._meshes);
+        _sharedBuffers = std::move(rhs._sharedBuffers);
+        _sharedBufferBytes = rhs._sharedBufferBytes;
+        _boundingBox = rhs._boundingBox;
         rhs._meshes.clear();
+        rhs._sharedBuffers.clear();
+        rhs._sharedBufferBytes = 0;
+        rhs._boundingBox = BoundingBox();
     }
     return *this;
 }
@@ -281,24 +332,47 @@ void Model::cleanup() {
             mesh.vao = 0;
         }
     }
+    if (!_sharedBuffers.empty()) {
+        glDeleteBuffers(static_cast<GLsizei>(_sharedBuffers.size()), _sharedBuffers.data());
+        _sharedBuffers.clear();
+    }
 }
 
 const std::vector<Mesh>& Model::getMeshes() const {
     return _meshes;
 }
 
-Model loadModelFromFile(const std::string& path, bool loadMtl) {
-    const ParsedObj parsed = parseObjFile(path, loadMtl);
+size_t Model::getByteSize() const {
+    size_t bytes = _sharedBufferBytes;
+    for (const Mesh& mesh : _meshes) {
+        bytes += mesh.bufferBytes;
+    }
+    return bytes;
+}
+
+const BoundingBox& Model::getBounds() const {
+    return _boundingBox;
+}
+
+void Model::computeBoundingBox() {
+    _boundingBox = BoundingBox();
+    for (const Mesh& mesh : _meshes) {
+        _boundingBox += transformBoundingBox(mesh.bounds, mesh.localMatrix);
+    }
+}
+
+ModelData buildModelData(const std::string& path, bool loadMtl, const ModelLoadOptions& options) {
+    const ParsedObj parsed = parseObjFile(path, loadMtl, options.parseThreads);
 
-    if (parsed.groups.empty()) {
+    if (parsed.faceStreams.empty()) {
         throw std::runtime_error("no faces found in obj: " + path);
     }
 
     glm::vec3 minV(std::numeric_limits<float>::max());
     glm::vec3 maxV(-std::numeric_limits<float>::max());
 
-    for (const auto& group : parsed.groups) {
-        for (const auto& fv : group.vertices) {
+    for (const auto& stream : parsed.faceStreams) {
+        for (const auto& fv : stream.vertices) {
             int posIndex = fv.positionIndex;
             if (posIndex < 0) {
                 posIndex = static_cast<int>(parsed.positions.size()) + posIndex;
@@ -316,29 +390,35 @@ Model loadModelFromFile(const std::string& path, bool loadMtl) {
     const glm::vec3 extent = maxV - minV;
     const float maxExtent = std::max({ extent.x, extent.y, extent.z, 1e-4f });
 
-    std::unordered_map<std::string, std::vector<FaceVertex>> groupedFaces;
-    for (const auto& group : parsed.groups) {
-        groupedFaces[group.materialName].insert(
-            groupedFaces[group.materialName].end(), group.vertices.begin(), group.vertices.end());
-    }
-
-    std::vector<Mesh> meshes;
-    std::unordered_map<std::string, std::shared_ptr<ImageTexture2D>> textureCache;
+    ModelData data;
+    data.center = center;
+    data.scale = maxExtent;
 
     const auto lastSlash = path.find_last_of("/\\");
     const std::string directory = (lastSlash == std::string::npos) ? "" : path.substr(0, lastSlash + 1);
+    data.directory = directory;
+    data.mtlFiles = parsed.mtlFiles;
 
-    // ȡ OBJ ļĻƣչ
+    // 获取 OBJ 文件的基础名称（不含扩展名）
     const std::string baseName = getBaseName(path);
     std::cout << "Loading model: " << baseName << std::endl;
 
-    for (const auto& groupPair : groupedFaces) {
-        const std::string& materialName = groupPair.first;
-        const auto& faceVertices = groupPair.second;
+    // out of range indices resolve to -1 so that every missing attribute shares one key
+    const auto resolveIndex = [](int idx, size_t size) {
+        if (idx < 0) {
+            idx = static_cast<int>(size) + idx;
+        }
+        return (idx >= 0 && idx < static_cast<int>(size)) ? idx : -1;
+        };
+
+    for (const auto& stream : parsed.faceStreams) {
+        const std::string& materialName = stream.materialName;
+        const auto& faceVertices = stream.vertices;
 
-        std::unordered_map<Vertex, uint32_t, Hasher> uniqueVertices;
-        std::vector<Vertex> vertices;
-        std::vector<uint32_t> indices;
+        VertexIndexTable uniqueVertices(faceVertices.size());
+        MeshData meshData;
+        std::vector<Vertex>& vertices = meshData.vertices;
+        std::vector<uint32_t>& indices = meshData.indices;
 
         vertices.reserve(faceVertices.size());
         indices.reserve(faceVertices.size());
@@ -355,116 +435,151 @@ Model loadModelFromFile(const std::string& path, bool loadMtl) {
         }
 
         for (const auto& fv : faceVertices) {
-            const auto resolveIndex = [](int idx, size_t size) {
-                if (idx >= 0) {
-                    return idx;
-                }
-                return static_cast<int>(size) + idx;
-                };
-            Vertex vertex{};
             const int posIndex = resolveIndex(fv.positionIndex, parsed.positions.size());
-            if (posIndex >= 0 && posIndex < static_cast<int>(parsed.positions.size())) {
-                vertex.position = (parsed.positions[posIndex] - center) / maxExtent;
-            }
             const int normalIndex = resolveIndex(fv.normalIndex, parsed.normals.size());
-            if (normalIndex >= 0 && normalIndex < static_cast<int>(parsed.normals.size())) {
-                vertex.normal = parsed.normals[normalIndex];
-            }
             const int texIndex = resolveIndex(fv.texcoordIndex, parsed.texcoords.size());
-            if (texIndex >= 0 && texIndex < static_cast<int>(parsed.texcoords.size())) {
-                vertex.texCoord = parsed.texcoords[texIndex];
-            }
 
-            auto it = uniqueVertices.find(vertex);
-            if (it == uniqueVertices.end()) {
-                uint32_t index = static_cast<uint32_t>(vertices.size());
-                uniqueVertices[vertex] = index;
+            const uint32_t nextIndex = static_cast<uint32_t>(vertices.size());
+            const uint32_t index = uniqueVertices.findOrInsert(posIndex, texIndex, normalIndex, nextIndex);
+            if (index == nextIndex) {
+                Vertex vertex{};
+                if (posIndex >= 0) {
+                    vertex.position = (parsed.positions[posIndex] - center) / maxExtent;
+                }
+                if (normalIndex >= 0) {
+                    vertex.normal = parsed.normals[normalIndex];
+                }
+                if (texIndex >= 0) {
+                    vertex.texCoord = parsed.texcoords[texIndex];
+                }
                 vertices.push_back(vertex);
-                indices.push_back(index);
             }
-            else {
-                indices.push_back(it->second);
+            indices.push_back(index);
+        }
+
+        if (options.optimizeMeshes) {
+            const VertexCacheStats before = analyzeVertexCache(indices, vertices.size());
+            optimizeVertexCache(indices, vertices.size());
+            optimizeOverdraw(indices, vertices);
+            optimizeVertexFetch(vertices, indices);
+            const VertexCacheStats after = analyzeVertexCache(indices, vertices.size());
+            std::cout << "Optimized mesh '" << materialName << "': " << indices.size() / 3 << " triangles, ACMR "
+                      << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr
+                      << std::endl;
+        }
+
+        meshData.lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+        if (options.maxLodLevels > 1) {
+            buildLodChain(meshData, options.maxLodLevels);
+            for (size_t level = 0; level < meshData.lods.size(); ++level) {
+                std::cout << "  LOD " << level << ": " << meshData.lods[level].indexCount / 3 << " triangles, error "
+                          << meshData.lods[level].error << std::endl;
             }
         }
 
-        Mesh mesh{};
-        mesh.baseColor = material.diffuseColor;
+        const size_t fullIndexCount = meshData.lods[0].indexCount;
+        if (options.buildMeshlets && fullIndexCount / 3 >= minMeshletMeshTriangles) {
+            meshData.meshlets = buildMeshlets(vertices, indices.data(), fullIndexCount);
+            std::cout << "  " << meshData.meshlets.size() << " meshlets" << std::endl;
+        }
+
+        meshData.baseColor = material.diffuseColor;
 
-        // ߼
+        // 纹理加载逻辑
         if (loadMtl) {
-            std::string texturePath;
-
-            // 1 MTL ļָʹ
+            // 策略1：如果 MTL 文件中指定了纹理，优先使用
             if (!material.diffuseTexture.empty()) {
-                texturePath = directory + material.diffuseTexture;
-                std::cout << "Trying texture from MTL: '" << texturePath << "'" << std::endl;
+                meshData.texturePath = material.diffuseTexture;
+                std::cout << "Trying texture from MTL: '" << directory + meshData.texturePath << "'" << std::endl;
             }
-            // 2Բ OBJ ͬļֶ֧չ
+            // 策略2：尝试查找与 OBJ 同名的纹理文件（支持多种扩展名）
             else {
                 const std::vector<std::string> extensions = { ".png", ".jpg", ".jpeg", ".PNG", ".JPG", ".JPEG" };
                 for (const auto& ext : extensions) {
                     std::string candidatePath = directory + baseName + ext;
-                    if (fileExists(candidatePath)) {
-                        texturePath = candidatePath;
-                        std::cout << "Found auto-detected texture: '" << texturePath << "'" << std::endl;
+                    if (assetExists(candidatePath)) {
+                        meshData.texturePath = baseName + ext;
+                        std::cout << "Found auto-detected texture: '" << candidatePath << "'" << std::endl;
                         break;
                     }
                 }
 
-                if (texturePath.empty()) {
+                if (meshData.texturePath.empty()) {
                     std::cout << "No texture found for material '" << materialName << "'" << std::endl;
                 }
             }
+        }
 
-            // 
-            if (!texturePath.empty()) {
-                auto cacheIt = textureCache.find(texturePath);
-                if (cacheIt != textureCache.end()) {
-                    mesh.diffuseTexture = cacheIt->second;
-                    std::cout << "  -> Using cached texture" << std::endl;
-                }
-                else {
-                    try {
-                        auto texture = std::make_shared<ImageTexture2D>(texturePath);
-                        textureCache[texturePath] = texture;
-                        mesh.diffuseTexture = texture;
-                        std::cout << "  -> Texture loaded successfully!" << std::endl;
-                    }
-                    catch (const std::exception& e) {
-                        std::cerr << "  -> ERROR: Failed to load texture: " << e.what() << std::endl;
-                        mesh.diffuseTexture = nullptr;
-                    }
-                }
-            }
+        data.meshes.push_back(std::move(meshData));
+    }
+
+    return data;
+}
+
+Model createModel(const ModelData& data, VertexFormat vertexFormat) {
+    std::vector<Mesh> meshes;
+    TextureCache textureCache;
+    std::vector<std::string> texturePaths;
+    for (const auto& meshData : data.meshes) {
+        if (!meshData.texturePath.empty()) {
+            texturePaths.push_back(data.directory + meshData.texturePath);
         }
+    }
+    preloadTextures(texturePaths, textureCache);
 
-        glGenVertexArrays(1, &mesh.vao);
-        glGenBuffers(1, &mesh.vbo);
-        glGenBuffers(1, &mesh.ebo);
+    for (const auto& meshData : data.meshes) {
+        meshes.push_back(createMesh(
+            meshData, encodeVertices(meshData.vertices.data(), meshData.vertices.size(), vertexFormat),
+            meshData.indices.data(), meshData.indices.size(), data.directory, textureCache));
+    }
 
-        glBindVertexArray(mesh.vao);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-        glBufferData(
-            GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(Vertex)),
-            vertices.data(), GL_STATIC_DRAW);
+    return Model(std::move(meshes));
+}
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-        glBufferData(
-            GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)),
-            indices.data(), GL_STATIC_DRAW);
+Model loadModelFromFile(const std::string& path, bool loadMtl, const ModelLoadOptions& options) {
+    const auto begin = std::chrono::high_resolution_clock::now();
+    const auto elapsedMs = [&begin]() {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+        };
+
+    const uint32_t cacheFlags = MeshCache::getFlags(loadMtl, options);
+
+    // fast path: upload straight from the mapped cache
+    if (options.useMeshCache) {
+        MeshCache cache;
+        if (cache.open(path, cacheFlags)) {
+            const auto lastSlash = path.find_last_of("/\\");
+            const std::string directory = (lastSlash == std::string::npos) ? "" : path.substr(0, lastSlash + 1);
+
+            std::vector<Mesh> meshes;
+            TextureCache textureCache;
+            std::vector<std::string> texturePaths;
+            for (size_t i = 0; i < cache.getMeshCount(); ++i) {
+                const std::string texturePath = cache.getMeshInfo(i).texturePath;
+                if (!texturePath.empty()) {
+                    texturePaths.push_back(directory + texturePath);
+                }
+            }
+            preloadTextures(texturePaths, textureCache);
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-        glEnableVertexAttribArray(2);
+            for (size_t i = 0; i < cache.getMeshCount(); ++i) {
+                meshes.push_back(createMesh(
+                    cache.getMeshInfo(i), encodeVertices(cache.getVertices(i), cache.getVertexCount(i),
+                    options.vertexFormat), cache.getIndices(i), cache.getIndexCount(i), directory, textureCache));
+            }
 
-        glBindVertexArray(0);
+            std::cout << "Loaded model from cache: " << MeshCache::getCachePath(path) << " ("
+                      << elapsedMs() << " ms)" << std::endl;
+            return Model(std::move(meshes));
+        }
+    }
 
-        mesh.indexCount = indices.size();
-        meshes.push_back(std::move(mesh));
+    const ModelData data = buildModelData(path, loadMtl, options);
+    if (options.useMeshCache) {
+        MeshCache::write(path, cacheFlags, data);
     }
 
-    return Model(std::move(meshes));
-}
\ No newline at end of file
+    Model model = createModel(data, options.vertexFormat);
+    std::cout << "Loaded model: " << path << " (" << elapsedMs() << " ms)" << std::endl;
+    return model;
+}
@@ -2,18 +2,47 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/glm.hpp>
+#include "base/bounding_box.h"
 #include "base/transform.h"
 #include "base/texture2d.h"
 #include "base/vertex.h"
+#include "meshlet.h"
+#include "vertex_format.h"
+
+// a level of detail is a range of the mesh index buffer, all levels share the vertices
+struct MeshLod {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    // rms distance to the full detail surface in model units
+    float error = 0.0f;
+};
 
 struct Mesh {
     GLuint vao = 0;
     GLuint vbo = 0;
     GLuint ebo = 0;
+    // index count of the full detail level
     size_t indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    // start of the index data in the element buffer, lod / meshlet offsets are relative to it
+    size_t indexByteOffset = 0;
+    // finest level first, empty for meshes without a lod chain
+    std::vector<MeshLod> lods;
+    // clusters of the full detail level for per cluster culling, empty for small meshes
+    std::vector<Meshlet> meshlets;
+    // vertex + index bytes in vbo / ebo, 0 if the mesh draws from buffers shared by the model
+    size_t bufferBytes = 0;
+    VertexFormat vertexFormat = VertexFormat::Float;
+    // applied before the model transform, identity for meshes normalized at load time
+    glm::mat4 localMatrix = glm::mat4(1.0f);
+    // of the vertex positions, before localMatrix
+    BoundingBox bounds;
+    // texcoords with the origin at the top left (gltf)
+    bool flipTexCoordY = false;
     glm::vec3 baseColor = glm::vec3(1.0f);
     std::shared_ptr<ImageTexture2D> diffuseTexture;
 };
@@ -29,6 +58,9 @@ public:
 
     explicit Model(std::vector<Mesh>&& meshes);
 
+    // buffers shared by several meshes, owned by the model instead of a single mesh
+    Model(std::vector<Mesh>&& meshes, std::vector<GLuint>&& sharedBuffers, size_t sharedBufferBytes);
+
     Model(const Model&) = delete;
 
     Model& operator=(const Model&) = delete;
@@ -43,6 +75,12 @@ public:
 
     const std::vector<Mesh>& getMeshes() const;
 
+    // bytes of the vertex and index buffers, textures are shared and not included
+    size_t getByteSize() const;
+
+    // of all meshes in model space, i.e. with their localMatrix applied
+    const BoundingBox& getBounds() const;
+
 public:
     Transform transform;
 
@@ -52,7 +90,7 @@ protected:
     std::vector<uint32_t> _indices;
 
     // bounding box
-    //BoundingBox _boundingBox;
+    BoundingBox _boundingBox;
 
     // opengl objects
     GLuint _vao = 0;
@@ -63,9 +101,9 @@ protected:
     GLuint _boxVbo = 0;
     GLuint _boxEbo = 0;
 
-    /*void computeBoundingBox();
+    void computeBoundingBox();
 
-    void initGLResources();
+    /*void initGLResources();
 
     void initBoxGLResources();*/
 
@@ -74,7 +112,82 @@ protected:
 
 private:
     std::vector<Mesh> _meshes;
+    std::vector<GLuint> _sharedBuffers;
+    size_t _sharedBufferBytes = 0;
+
+};
+
+// cpu side result of loading a model, no gl objects involved
+struct MeshData {
+    glm::vec3 baseColor = glm::vec3(1.0f);
+    // relative to ModelData::directory, empty if the mesh has no texture
+    std::string texturePath;
+    std::vector<Vertex> vertices;
+    // the index ranges of all lods one after the other
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+};
+
+struct ModelData {
+    std::string directory;
+    // positions were normalized as (p - center) / scale
+    glm::vec3 center = glm::vec3(0.0f);
+    float scale = 1.0f;
+    std::vector<MeshData> meshes;
+    // material libraries the meshes were built from, relative to directory
+    std::vector<std::string> mtlFiles;
+};
+
+constexpr size_t minMeshletMeshTriangles = 1024;
+
+struct ModelLoadOptions {
+    // threads used to parse the obj file, <= 0 uses all hardware threads
+    int parseThreads = 0;
+    // read / write <asset>.meshcache next to the obj file
+    bool useMeshCache = true;
+    // reorder triangles / vertices for the vertex cache and overdraw before the upload
+    bool optimizeMeshes = true;
+    // levels of detail built by mesh simplification including the full mesh, 1 disables it
+    int maxLodLevels = 4;
+    // split meshes with at least minMeshletMeshTriangles triangles into meshlets
+    bool buildMeshlets = true;
+    // layout of the uploaded vertices, Compact needs the decoding in gbuffer.vert
+    VertexFormat vertexFormat = VertexFormat::Float;
+};
+
+// full texture path -> texture, paths found here are not loaded again
+using TextureCache = std::unordered_map<std::string, std::shared_ptr<ImageTexture2D>>;
+
+// prefers the baked mip chain <path>.btex over decoding the image, throws on failure
+std::shared_ptr<ImageTexture2D> loadTexture(const std::string& path);
 
+ModelData buildModelData(const std::string& path, bool loadMtl, const ModelLoadOptions& options = {});
+
+// vertices in the layout of the vertex buffer, encoded before the upload so that the
+// quantization can run on a worker. Float keeps pointing at the source vertices, which have to
+// outlive it, Compact owns the quantized copy
+struct EncodedVertices {
+    VertexFormat format = VertexFormat::Float;
+    const Vertex* vertices = nullptr;
+    std::vector<CompactVertex> compact;
+    size_t count = 0;
+    // of the vertex positions
+    BoundingBox bounds;
+    // Compact only
+    VertexQuantizationError error;
+
+    const void* getData() const;
 };
 
-Model loadModelFromFile(const std::string& path, bool loadMtl);
+EncodedVertices encodeVertices(const Vertex* vertices, size_t count, VertexFormat format);
+
+// uploads one mesh, the vertex / index arrays may point into a mapped cache file. textures
+// missing from textureCache are loaded synchronously
+Mesh createMesh(
+    const MeshData& meshData, const EncodedVertices& vertices, const uint32_t* indices, size_t indexCount,
+    const std::string& directory, TextureCache& textureCache);
+
+Model createModel(const ModelData& data, VertexFormat vertexFormat = VertexFormat::Float);
+
+Model loadModelFromFile(const std::string& path, bool loadMtl, const ModelLoadOptions& options = {});
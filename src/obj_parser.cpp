@@ -0,0 +1,458 @@
+#include "obj_parser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "base/mapped_file.h"
+#include "base/thread_pool.h"
+
+namespace {
+
+    glm::vec3 parseVec3(std::istringstream& iss) {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        iss >> x >> y >> z;
+        return { x, y, z };
+    }
+
+    glm::vec2 parseVec2(std::istringstream& iss) {
+        float x = 0.0f, y = 0.0f;
+        iss >> x >> y;
+        return { x, y };
+    }
+
+    std::string trim(const std::string& s) {
+        const auto begin = s.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) {
+            return "";
+        }
+        const auto end = s.find_last_not_of(" \t\r\n");
+        return s.substr(begin, end - begin + 1);
+    }
+
+    std::vector<std::string> tokenize(const std::string& line) {
+        std::istringstream iss(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (iss >> token) {
+            tokens.push_back(token);
+        }
+        return tokens;
+    }
+
+    FaceVertex parseFaceToken(const std::string& token) {
+        FaceVertex fv{};
+        std::istringstream ss(token);
+        std::string element;
+        int idx = 0;
+        while (std::getline(ss, element, '/')) {
+            if (element.empty()) {
+                ++idx;
+                continue;
+            }
+            int value = std::stoi(element);
+            int fixedIndex = (value < 0) ? value : value - 1;
+            switch (idx) {
+            case 0: fv.positionIndex = fixedIndex; break;
+            case 1: fv.texcoordIndex = fixedIndex; break;
+            case 2: fv.normalIndex = fixedIndex; break;
+            default: break;
+            }
+            ++idx;
+        }
+        return fv;
+    }
+
+    // helpers of the in-place scanner, they never allocate and work on [p, end)
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    const char* skipBlanks(const char* p, const char* end) {
+        while (p < end && isBlank(*p)) {
+            ++p;
+        }
+        return p;
+    }
+
+    const char* skipToken(const char* p, const char* end) {
+        while (p < end && !isBlank(*p)) {
+            ++p;
+        }
+        return p;
+    }
+
+    bool scanFloat(const char*& p, const char* end, float& value) {
+        p = skipBlanks(p, end);
+        if (p < end && *p == '+') {
+            ++p;
+        }
+        const auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+    }
+
+    glm::vec3 scanVec3(const char* p, const char* end) {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        if (scanFloat(p, end, x) && scanFloat(p, end, y)) {
+            scanFloat(p, end, z);
+        }
+        return { x, y, z };
+    }
+
+    glm::vec2 scanVec2(const char* p, const char* end) {
+        float x = 0.0f, y = 0.0f;
+        if (scanFloat(p, end, x)) {
+            scanFloat(p, end, y);
+        }
+        return { x, y };
+    }
+
+    // same semantics as parseFaceToken: "v", "v/vt", "v//vn", "v/vt/vn"
+    FaceVertex scanFaceToken(const char* p, const char* end) {
+        FaceVertex fv{};
+        int idx = 0;
+        while (idx < 3) {
+            const char* sep = std::find(p, end, '/');
+            const char* q = (p < sep && *p == '+') ? p + 1 : p;
+            int value = 0;
+            if (q < sep && std::from_chars(q, sep, value).ec == std::errc()) {
+                const int fixedIndex = (value < 0) ? value : value - 1;
+                switch (idx) {
+                case 0: fv.positionIndex = fixedIndex; break;
+                case 1: fv.texcoordIndex = fixedIndex; break;
+                case 2: fv.normalIndex = fixedIndex; break;
+                default: break;
+                }
+            }
+            if (sep == end) {
+                break;
+            }
+            p = sep + 1;
+            ++idx;
+        }
+        return fv;
+    }
+
+} // namespace
+
+void loadMtlFile(
+    const std::string& mtlPath, std::unordered_map<std::string, MaterialData>& materials) {
+    MappedFile mapped;
+    try {
+        mapped = MappedFile(mtlPath);
+    }
+    catch (const std::exception&) {
+        std::cerr << "Warning: Could not open MTL file: " << mtlPath << std::endl;
+        return;
+    }
+    std::istringstream file(std::string(mapped.data(), mapped.size()));
+
+    std::cout << "Loading MTL file: " << mtlPath << std::endl;
+
+    std::string line;
+    std::string currentName;
+    MaterialData currentMaterial;
+
+    auto commitMaterial = [&]() {
+        if (!currentName.empty()) {
+            materials[currentName] = currentMaterial;
+            std::cout << "  Material '" << currentName << "': ";
+            std::cout << "Kd(" << currentMaterial.diffuseColor.r << ", "
+                << currentMaterial.diffuseColor.g << ", "
+                << currentMaterial.diffuseColor.b << ")";
+            if (!currentMaterial.diffuseTexture.empty()) {
+                std::cout << ", Texture: '" << currentMaterial.diffuseTexture << "'";
+            }
+            std::cout << std::endl;
+        }
+        };
+
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream iss(line);
+        std::string key;
+        iss >> key;
+
+        if (key == "newmtl") {
+            commitMaterial();
+            iss >> currentName;
+            currentMaterial = MaterialData{};
+        }
+        else if (key == "Kd") {
+            currentMaterial.diffuseColor = parseVec3(iss);
+        }
+        else if (key == "map_Kd") {
+            std::string texPath;
+            std::getline(iss, texPath);
+            texPath = trim(texPath);
+            // convert back slashes to forward slashes
+            std::replace(texPath.begin(), texPath.end(), '\\', '/');
+            currentMaterial.diffuseTexture = texPath;
+        }
+    }
+
+    commitMaterial();
+}
+
+FaceStream& findOrAddFaceStream(std::vector<FaceStream>& streams, const std::string& materialName) {
+    for (auto& stream : streams) {
+        if (stream.materialName == materialName) {
+            return stream;
+        }
+    }
+    streams.emplace_back();
+    streams.back().materialName = materialName;
+    return streams.back();
+}
+
+namespace {
+
+    // result of scanning one line aligned range of the file
+    struct ObjChunk {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> texcoords;
+        // faceStreams[0] holds the faces before the first usemtl of the chunk,
+        // they use the material which is active at the chunk start
+        std::vector<FaceStream> faceStreams = std::vector<FaceStream>(1);
+        bool hasMaterial = false;
+        std::string lastMaterial;
+        std::vector<std::string> mtlFiles;
+    };
+
+    void scanObjRange(const char* p, const char* const rangeEnd, ObjChunk& chunk) {
+        std::vector<FaceVertex> faceVertices;
+        size_t currentStream = 0;
+
+        while (p < rangeEnd) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', rangeEnd - p));
+            if (lineEnd == nullptr) {
+                lineEnd = rangeEnd;
+            }
+            const char* const lineBegin = skipBlanks(p, lineEnd);
+            p = (lineEnd < rangeEnd) ? lineEnd + 1 : rangeEnd;
+
+            if (lineBegin == lineEnd || *lineBegin == '#') {
+                continue;
+            }
+
+            const char* const keyEnd = skipToken(lineBegin, lineEnd);
+            const std::string_view key(lineBegin, keyEnd - lineBegin);
+
+            if (key == "v") {
+                chunk.positions.push_back(scanVec3(keyEnd, lineEnd));
+            }
+            else if (key == "vt") {
+                chunk.texcoords.push_back(scanVec2(keyEnd, lineEnd));
+            }
+            else if (key == "vn") {
+                chunk.normals.push_back(scanVec3(keyEnd, lineEnd));
+            }
+            else if (key == "f") {
+                faceVertices.clear();
+                const char* token = skipBlanks(keyEnd, lineEnd);
+                while (token < lineEnd) {
+                    const char* tokenEnd = skipToken(token, lineEnd);
+                    faceVertices.push_back(scanFaceToken(token, tokenEnd));
+                    token = skipBlanks(tokenEnd, lineEnd);
+                }
+                if (faceVertices.size() < 3) {
+                    continue;
+                }
+
+                std::vector<FaceVertex>& stream = chunk.faceStreams[currentStream].vertices;
+                for (size_t i = 1; i + 1 < faceVertices.size(); ++i) {
+                    stream.push_back(faceVertices[0]);
+                    stream.push_back(faceVertices[i]);
+                    stream.push_back(faceVertices[i + 1]);
+                }
+            }
+            else if (key == "usemtl") {
+                const char* name = skipBlanks(keyEnd, lineEnd);
+                if (name < lineEnd) {
+                    chunk.lastMaterial.assign(name, skipToken(name, lineEnd));
+                    chunk.hasMaterial = true;
+                    // the leading stream of the chunk is never looked up by name
+                    currentStream = 1;
+                    while (currentStream < chunk.faceStreams.size()
+                           && chunk.faceStreams[currentStream].materialName != chunk.lastMaterial) {
+                        ++currentStream;
+                    }
+                    if (currentStream == chunk.faceStreams.size()) {
+                        chunk.faceStreams.emplace_back();
+                        chunk.faceStreams.back().materialName = chunk.lastMaterial;
+                    }
+                }
+            }
+            else if (key == "mtllib") {
+                const char* name = skipBlanks(keyEnd, lineEnd);
+                chunk.mtlFiles.emplace_back(name, skipToken(name, lineEnd));
+            }
+        }
+    }
+
+    template <typename T>
+    void appendChunkData(std::vector<T>& dst, std::vector<T>& src, size_t totalSize) {
+        if (dst.empty() && src.size() == totalSize) {
+            dst = std::move(src);
+        }
+        else {
+            dst.reserve(totalSize);
+            dst.insert(dst.end(), std::make_move_iterator(src.begin()), std::make_move_iterator(src.end()));
+        }
+    }
+
+    // below this size splitting the file costs more than it saves
+    constexpr size_t minChunkBytes = 256 * 1024;
+
+} // namespace
+
+ParsedObj parseObjFile(const std::string& path, bool loadMtl, int threadCount) {
+    MappedFile file;
+    try {
+        file = MappedFile(path);
+    }
+    catch (const std::exception&) {
+        throw std::runtime_error("failed to open obj file: " + path);
+    }
+
+    const auto lastSlash = path.find_last_of("/\\");
+    const std::string directory = (lastSlash == std::string::npos) ? "" : path.substr(0, lastSlash + 1);
+
+    ThreadPool& pool = ThreadPool::getGlobal();
+    size_t chunkCount = (threadCount > 0) ? static_cast<size_t>(threadCount) : pool.getThreadCount() + 1;
+    chunkCount = std::max<size_t>(1, std::min(chunkCount, file.size() / minChunkBytes));
+
+    // split the file at line boundaries
+    const char* const fileBegin = file.data();
+    const char* const fileEnd = fileBegin + file.size();
+    std::vector<const char*> bounds(chunkCount + 1, fileEnd);
+    bounds[0] = fileBegin;
+    for (size_t i = 1; i < chunkCount; ++i) {
+        const char* p = std::max(bounds[i - 1], fileBegin + file.size() * i / chunkCount);
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', fileEnd - p));
+        bounds[i] = (newline == nullptr) ? fileEnd : newline + 1;
+    }
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    pool.parallelFor(chunkCount, [&](size_t i) { scanObjRange(bounds[i], bounds[i + 1], chunks[i]); });
+
+    // stitch the chunks in file order, positive indices are already absolute and
+    // negative ones stay relative to the final element count as before
+    ParsedObj result;
+    size_t positionCount = 0, normalCount = 0, texcoordCount = 0;
+    for (const auto& chunk : chunks) {
+        positionCount += chunk.positions.size();
+        normalCount += chunk.normals.size();
+        texcoordCount += chunk.texcoords.size();
+    }
+
+    std::string currentMaterial;
+    for (auto& chunk : chunks) {
+        for (size_t i = 0; i < chunk.faceStreams.size(); ++i) {
+            FaceStream& src = chunk.faceStreams[i];
+            if (src.vertices.empty()) {
+                continue;
+            }
+            FaceStream& dst = findOrAddFaceStream(result.faceStreams, i == 0 ? currentMaterial : src.materialName);
+            if (dst.vertices.empty()) {
+                dst.vertices = std::move(src.vertices);
+            }
+            else {
+                dst.vertices.insert(dst.vertices.end(), src.vertices.begin(), src.vertices.end());
+            }
+        }
+        if (chunk.hasMaterial) {
+            currentMaterial = chunk.lastMaterial;
+        }
+
+        appendChunkData(result.positions, chunk.positions, positionCount);
+        appendChunkData(result.normals, chunk.normals, normalCount);
+        appendChunkData(result.texcoords, chunk.texcoords, texcoordCount);
+
+        if (loadMtl) {
+            for (const auto& mtlFile : chunk.mtlFiles) {
+                loadMtlFile(directory + mtlFile, result.materials);
+                result.mtlFiles.push_back(mtlFile);
+            }
+        }
+    }
+
+    return result;
+}
+
+ParsedObj parseObjFileStream(const std::string& path, bool loadMtl) {
+    ParsedObj result;
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open obj file: " + path);
+    }
+
+    const auto lastSlash = path.find_last_of("/\\");
+    const std::string directory = (lastSlash == std::string::npos) ? "" : path.substr(0, lastSlash + 1);
+
+    std::string line;
+    std::string currentMaterial;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream iss(line);
+        std::string key;
+        iss >> key;
+
+        if (key == "v") {
+            result.positions.push_back(parseVec3(iss));
+        }
+        else if (key == "vt") {
+            result.texcoords.push_back(parseVec2(iss));
+        }
+        else if (key == "vn") {
+            result.normals.push_back(parseVec3(iss));
+        }
+        else if (key == "f") {
+            std::vector<std::string> tokens = tokenize(line);
+            if (tokens.size() < 4) {
+                continue;
+            }
+
+            std::vector<FaceVertex> faceVertices;
+            for (size_t i = 1; i < tokens.size(); ++i) {
+                faceVertices.push_back(parseFaceToken(tokens[i]));
+            }
+
+            std::vector<FaceVertex>& stream = findOrAddFaceStream(result.faceStreams, currentMaterial).vertices;
+            for (size_t i = 1; i + 1 < faceVertices.size(); ++i) {
+                stream.push_back(faceVertices[0]);
+                stream.push_back(faceVertices[i]);
+                stream.push_back(faceVertices[i + 1]);
+            }
+        }
+        else if (key == "usemtl") {
+            iss >> currentMaterial;
+        }
+        else if (key == "mtllib" && loadMtl) {
+            std::string mtlFile;
+            iss >> mtlFile;
+            loadMtlFile(directory + mtlFile, result.materials);
+            result.mtlFiles.push_back(mtlFile);
+        }
+    }
+
+    return result;
+}
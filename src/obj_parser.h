@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct FaceVertex {
+    int positionIndex = -1;
+    int texcoordIndex = -1;
+    int normalIndex = -1;
+};
+
+struct MaterialData {
+    glm::vec3 diffuseColor = glm::vec3(0.8f);
+    std::string diffuseTexture;
+};
+
+// triangulated faces of one material in file order, three vertices per triangle
+struct FaceStream {
+    std::string materialName;
+    std::vector<FaceVertex> vertices;
+};
+
+// raw content of an obj file, face indices are zero based
+// and negative (relative) indices are kept as they are in the file
+struct ParsedObj {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texcoords;
+    // one stream per material in order of first use
+    std::vector<FaceStream> faceStreams;
+    std::unordered_map<std::string, MaterialData> materials;
+    // mtllib files read into materials, relative to the directory of the obj
+    std::vector<std::string> mtlFiles;
+};
+
+FaceStream& findOrAddFaceStream(std::vector<FaceStream>& streams, const std::string& materialName);
+
+void loadMtlFile(const std::string& mtlPath, std::unordered_map<std::string, MaterialData>& materials);
+
+// memory maps the file and scans it in place, large files are split into line aligned
+// chunks which are parsed on the global thread pool (threadCount <= 0: all hardware threads)
+ParsedObj parseObjFile(const std::string& path, bool loadMtl, int threadCount = 0);
+
+// reference parser built on std::getline / std::istringstream, kept for comparison
+ParsedObj parseObjFileStream(const std::string& path, bool loadMtl);
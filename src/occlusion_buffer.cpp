@@ -0,0 +1,347 @@
+#include "occlusion_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "base/thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_SSE 1
+#endif
+
+namespace {
+
+    // rows per band, a band is the unit of work of a thread
+    constexpr int bandHeight = 16;
+
+    // faces seen under a smaller area in pixels are treated as edge on
+    constexpr float minFaceArea = 1e-4f;
+
+    // corner i of a box has the max x / y / z if bit 0 / 1 / 2 is set. the faces wind counter
+    // clockwise seen from outside
+    constexpr int boxFaces[6][4] = {
+        { 0, 4, 6, 2 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 2, 3, 1 }, { 4, 5, 7, 6 },
+    };
+
+    glm::vec3 getCorner(const BoundingBox& box, int i) {
+        return glm::vec3(
+            (i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+    }
+
+    // distance to the near plane z = -w in clip space, negative behind it
+    float getNearDistance(const glm::vec4& v) {
+        return v.z + v.w;
+    }
+
+    // pixel containing a screen position, clamped to one pixel around the screen so that far
+    // off screen vertices do not overflow the cast
+    glm::ivec2 getPixelRange(const glm::vec2& screen, int width, int height) {
+        return glm::ivec2(glm::floor(glm::clamp(screen, glm::vec2(-1.0f), glm::vec2(width, height))));
+    }
+
+    float cross(const glm::vec2& origin, const glm::vec2& a, const glm::vec2& b) {
+        return (a.x - origin.x) * (b.y - origin.y) - (a.y - origin.y) * (b.x - origin.x);
+    }
+
+    // counter clockwise convex hull of the 8 projected corners (monotone chain), returns the
+    // number of corners written to hull
+    int getConvexHull(glm::vec2 points[8], glm::vec2 hull[16]) {
+        std::sort(points, points + 8, [](const glm::vec2& a, const glm::vec2& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+            });
+        int count = 0;
+        for (int i = 0; i < 8; ++i) {
+            while (count >= 2 && cross(hull[count - 2], hull[count - 1], points[i]) <= 0.0f) {
+                --count;
+            }
+            hull[count++] = points[i];
+        }
+        for (int i = 6, lower = count + 1; i >= 0; --i) {
+            while (count >= lower && cross(hull[count - 2], hull[count - 1], points[i]) <= 0.0f) {
+                --count;
+            }
+            hull[count++] = points[i];
+        }
+        // the first corner closes the loop
+        return count - 1;
+    }
+
+} // namespace
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) {
+    resize(width, height);
+}
+
+void OcclusionBuffer::resize(int width, int height) {
+    _width = (std::max(width, 4) + 3) & ~3;
+    _height = std::max(height, 1);
+    _depth.assign(static_cast<size_t>(_width) * _height, 1.0f);
+    _bins.resize((_height + bandHeight - 1) / bandHeight);
+}
+
+int OcclusionBuffer::getWidth() const {
+    return _width;
+}
+
+int OcclusionBuffer::getHeight() const {
+    return _height;
+}
+
+void OcclusionBuffer::render(
+    const std::vector<BoundingBox>& occluders, const glm::mat4& viewProjection, size_t maxThreads) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    _stats = OcclusionStats();
+    _viewProjection = viewProjection;
+    _silhouettes.clear();
+    for (auto& bin : _bins) {
+        bin.clear();
+    }
+
+    // the setup is cheap next to the raster and stays on this thread
+    for (const BoundingBox& box : occluders) {
+        if (setupSilhouette(box)) {
+            ++_stats.occluders;
+        }
+        else {
+            ++_stats.skippedOccluders;
+        }
+    }
+
+    ThreadPool::getGlobal().parallelFor(_bins.size(), [this](size_t band) { rasterizeBand(band); }, maxThreads);
+    _stats.rasterMs =
+        std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool OcclusionBuffer::isVisible(const BoundingBox& box) const {
+    if (box.isEmpty()) {
+        return true;
+    }
+
+    glm::vec2 screenMin(std::numeric_limits<float>::max());
+    glm::vec2 screenMax(-std::numeric_limits<float>::max());
+    float nearestDepth = std::numeric_limits<float>::max();
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec4 clip = _viewProjection * glm::vec4(getCorner(box, i), 1.0f);
+        if (getNearDistance(clip) <= 0.0f) {
+            return true;
+        }
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        const glm::vec2 screen = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(_width, _height);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearestDepth = std::min(nearestDepth, ndc.z);
+    }
+
+    // every pixel the rectangle touches
+    const glm::ivec2 pixelMin = getPixelRange(screenMin, _width, _height);
+    const glm::ivec2 pixelMax = getPixelRange(screenMax, _width, _height);
+    const int minX = std::max(0, pixelMin.x);
+    const int maxX = std::min(_width - 1, pixelMax.x);
+    const int minY = std::max(0, pixelMin.y);
+    const int maxY = std::min(_height - 1, pixelMax.y);
+    if (minX > maxX || minY > maxY) {
+        // off screen, which the frustum decides on
+        return true;
+    }
+
+    for (int y = minY; y <= maxY; ++y) {
+        const float* row = _depth.data() + static_cast<size_t>(y) * _width;
+        int x = minX;
+#ifdef OCCLUSION_SSE
+        const __m128 nearest = _mm_set1_ps(nearestDepth);
+        for (; x + 3 <= maxX; x += 4) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), nearest)) != 0) {
+                return true;
+            }
+        }
+#endif
+        for (; x <= maxX; ++x) {
+            if (row[x] >= nearestDepth) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t OcclusionBuffer::cullOccluded(
+    std::vector<uint32_t>& indices, const std::function<BoundingBox(uint32_t)>& getBounds) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    size_t count = 0;
+    for (uint32_t index : indices) {
+        if (isVisible(getBounds(index))) {
+            indices[count++] = index;
+        }
+    }
+    const size_t occluded = indices.size() - count;
+    indices.resize(count);
+
+    _stats.tests += count + occluded;
+    _stats.occluded += occluded;
+    _stats.testMs +=
+        std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return occluded;
+}
+
+const std::vector<float>& OcclusionBuffer::getDepth() const {
+    return _depth;
+}
+
+const OcclusionStats& OcclusionBuffer::getStats() const {
+    return _stats;
+}
+
+bool OcclusionBuffer::setupSilhouette(const BoundingBox& box) {
+    if (box.isEmpty()) {
+        return false;
+    }
+
+    glm::vec2 points[8];
+    float depths[8];
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec4 clip = _viewProjection * glm::vec4(getCorner(box, i), 1.0f);
+        // the silhouette of a box cut by the near plane is not the hull of its corners
+        if (getNearDistance(clip) <= 0.0f) {
+            return false;
+        }
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        points[i] = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(_width, _height);
+        depths[i] = ndc.z;
+    }
+
+    Silhouette silhouette;
+    // a ray enters a box through the farthest of the front face planes it crosses
+    for (const auto& face : boxFaces) {
+        const glm::vec2& a = points[face[0]];
+        const glm::vec2& b = points[face[1]];
+        const glm::vec2& c = points[face[2]];
+        const float area = cross(a, b, c);
+        if (area <= minFaceArea || silhouette.depthCount == 3) {
+            continue;
+        }
+        const float da = depths[face[0]];
+        const float db = depths[face[1]];
+        const float dc = depths[face[2]];
+        float* plane = silhouette.depths[silhouette.depthCount++];
+        plane[0] = ((db - da) * (c.y - a.y) - (dc - da) * (b.y - a.y)) / area;
+        plane[1] = ((dc - da) * (b.x - a.x) - (db - da) * (c.x - a.x)) / area;
+        plane[2] = da - plane[0] * a.x - plane[1] * a.y;
+    }
+    if (silhouette.depthCount == 0) {
+        return false;
+    }
+
+    const glm::ivec2 boundsMin = getPixelRange(glm::min(
+        glm::min(glm::min(points[0], points[1]), glm::min(points[2], points[3])),
+        glm::min(glm::min(points[4], points[5]), glm::min(points[6], points[7]))), _width, _height);
+    const glm::ivec2 boundsMax = getPixelRange(glm::max(
+        glm::max(glm::max(points[0], points[1]), glm::max(points[2], points[3])),
+        glm::max(glm::max(points[4], points[5]), glm::max(points[6], points[7]))), _width, _height);
+    silhouette.minX = std::max(0, boundsMin.x);
+    silhouette.maxX = std::min(_width - 1, boundsMax.x);
+    silhouette.minY = std::max(0, boundsMin.y);
+    silhouette.maxY = std::min(_height - 1, boundsMax.y);
+    if (silhouette.minX > silhouette.maxX || silhouette.minY > silhouette.maxY) {
+        return false;
+    }
+
+    glm::vec2 hull[16];
+    const int hullCount = getConvexHull(points, hull);
+    if (hullCount < 3 || hullCount > 6) {
+        return false;
+    }
+    for (int i = 0; i < hullCount; ++i) {
+        const glm::vec2& from = hull[i];
+        const glm::vec2& to = hull[i + 1];
+        float* edge = silhouette.edges[silhouette.edgeCount++];
+        edge[0] = from.y - to.y;
+        edge[1] = to.x - from.x;
+        // moved inwards by the largest value the function takes over half a pixel, so that
+        // it is positive at a pixel center only if the whole pixel is inside
+        edge[2] = from.x * to.y - from.y * to.x - 0.5f * (std::abs(edge[0]) + std::abs(edge[1]));
+    }
+
+    const uint32_t index = static_cast<uint32_t>(_silhouettes.size());
+    _silhouettes.push_back(silhouette);
+    for (int band = silhouette.minY / bandHeight; band <= silhouette.maxY / bandHeight; ++band) {
+        _bins[band].push_back(index);
+    }
+    return true;
+}
+
+void OcclusionBuffer::rasterizeBand(size_t band) {
+    const int bandMinY = static_cast<int>(band) * bandHeight;
+    const int bandMaxY = std::min(_height - 1, bandMinY + bandHeight - 1);
+    std::fill(
+        _depth.begin() + static_cast<size_t>(bandMinY) * _width,
+        _depth.begin() + static_cast<size_t>(bandMaxY + 1) * _width, 1.0f);
+
+    for (uint32_t index : _bins[band]) {
+        const Silhouette& silhouette = _silhouettes[index];
+        const int minY = std::max(silhouette.minY, bandMinY);
+        const int maxY = std::min(silhouette.maxY, bandMaxY);
+        // whole groups of 4, the width is a multiple of 4
+        const int minX = silhouette.minX & ~3;
+        const int maxX = silhouette.maxX;
+
+        for (int y = minY; y <= maxY; ++y) {
+            float* row = _depth.data() + static_cast<size_t>(y) * _width;
+            const float py = static_cast<float>(y) + 0.5f;
+#ifdef OCCLUSION_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 steps = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128 rowEdges[6];
+            __m128 edgeSteps[6];
+            for (int e = 0; e < silhouette.edgeCount; ++e) {
+                rowEdges[e] = _mm_set1_ps(silhouette.edges[e][1] * py + silhouette.edges[e][2]);
+                edgeSteps[e] = _mm_set1_ps(silhouette.edges[e][0]);
+            }
+            __m128 rowDepths[3];
+            __m128 depthSteps[3];
+            for (int d = 0; d < silhouette.depthCount; ++d) {
+                rowDepths[d] = _mm_set1_ps(silhouette.depths[d][1] * py + silhouette.depths[d][2]);
+                depthSteps[d] = _mm_set1_ps(silhouette.depths[d][0]);
+            }
+            for (int x = minX; x <= maxX; x += 4) {
+                const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), steps);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeSteps[0], px), rowEdges[0]), zero);
+                for (int e = 1; e < silhouette.edgeCount; ++e) {
+                    inside =
+                        _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeSteps[e], px), rowEdges[e]), zero));
+                }
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                __m128 depth = _mm_add_ps(_mm_mul_ps(depthSteps[0], px), rowDepths[0]);
+                for (int d = 1; d < silhouette.depthCount; ++d) {
+                    depth = _mm_max_ps(depth, _mm_add_ps(_mm_mul_ps(depthSteps[d], px), rowDepths[d]));
+                }
+                const __m128 current = _mm_loadu_ps(row + x);
+                const __m128 nearer = _mm_min_ps(current, depth);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+            }
+#else
+            for (int x = minX; x <= maxX; ++x) {
+                const float px = static_cast<float>(x) + 0.5f;
+                bool inside = true;
+                for (int e = 0; e < silhouette.edgeCount && inside; ++e) {
+                    const float* edge = silhouette.edges[e];
+                    inside = edge[0] * px + edge[1] * py + edge[2] >= 0.0f;
+                }
+                if (!inside) {
+                    continue;
+                }
+                float depth = -std::numeric_limits<float>::max();
+                for (int d = 0; d < silhouette.depthCount; ++d) {
+                    const float* plane = silhouette.depths[d];
+                    depth = std::max(depth, plane[0] * px + plane[1] * py + plane[2]);
+                }
+                row[x] = std::min(row[x], depth);
+            }
+#endif
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/bounding_box.h"
+
+// statistics of the last render and the tests since
+struct OcclusionStats {
+    size_t occluders = 0;
+    // crossing the near plane, empty or smaller than a pixel
+    size_t skippedOccluders = 0;
+    double rasterMs = 0.0;
+    size_t tests = 0;
+    size_t occluded = 0;
+    double testMs = 0.0;
+};
+
+// Low resolution depth buffer rasterized on the cpu from a few large boxes (occluders), used to
+// skip boxes which are hidden behind them before they are submitted to the gpu.
+//
+// An occluder is drawn as its screen space silhouette, covering only the pixels which lie
+// inside of it entirely, with the depth of the front faces it is entered through. The screen
+// is split into bands of rows which are rasterized on the global thread pool, 4 pixels at a
+// time with SSE. Depth is z / w of the given view projection, nearer is smaller. A box is
+// hidden if all pixels its screen rectangle touches hold a depth nearer than its nearest
+// corner. Occluders must lie inside the geometry they stand for.
+class OcclusionBuffer {
+public:
+    // the width is rounded up to a multiple of 4
+    explicit OcclusionBuffer(int width = 256, int height = 128);
+
+    void resize(int width, int height);
+
+    int getWidth() const;
+
+    int getHeight() const;
+
+    // clears the buffer and rasterizes the boxes, boxes crossing the near plane are skipped.
+    // maxThreads == 0 uses the whole global pool
+    void render(const std::vector<BoundingBox>& occluders, const glm::mat4& viewProjection, size_t maxThreads = 0);
+
+    // false if the box is hidden behind the occluders of the last render. boxes crossing the
+    // near plane and empty boxes are visible
+    bool isVisible(const BoundingBox& box) const;
+
+    // removes the indices whose bounds are hidden, keeping the order, and returns their count
+    size_t cullOccluded(std::vector<uint32_t>& indices, const std::function<BoundingBox(uint32_t)>& getBounds);
+
+    // row major from the bottom row, width x height
+    const std::vector<float>& getDepth() const;
+
+    const OcclusionStats& getStats() const;
+
+private:
+    // convex silhouette of a box, at most 6 corners
+    struct Silhouette {
+        // edge functions a * x + b * y + c, positive where the whole pixel is inside
+        float edges[6][3];
+        int edgeCount = 0;
+        // depth planes a * x + b * y + c of the front faces, the largest one is the depth
+        float depths[3][3];
+        int depthCount = 0;
+        int minX, maxX, minY, maxY;
+    };
+
+    int _width = 0;
+    int _height = 0;
+    glm::mat4 _viewProjection = glm::mat4(1.0f);
+    std::vector<float> _depth;
+    std::vector<Silhouette> _silhouettes;
+    // silhouette indices per band of rows
+    std::vector<std::vector<uint32_t>> _bins;
+    OcclusionStats _stats;
+
+    // false if the box is skipped
+    bool setupSilhouette(const BoundingBox& box);
+
+    void rasterizeBand(size_t band);
+};
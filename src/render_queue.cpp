@@ -0,0 +1,186 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <optional>
+
+uint64_t RenderQueue::makeSortKey(uint32_t pass, uint32_t program, uint32_t texture, uint32_t vao, uint32_t depth) {
+    return (uint64_t(pass & 0xfu) << 60) | (uint64_t(program & 0xffu) << 52) | (uint64_t(texture & 0xffffu) << 36)
+           | (uint64_t(vao & 0xffffu) << 20) | (uint64_t(depth & 0xffffu) << 4);
+}
+
+uint32_t RenderQueue::getDepthBucket(float distance, float farPlane) {
+    const float t = glm::clamp(distance / farPlane, 0.0f, 1.0f);
+    return std::min(static_cast<uint32_t>(t * depthBuckets), depthBuckets - 1);
+}
+
+void RenderQueue::clear() {
+    _commands.clear();
+    _items.clear();
+    _rangeCounts.clear();
+    _rangeOffsets.clear();
+    _textureIndices.clear();
+    _vaoIndices.clear();
+}
+
+uint32_t RenderQueue::getTextureIndex(GLuint texture) {
+    if (texture == 0) {
+        return 0;
+    }
+    return _textureIndices.emplace(texture, static_cast<uint32_t>(_textureIndices.size() + 1)).first->second;
+}
+
+uint32_t RenderQueue::getVaoIndex(GLuint vao) {
+    return _vaoIndices.emplace(vao, static_cast<uint32_t>(_vaoIndices.size())).first->second;
+}
+
+size_t RenderQueue::addRanges(const std::vector<GLsizei>& counts, const std::vector<const void*>& offsets) {
+    const size_t first = _rangeCounts.size();
+    _rangeCounts.insert(_rangeCounts.end(), counts.begin(), counts.end());
+    _rangeOffsets.insert(_rangeOffsets.end(), offsets.begin(), offsets.end());
+    return first;
+}
+
+void RenderQueue::push(uint64_t key, const DrawCommand& command) {
+    _items.emplace_back(key, static_cast<uint32_t>(_commands.size()));
+    _commands.push_back(command);
+}
+
+size_t RenderQueue::size() const {
+    return _commands.size();
+}
+
+void RenderQueue::sort() {
+    // lsd radix sort, one byte per pass. passes in which all keys share the byte are skipped,
+    // which are most of them for a single pass / program
+    _scratch.resize(_items.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (const auto& item : _items) {
+            ++histogram[(item.first >> shift) & 0xff];
+        }
+        if (std::any_of(std::begin(histogram), std::end(histogram), [this](size_t count) {
+                return count == _items.size();
+            })) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t& count : histogram) {
+            const size_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+        for (const auto& item : _items) {
+            _scratch[histogram[(item.first >> shift) & 0xff]++] = item;
+        }
+        _items.swap(_scratch);
+    }
+}
+
+void RenderQueue::submit(const GLSLProgram& program, const InstanceBuffer& instances) {
+    _stats = RenderQueueStats();
+
+    // nothing is known about the state before the first draw. the uniforms are unknown until
+    // a draw sets them, draws which do not read one (textured, instanced) leave it unknown
+    bool first = true;
+    GLuint vao = 0;
+    GLuint texture = 0;
+    std::optional<bool> instanced;
+    std::optional<bool> compactVertex;
+    std::optional<bool> flipTexCoordY;
+    std::optional<glm::vec3> color;
+    std::optional<glm::mat4> model;
+    // instance attributes are vao state, the range last pointed at per vao
+    std::unordered_map<GLuint, size_t> instanceRanges;
+
+    // counts a skipped update if value is known and did not change, sets it otherwise
+    const auto update = [this](auto& current, const auto& value) {
+        if (current && *current == value) {
+            ++_stats.uniformUpdatesSkipped;
+            return false;
+        }
+        current = value;
+        ++_stats.uniformUpdates;
+        return true;
+        };
+
+    glActiveTexture(GL_TEXTURE0);
+    for (const auto& item : _items) {
+        const DrawCommand& command = _commands[item.second];
+        const bool isInstanced = command.type == DrawType::Instanced;
+
+        if (first || command.texture != texture) {
+            glBindTexture(GL_TEXTURE_2D, command.texture);
+            if (first || (command.texture != 0) != (texture != 0)) {
+                program.setUniformBool("useAlbedoTexture", command.texture != 0);
+            }
+            texture = command.texture;
+            ++_stats.textureBinds;
+        }
+        else {
+            ++_stats.textureBindsSkipped;
+        }
+
+        if (update(instanced, isInstanced)) {
+            program.setUniformBool("instanced", isInstanced);
+        }
+        if (update(compactVertex, command.compactVertex)) {
+            program.setUniformBool("compactVertex", command.compactVertex);
+        }
+        if (update(flipTexCoordY, command.flipTexCoordY)) {
+            program.setUniformBool("flipTexCoordY", command.flipTexCoordY);
+        }
+        // textured draws do not read the color
+        if (command.texture == 0 && update(color, command.color)) {
+            program.setUniformVec3("fallbackColor", command.color);
+        }
+        if (!isInstanced && update(model, command.model)) {
+            program.setUniformMat4("model", command.model);
+            program.setUniformMat3("normalMatrix", command.normalMatrix);
+        }
+
+        if (first || command.vao != vao) {
+            glBindVertexArray(command.vao);
+            vao = command.vao;
+            ++_stats.vaoBinds;
+        }
+        else {
+            ++_stats.vaoBindsSkipped;
+        }
+        first = false;
+
+        switch (command.type) {
+        case DrawType::Elements:
+            glDrawElements(
+                GL_TRIANGLES, command.indexCount, command.indexType,
+                reinterpret_cast<void*>(command.indexByteOffset));
+            break;
+        case DrawType::MultiElements:
+            glMultiDrawElements(
+                GL_TRIANGLES, _rangeCounts.data() + command.firstRange, command.indexType,
+                _rangeOffsets.data() + command.firstRange, static_cast<GLsizei>(command.rangeCount));
+            break;
+        case DrawType::Instanced: {
+            auto it = instanceRanges.find(command.vao);
+            if (it == instanceRanges.end() || it->second != command.firstInstance) {
+                instances.bindAttributes(command.firstInstance);
+                instanceRanges[command.vao] = command.firstInstance;
+            }
+            glDrawElementsInstanced(
+                GL_TRIANGLES, command.indexCount, command.indexType,
+                reinterpret_cast<void*>(command.indexByteOffset), static_cast<GLsizei>(command.instanceCount));
+            break;
+        }
+        }
+        ++_stats.draws;
+    }
+
+    // the attributes stay pointed at this frame's instances, non instanced draws of these vaos
+    // do not read them
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+const RenderQueueStats& RenderQueue::getStats() const {
+    return _stats;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "base/glsl_program.h"
+#include "instance_buffer.h"
+
+enum class DrawType {
+    Elements,
+    // meshlets which passed culling, a range of the queue's multi draw arrays
+    MultiElements,
+    // a range of the instance buffer
+    Instanced,
+};
+
+// one deferred draw of the gbuffer pass and the state it needs
+struct DrawCommand {
+    DrawType type = DrawType::Elements;
+    GLuint vao = 0;
+    // 0 draws fallbackColor
+    GLuint texture = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLsizei indexCount = 0;
+    size_t indexByteOffset = 0;
+    size_t firstRange = 0;
+    size_t rangeCount = 0;
+    size_t firstInstance = 0;
+    size_t instanceCount = 0;
+    glm::vec3 color = glm::vec3(1.0f);
+    bool compactVertex = false;
+    bool flipTexCoordY = false;
+    // unused by instanced draws
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::mat3 normalMatrix = glm::mat3(1.0f);
+};
+
+// state changes of the last submit, skipped ones were equal to the state of the previous draw
+struct RenderQueueStats {
+    size_t draws = 0;
+    size_t textureBinds = 0;
+    size_t textureBindsSkipped = 0;
+    size_t vaoBinds = 0;
+    size_t vaoBindsSkipped = 0;
+    size_t uniformUpdates = 0;
+    size_t uniformUpdatesSkipped = 0;
+};
+
+// Draws collected for a frame and submitted in the order of their 64 bit sort keys:
+//   63..60 pass | 59..52 program | 51..36 texture | 35..20 vao | 19..4 depth | 3..0 unused
+// so that draws sharing a program, texture and vao end up next to each other, front to back
+// within them. Textures and vaos are numbered densely per frame, the depth is quantized.
+class RenderQueue {
+public:
+    static constexpr uint32_t depthBuckets = 1u << 16;
+
+    static uint64_t makeSortKey(uint32_t pass, uint32_t program, uint32_t texture, uint32_t vao, uint32_t depth);
+
+    // depth bucket of a view distance, linear up to farPlane
+    static uint32_t getDepthBucket(float distance, float farPlane);
+
+    void clear();
+
+    // dense per frame number of a texture / vao for the sort key, texture 0 stays 0
+    uint32_t getTextureIndex(GLuint texture);
+
+    uint32_t getVaoIndex(GLuint vao);
+
+    // copies the ranges, returns the first one for DrawCommand::firstRange
+    size_t addRanges(const std::vector<GLsizei>& counts, const std::vector<const void*>& offsets);
+
+    void push(uint64_t key, const DrawCommand& command);
+
+    size_t size() const;
+
+    // radix sort of the keys, stable for equal keys
+    void sort();
+
+    // issues the draws with the uniforms of gbuffer.vert / gbuffer.frag, the program must be in
+    // use. instances is bound for instanced draws
+    void submit(const GLSLProgram& program, const InstanceBuffer& instances);
+
+    const RenderQueueStats& getStats() const;
+
+private:
+    std::vector<DrawCommand> _commands;
+    // key and command index, sorted by key
+    std::vector<std::pair<uint64_t, uint32_t>> _items;
+    std::vector<std::pair<uint64_t, uint32_t>> _scratch;
+    std::vector<GLsizei> _rangeCounts;
+    std::vector<const void*> _rangeOffsets;
+    std::unordered_map<GLuint, uint32_t> _textureIndices;
+    std::unordered_map<GLuint, uint32_t> _vaoIndices;
+    RenderQueueStats _stats;
+};
@@ -1,8 +1,14 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
+layout(location = 1) in vec3 aNormal;  // xy: octahedral normal for compact vertices
 layout(location = 2) in vec2 aTexCoords;
+// per instance, only used by instanced draws
+layout(location = 3) in mat4 aInstanceModel;
+layout(location = 7) in mat4 aInstanceNormalMatrix;
 
+uniform bool compactVertex;
+uniform bool flipTexCoordY;  // gltf texcoords start at the top left
+uniform bool instanced;      // model / normal matrix from the instance attributes
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
@@ -12,10 +18,20 @@ out vec3 FragPos;   // world space
 out vec3 Normal;    // world space
 out vec2 TexCoords;
 
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 void main() {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    vec3 normal = compactVertex ? octDecode(aNormal.xy) : aNormal;
+    mat4 modelMatrix = instanced ? aInstanceModel : model;
+    mat3 normalMat = instanced ? mat3(aInstanceNormalMatrix) : normalMatrix;
+    vec4 worldPos = modelMatrix * vec4(aPos, 1.0);
     FragPos = worldPos.xyz;
-    Normal = normalize(normalMatrix * aNormal);
-    TexCoords = aTexCoords;
+    Normal = normalize(normalMat * normal);
+    TexCoords = flipTexCoordY ? vec2(aTexCoords.x, 1.0 - aTexCoords.y) : aTexCoords;
     gl_Position = projection * view * worldPos;
 }
\ No newline at end of file
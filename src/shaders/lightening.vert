@@ -1,7 +1,7 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoords; // 
+layout (location = 2) in vec2 aTexCoords; // 如果有纹理
 
 uniform mat4 model;
 uniform mat4 view;
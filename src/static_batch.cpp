@@ -0,0 +1,165 @@
+#include "static_batch.h"
+
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+#include "vertex_format.h"
+
+namespace {
+
+    struct MeshGeometry {
+        std::vector<Vertex> vertices;
+        // full detail level only
+        std::vector<uint32_t> indices;
+    };
+
+    // the loaders do not keep the cpu copies, the buffers are read back once per mesh
+    MeshGeometry readMeshGeometry(const Mesh& mesh) {
+        MeshGeometry geometry;
+
+        GLint vertexBytes = 0;
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &vertexBytes);
+        const size_t stride = getVertexStride(mesh.vertexFormat);
+        const size_t vertexCount = static_cast<size_t>(vertexBytes) / stride;
+        if (mesh.vertexFormat == VertexFormat::Compact) {
+            std::vector<CompactVertex> compact(vertexCount);
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(vertexCount * stride), compact.data());
+            geometry.vertices.reserve(vertexCount);
+            for (const CompactVertex& vertex : compact) {
+                geometry.vertices.push_back(decompressVertex(vertex));
+            }
+        }
+        else {
+            geometry.vertices.resize(vertexCount);
+            glGetBufferSubData(
+                GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(vertexCount * stride), geometry.vertices.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        const size_t indexOffset = mesh.lods.empty() ? 0 : mesh.lods[0].indexOffset;
+        geometry.indices.resize(mesh.indexCount);
+        // the element buffer binding is vao state, the copy read target leaves the vaos alone
+        glBindBuffer(GL_COPY_READ_BUFFER, mesh.ebo);
+        glGetBufferSubData(
+            GL_COPY_READ_BUFFER, static_cast<GLintptr>(mesh.indexByteOffset + indexOffset * sizeof(uint32_t)),
+            static_cast<GLsizeiptr>(mesh.indexCount * sizeof(uint32_t)), geometry.indices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return geometry;
+    }
+
+} // namespace
+
+bool isStaticBatchable(const Mesh& mesh) {
+    return mesh.vbo != 0 && mesh.ebo != 0 && mesh.bufferBytes != 0 && mesh.indexType == GL_UNSIGNED_INT
+           && !mesh.flipTexCoordY && mesh.localMatrix == glm::mat4(1.0f);
+}
+
+std::vector<StaticBatchData> buildStaticBatches(const std::vector<StaticBatchInput>& inputs, float chunkSize) {
+    std::unordered_map<const Mesh*, MeshGeometry> geometries;
+    // chunk x, chunk z, texture, color -> batch
+    using BatchKey = std::tuple<int, int, const ImageTexture2D*, float, float, float>;
+    std::map<BatchKey, size_t> batchIndices;
+    std::vector<StaticBatchData> batches;
+
+    for (const StaticBatchInput& input : inputs) {
+        const Mesh& mesh = *input.mesh;
+        auto it = geometries.find(&mesh);
+        if (it == geometries.end()) {
+            it = geometries.emplace(&mesh, readMeshGeometry(mesh)).first;
+        }
+        const MeshGeometry& geometry = it->second;
+
+        const BoundingBox bounds = transformBoundingBox(mesh.bounds, input.model);
+        int chunkX = 0, chunkZ = 0;
+        if (chunkSize > 0.0f && !bounds.isEmpty()) {
+            const glm::vec3 center = bounds.getCenter();
+            chunkX = static_cast<int>(std::floor(center.x / chunkSize));
+            chunkZ = static_cast<int>(std::floor(center.z / chunkSize));
+        }
+        const glm::vec3 color = mesh.baseColor * input.color;
+        // textured meshes ignore the color
+        const glm::vec3 colorKey = mesh.diffuseTexture != nullptr ? glm::vec3(0.0f) : color;
+        const BatchKey key(chunkX, chunkZ, mesh.diffuseTexture.get(), colorKey.x, colorKey.y, colorKey.z);
+
+        auto batchIt = batchIndices.find(key);
+        if (batchIt == batchIndices.end()) {
+            StaticBatchData batch;
+            batch.texture = mesh.diffuseTexture;
+            batch.color = color;
+            batchIt = batchIndices.emplace(key, batches.size()).first;
+            batches.push_back(std::move(batch));
+        }
+        StaticBatchData& batch = batches[batchIt->second];
+
+        const uint32_t base = static_cast<uint32_t>(batch.vertices.size());
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(input.model)));
+        for (const Vertex& vertex : geometry.vertices) {
+            Vertex world = vertex;
+            world.position = glm::vec3(input.model * glm::vec4(vertex.position, 1.0f));
+            world.normal = glm::normalize(normalMatrix * vertex.normal);
+            batch.vertices.push_back(world);
+        }
+        for (uint32_t index : geometry.indices) {
+            batch.indices.push_back(base + index);
+        }
+        batch.bounds += bounds;
+        ++batch.meshCount;
+    }
+    return batches;
+}
+
+StaticGeometry::~StaticGeometry() {
+    clear();
+}
+
+void StaticGeometry::upload(const std::vector<StaticBatchData>& batches) {
+    clear();
+    for (const StaticBatchData& data : batches) {
+        StaticBatch batch;
+        batch.indexCount = data.indices.size();
+        batch.texture = data.texture;
+        batch.color = data.color;
+        batch.bounds = data.bounds;
+
+        glGenVertexArrays(1, &batch.vao);
+        glGenBuffers(1, &batch.vbo);
+        glGenBuffers(1, &batch.ebo);
+
+        glBindVertexArray(batch.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+        glBufferData(
+            GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.vertices.size() * sizeof(Vertex)), data.vertices.data(),
+            GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.ebo);
+        glBufferData(
+            GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.indices.size() * sizeof(uint32_t)),
+            data.indices.data(), GL_STATIC_DRAW);
+        // world space positions leave the [-1, 1] cube of the compact format
+        setupVertexAttributes(VertexFormat::Float);
+        glBindVertexArray(0);
+
+        _byteSize += data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(uint32_t);
+        _batches.push_back(std::move(batch));
+    }
+}
+
+void StaticGeometry::clear() {
+    for (StaticBatch& batch : _batches) {
+        glDeleteVertexArrays(1, &batch.vao);
+        glDeleteBuffers(1, &batch.vbo);
+        glDeleteBuffers(1, &batch.ebo);
+    }
+    _batches.clear();
+    _byteSize = 0;
+}
+
+const std::vector<StaticBatch>& StaticGeometry::getBatches() const {
+    return _batches;
+}
+
+size_t StaticGeometry::getByteSize() const {
+    return _byteSize;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "base/bounding_box.h"
+#include "base/texture2d.h"
+#include "base/vertex.h"
+#include "model.h"
+
+// a mesh placed in the world which never moves again
+struct StaticBatchInput {
+    const Mesh* mesh = nullptr;
+    glm::mat4 model = glm::mat4(1.0f);
+    // fallback color of the scene model, multiplied with the mesh base color
+    glm::vec3 color = glm::vec3(1.0f);
+};
+
+// cpu side of one batch: the world space vertices of all meshes of a chunk with one material
+struct StaticBatchData {
+    std::shared_ptr<ImageTexture2D> texture;
+    glm::vec3 color = glm::vec3(1.0f);
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    BoundingBox bounds;
+    size_t meshCount = 0;
+};
+
+struct StaticBatch {
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    size_t indexCount = 0;
+    std::shared_ptr<ImageTexture2D> texture;
+    glm::vec3 color = glm::vec3(1.0f);
+    BoundingBox bounds;
+};
+
+// only meshes with buffers of their own, 32 bit indices and no transform below the model can be
+// batched, the vertices are read back from gl
+bool isStaticBatchable(const Mesh& mesh);
+
+// merges the inputs by material and by chunks of chunkSize x chunkSize world units on the xz
+// plane, chunkSize <= 0 puts everything into one chunk. the full detail level is used
+std::vector<StaticBatchData> buildStaticBatches(const std::vector<StaticBatchInput>& inputs, float chunkSize);
+
+// The uploaded batches of the static scene, drawn with an identity model matrix in one call
+// each. The source meshes stay untouched.
+class StaticGeometry {
+public:
+    StaticGeometry() = default;
+
+    StaticGeometry(const StaticGeometry&) = delete;
+
+    StaticGeometry& operator=(const StaticGeometry&) = delete;
+
+    ~StaticGeometry();
+
+    void upload(const std::vector<StaticBatchData>& batches);
+
+    void clear();
+
+    const std::vector<StaticBatch>& getBatches() const;
+
+    // vertex + index bytes of all batches
+    size_t getByteSize() const;
+
+private:
+    std::vector<StaticBatch> _batches;
+    size_t _byteSize = 0;
+};
@@ -0,0 +1,142 @@
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+    int16_t quantizeSnorm16(float value) {
+        const float clamped = std::clamp(value, -1.0f, 1.0f);
+        return static_cast<int16_t>(std::lround(clamped * 32767.0f));
+    }
+
+    float dequantizeSnorm16(int16_t value) {
+        return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+    }
+
+    glm::vec3 octDecode(const glm::vec2& e) {
+        glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+        const float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        return glm::normalize(n);
+    }
+
+    glm::vec3 decodeNormal(const int16_t normal[2]) {
+        return octDecode(glm::vec2(dequantizeSnorm16(normal[0]), dequantizeSnorm16(normal[1])));
+    }
+
+    // octahedral mapping of the unit sphere onto [-1, 1]^2, the rounding direction of
+    // both components is chosen so that the decoded normal is closest to the input
+    void encodeNormal(const glm::vec3& normal, int16_t result[2]) {
+        const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (length == 0.0f) {
+            // missing normal, decodes to +z
+            result[0] = result[1] = 0;
+            return;
+        }
+
+        glm::vec3 n = normal / length;
+        glm::vec2 e(n.x, n.y);
+        if (n.z < 0.0f) {
+            e.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+            e.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        }
+
+        const glm::vec3 reference = glm::normalize(normal);
+        const float fx = std::floor(std::clamp(e.x, -1.0f, 1.0f) * 32767.0f);
+        const float fy = std::floor(std::clamp(e.y, -1.0f, 1.0f) * 32767.0f);
+        float bestDot = -2.0f;
+        for (int i = 0; i < 4; ++i) {
+            const int16_t candidate[2] = {
+                static_cast<int16_t>(std::clamp(fx + (i & 1), -32767.0f, 32767.0f)),
+                static_cast<int16_t>(std::clamp(fy + (i >> 1), -32767.0f, 32767.0f))
+            };
+            const float d = glm::dot(decodeNormal(candidate), reference);
+            if (d > bestDot) {
+                bestDot = d;
+                result[0] = candidate[0];
+                result[1] = candidate[1];
+            }
+        }
+    }
+
+} // namespace
+
+size_t getVertexStride(VertexFormat format) {
+    return format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+CompactVertex compressVertex(const Vertex& vertex) {
+    CompactVertex result{};
+    result.position[0] = quantizeSnorm16(vertex.position.x);
+    result.position[1] = quantizeSnorm16(vertex.position.y);
+    result.position[2] = quantizeSnorm16(vertex.position.z);
+    result.position[3] = 0;
+    encodeNormal(vertex.normal, result.normal);
+    result.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+    result.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+    return result;
+}
+
+Vertex decompressVertex(const CompactVertex& vertex) {
+    Vertex result;
+    result.position = glm::vec3(
+        dequantizeSnorm16(vertex.position[0]), dequantizeSnorm16(vertex.position[1]),
+        dequantizeSnorm16(vertex.position[2]));
+    result.normal = decodeNormal(vertex.normal);
+    result.texCoord = glm::vec2(glm::unpackHalf1x16(vertex.texCoord[0]), glm::unpackHalf1x16(vertex.texCoord[1]));
+    return result;
+}
+
+std::vector<CompactVertex> compressVertices(const Vertex* vertices, size_t count, VertexQuantizationError* error) {
+    std::vector<CompactVertex> result(count);
+    for (size_t i = 0; i < count; ++i) {
+        result[i] = compressVertex(vertices[i]);
+    }
+
+    if (error != nullptr) {
+        *error = VertexQuantizationError();
+        for (size_t i = 0; i < count; ++i) {
+            const Vertex decoded = decompressVertex(result[i]);
+            const glm::vec3 positionDelta = glm::abs(decoded.position - vertices[i].position);
+            const glm::vec2 texCoordDelta = glm::abs(decoded.texCoord - vertices[i].texCoord);
+            error->maxPositionError = std::max(
+                { error->maxPositionError, positionDelta.x, positionDelta.y, positionDelta.z });
+            error->maxTexCoordError = std::max({ error->maxTexCoordError, texCoordDelta.x, texCoordDelta.y });
+
+            const float normalLength = glm::length(vertices[i].normal);
+            if (normalLength > 0.0f) {
+                const float d = std::clamp(glm::dot(decoded.normal, vertices[i].normal / normalLength), -1.0f, 1.0f);
+                error->maxNormalError = std::max(error->maxNormalError, glm::degrees(std::acos(d)));
+            }
+        }
+    }
+
+    return result;
+}
+
+void setupVertexAttributes(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Float:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+        break;
+    case VertexFormat::Compact:
+        // the normal arrives as the two octahedral components and is decoded in the shader
+        glVertexAttribPointer(
+            0, 3, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, position));
+        glVertexAttribPointer(
+            1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
+        glVertexAttribPointer(
+            2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, texCoord));
+        break;
+    }
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/vertex.h"
+
+enum class VertexFormat {
+    // Vertex as it is, 32 bytes
+    Float,
+    // CompactVertex, 16 bytes
+    Compact,
+};
+
+// quantized vertex for meshes inside the [-1, 1] cube:
+// snorm16 position (w is padding), snorm16 octahedral normal, half float texcoord
+struct CompactVertex {
+    int16_t position[4];
+    int16_t normal[2];
+    uint16_t texCoord[2];
+};
+
+static_assert(sizeof(CompactVertex) == 16, "CompactVertex must stay 16 bytes");
+
+struct VertexQuantizationError {
+    float maxPositionError = 0.0f;
+    // degrees
+    float maxNormalError = 0.0f;
+    float maxTexCoordError = 0.0f;
+};
+
+size_t getVertexStride(VertexFormat format);
+
+CompactVertex compressVertex(const Vertex& vertex);
+
+Vertex decompressVertex(const CompactVertex& vertex);
+
+// error receives the largest deviation of the decoded vertices if not null
+std::vector<CompactVertex> compressVertices(
+    const Vertex* vertices, size_t count, VertexQuantizationError* error = nullptr);
+
+// attribute 0: position, 1: normal, 2: texcoord for the vbo currently bound to GL_ARRAY_BUFFER
+void setupVertexAttributes(VertexFormat format);
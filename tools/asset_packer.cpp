@@ -0,0 +1,162 @@
+// Packs every file below the asset directory into one AssetPack, baking the textures which have
+// no up to date .btex first. Mesh caches written by earlier runs are packed as they are. At the
+// end every file is read once loose and once through the pack for comparison (warm cache).
+// usage: asset_packer [--no-bake] [media dir] [output pack]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "base/asset_pack.h"
+#include "base/baked_texture.h"
+
+namespace {
+
+    bool hasSuffix(const std::string& text, const std::string& suffix) {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool isBakeableImage(const std::string& path) {
+        std::string lower = path;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+            });
+        return hasSuffix(lower, ".png") || hasSuffix(lower, ".jpg") || hasSuffix(lower, ".jpeg");
+    }
+
+    bool bakeImage(const std::string& path) {
+        int width = 0, height = 0, channels = 0;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        if (pixels == nullptr || channels == 2) {
+            stbi_image_free(pixels);
+            return false;
+        }
+        const BakedTextureData data = BakedTexture::bake(pixels, width, height, channels, true);
+        stbi_image_free(pixels);
+        return BakedTexture::write(path, data);
+    }
+
+    // touches every byte so that the pages are really read
+    size_t touch(const char* data, size_t size) {
+        size_t sum = 0;
+        for (size_t i = 0; i < size; i += 4096) {
+            sum += static_cast<unsigned char>(data[i]);
+        }
+        return sum;
+    }
+
+    double measureMs(const std::function<void()>& fn) {
+        const auto begin = std::chrono::high_resolution_clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool bake = true;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--no-bake") {
+            bake = false;
+        }
+        else {
+            args.push_back(arg);
+        }
+    }
+    const std::filesystem::path root = args.size() > 0 ? args[0] : "media";
+    const std::string packPath = args.size() > 1 ? args[1] : (root / "assets.pack").string();
+
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec)) {
+        std::cerr << "not a directory: " << root.string() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // like ImageTexture2D, the bake stores rows bottom up
+    stbi_set_flip_vertically_on_load(true);
+
+    std::vector<std::string> relativePaths;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(root, ec)) {
+        if (!item.is_regular_file()) {
+            continue;
+        }
+        const std::string relativePath = item.path().lexically_relative(root).generic_string();
+        if (hasSuffix(relativePath, ".pack") || hasSuffix(relativePath, ".tmp") || hasSuffix(relativePath, ".bench.obj")) {
+            continue;
+        }
+        relativePaths.push_back(relativePath);
+    }
+
+    size_t baked = 0;
+    if (bake) {
+        for (const std::string& relativePath : std::vector<std::string>(relativePaths)) {
+            const std::string path = (root / relativePath).string();
+            BakedTexture existing;
+            if (!isBakeableImage(relativePath) || existing.open(path)) {
+                continue;
+            }
+            if (bakeImage(path)) {
+                const std::string bakedPath = relativePath + ".btex";
+                if (std::find(relativePaths.begin(), relativePaths.end(), bakedPath) == relativePaths.end()) {
+                    relativePaths.push_back(bakedPath);
+                }
+                ++baked;
+            }
+            else {
+                std::cerr << "Warning: failed to bake " << path << std::endl;
+            }
+        }
+    }
+
+    // sorted paths keep the files of one model (obj, mtl, textures, bakes) next to each other
+    std::sort(relativePaths.begin(), relativePaths.end());
+    std::vector<AssetPackInput> inputs;
+    for (const std::string& relativePath : relativePaths) {
+        inputs.push_back({ relativePath, (root / relativePath).string() });
+    }
+
+    const double packMs = measureMs([&]() {
+        if (!AssetPack::write(packPath, inputs)) {
+            std::exit(EXIT_FAILURE);
+        }
+        });
+
+    size_t looseBytes = 0;
+    size_t looseSum = 0;
+    const double looseMs = measureMs([&]() {
+        for (const AssetPackInput& input : inputs) {
+            const MappedFile file(input.sourcePath);
+            looseSum += touch(file.data(), file.size());
+            looseBytes += file.size();
+        }
+        });
+
+    size_t packedSum = 0;
+    const double packedMs = measureMs([&]() {
+        AssetPack::mount(packPath, root.string());
+        for (const AssetPackInput& input : inputs) {
+            const MappedFile file(input.sourcePath);
+            packedSum += touch(file.data(), file.size());
+        }
+        AssetPack::unmount();
+        });
+    if (packedSum != looseSum) {
+        std::cerr << "pack does not match the loose files" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << packPath << ": " << inputs.size() << " files ("
+              << baked << " textures baked), " << looseBytes / 1024 << " KiB, written in " << packMs << " ms\n"
+              << "read loose: " << std::setw(8) << looseMs << " ms, " << inputs.size() << " files opened\n"
+              << "read pack:  " << std::setw(8) << packedMs << " ms, 1 file opened\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+// Bakes the mip chain of images into <image>.btex next to them (see BakedTexture), block
+// compressed unless --uncompressed is given, and compares the bake against decoding the image.
+// usage: texture_baker [--uncompressed] [image...]
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "base/baked_texture.h"
+
+namespace {
+
+    double elapsedMs(std::chrono::high_resolution_clock::time_point begin) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool compress = true;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--uncompressed") {
+            compress = false;
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        paths = {
+            "media/obj/judy_3d.png",
+            "media/obj/nike.png",
+            "media/obj/snow_box.png",
+            "media/gltf/grey_knight/textures/WEAPON_baseColor.png",
+        };
+    }
+
+    // like ImageTexture2D, the bake stores rows bottom up
+    stbi_set_flip_vertically_on_load(true);
+
+    size_t totalDecodedBytes = 0;
+    size_t totalBakedBytes = 0;
+    double totalDecodeMs = 0.0;
+    double totalOpenMs = 0.0;
+    int failures = 0;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const std::string& path : paths) {
+        auto begin = std::chrono::high_resolution_clock::now();
+        int width = 0, height = 0, channels = 0;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        const double decodeMs = elapsedMs(begin);
+        if (pixels == nullptr || channels == 2) {
+            std::cerr << "  -> ERROR: Failed to decode texture: " << path << std::endl;
+            stbi_image_free(pixels);
+            ++failures;
+            continue;
+        }
+
+        const BakedTextureData data = BakedTexture::bake(pixels, width, height, channels, compress);
+        stbi_image_free(pixels);
+        if (!BakedTexture::write(path, data)) {
+            ++failures;
+            continue;
+        }
+
+        begin = std::chrono::high_resolution_clock::now();
+        BakedTexture baked;
+        if (!baked.open(path)) {
+            std::cerr << "  -> ERROR: Failed to read back " << BakedTexture::getBakedPath(path) << std::endl;
+            ++failures;
+            continue;
+        }
+        const double openMs = elapsedMs(begin);
+
+        // what ImageTexture2D uploads from the image: level 0 only, the driver builds the rest
+        // at the same size again
+        const size_t decodedBytes = size_t(width) * height * channels;
+        std::cout << path << ": " << width << "x" << height << "x" << channels << "\n"
+                  << "  decode:  " << std::setw(8) << decodeMs << " ms, " << decodedBytes / 1024
+                  << " KiB level 0, ~" << decodedBytes * 4 / 3 / 1024 << " KiB with mipmaps\n"
+                  << "  baked:   " << std::setw(8) << openMs << " ms, " << baked.getTotalSize() / 1024
+                  << " KiB, " << baked.getLevelCount() << " levels"
+                  << (baked.isCompressed() ? ", block compressed" : "") << "\n";
+
+        totalDecodedBytes += decodedBytes * 4 / 3;
+        totalBakedBytes += baked.getTotalSize();
+        totalDecodeMs += decodeMs;
+        totalOpenMs += openMs;
+    }
+
+    if (totalBakedBytes != 0) {
+        std::cout << "total: " << totalDecodeMs << " ms -> " << totalOpenMs << " ms, "
+                  << totalDecodedBytes / 1024 << " KiB -> " << totalBakedBytes / 1024 << " KiB of texture memory\n";
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}